@@ -1,8 +1,18 @@
 #include "level.h"
+#include "pathfinding_hpa.h"
+#include "pathfinding_zones.h"
+#include "pathfinding_layers.h"
+#include "pathfinding_landmarks.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
 
 // ============================================================================
 // FRUSTUM CULLING
@@ -146,7 +156,79 @@ bool level_is_walkable(Level* lvl, float worldX, float worldZ) {
 // CARICAMENTO LIVELLO
 // ============================================================================
 
-bool level_load(Level* lvl, const char* configPath) {
+// Chunk letto dal .lvl: i dati CPU (heightmap, walkmask, pathgrid) si
+// caricano in parallelo, mesh e texture dopo, sul main thread (contesto GL)
+typedef struct {
+    int ix, iz;
+    int idx;
+    float offsetX, offsetZ;
+    char objPath[512], hmPath[512], wmPath[512];  // wmPath vuoto = nessuna walkmask
+    bool loaded;
+} ChunkLoadJob;
+
+typedef struct {
+    Level* lvl;
+    ChunkLoadJob* jobs;
+    int count;
+    int next;               // Prossimo job da assegnare (protetto da lock)
+    pthread_mutex_t lock;
+    PathGridBuildParams walkParams;
+} ChunkLoadQueue;
+
+static void* chunk_load_worker(void* arg) {
+    ChunkLoadQueue* q = (ChunkLoadQueue*)arg;
+
+    while (true) {
+        pthread_mutex_lock(&q->lock);
+        int i = q->next < q->count ? q->next++ : -1;
+        pthread_mutex_unlock(&q->lock);
+        if (i < 0) break;
+
+        ChunkLoadJob* job = &q->jobs[i];
+        job->loaded = terrain_init_data(&q->lvl->chunks[job->idx], job->hmPath,
+                                        job->wmPath[0] ? job->wmPath : NULL,
+                                        q->lvl->chunkSize, job->offsetX, job->offsetZ,
+                                        &q->walkParams);
+    }
+    return NULL;
+}
+
+static int detect_core_count(void) {
+    int cores;
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cores = (int)info.dwNumberOfProcessors;
+#else
+    cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return cores < 1 ? 1 : cores;
+}
+
+// Esegue tutti i job: il main thread lavora insieme a (core - 1) thread.
+// Se un thread non parte i suoi job restano agli altri
+static void chunk_load_run(ChunkLoadQueue* q) {
+    int workers = detect_core_count();
+    if (workers > q->count) workers = q->count;
+
+    pthread_t threads[64];
+    if (workers > 64) workers = 64;
+    int started = 0;
+
+    pthread_mutex_init(&q->lock, NULL);
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, chunk_load_worker, q) == 0) started++;
+    }
+    chunk_load_worker(q);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&q->lock);
+
+    printf("[Level] Chunk data loaded on %d thread(s)\n", started + 1);
+}
+
+static bool level_load_internal(Level* lvl, const char* configPath, bool headless) {
     FILE* f = fopen(configPath, "r");
     if (!f) {
         printf("[Level] ERROR: Cannot open config file: %s\n", configPath);
@@ -158,6 +240,9 @@ bool level_load(Level* lvl, const char* configPath) {
 
     char line[512];
     int chunksRead = 0;
+    int landmarkCount = 0;
+    float walkThreshold = PATHGRID_DEFAULT_WALKABLE_RATIO;
+    int walkPixel = PATHGRID_DEFAULT_PIXEL_THRESHOLD;
 
     // Prima passata: leggi header
     while (fgets(line, sizeof(line), f)) {
@@ -173,6 +258,12 @@ bool level_load(Level* lvl, const char* configPath) {
             sscanf(line, "%*s %d", &lvl->chunksCountZ);
         } else if (strcmp(key, "chunk_size") == 0) {
             sscanf(line, "%*s %f", &lvl->chunkSize);
+        } else if (strcmp(key, "landmarks") == 0) {
+            sscanf(line, "%*s %d", &landmarkCount);
+        } else if (strcmp(key, "walk_threshold") == 0) {
+            sscanf(line, "%*s %f", &walkThreshold);
+        } else if (strcmp(key, "walk_pixel") == 0) {
+            sscanf(line, "%*s %d", &walkPixel);
         }
     }
 
@@ -182,6 +273,11 @@ bool level_load(Level* lvl, const char* configPath) {
         fclose(f);
         return false;
     }
+    if (walkThreshold < 0.0f || walkThreshold > 1.0f || walkPixel < 0 || walkPixel > 255) {
+        printf("[Level] ERROR: walk_threshold must be in [0, 1] and walk_pixel in [0, 255] (%s)\n", configPath);
+        fclose(f);
+        return false;
+    }
 
     // Calcola bounds e origine (centrato)
     lvl->totalSizeX = lvl->chunksCountX * lvl->chunkSize;
@@ -211,6 +307,19 @@ bool level_load(Level* lvl, const char* configPath) {
         baseDir[len] = '\0';
     }
 
+    ChunkLoadQueue queue = { .lvl = lvl };
+    queue.walkParams.pixel_threshold = (uint8_t)walkPixel;
+    queue.walkParams.walkable_ratio = walkThreshold;
+    queue.jobs = (ChunkLoadJob*)calloc(lvl->totalChunks, sizeof(ChunkLoadJob));
+    bool* queued = (bool*)calloc(lvl->totalChunks, sizeof(bool));
+    if (!queue.jobs || !queued) {
+        printf("[Level] ERROR: Failed to allocate chunk load jobs\n");
+        free(queue.jobs);
+        free(queued);
+        fclose(f);
+        return false;
+    }
+
     // Seconda passata: leggi chunk
     rewind(f);
     while (fgets(line, sizeof(line), f)) {
@@ -221,7 +330,10 @@ bool level_load(Level* lvl, const char* configPath) {
         if (sscanf(line, "%63s", key) != 1) continue;
         if (strcmp(key, "chunks_x") == 0 ||
             strcmp(key, "chunks_z") == 0 ||
-            strcmp(key, "chunk_size") == 0) continue;
+            strcmp(key, "chunk_size") == 0 ||
+            strcmp(key, "landmarks") == 0 ||
+            strcmp(key, "walk_threshold") == 0 ||
+            strcmp(key, "walk_pixel") == 0) continue;
 
         // Formato: indice_x indice_z path_obj path_heightmap [path_walkmask]
         int ix, iz;
@@ -247,34 +359,89 @@ bool level_load(Level* lvl, const char* configPath) {
         float offsetX = lvl->originX + arrayX * lvl->chunkSize;
         float offsetZ = lvl->originZ + arrayZ * lvl->chunkSize;
 
-        // Costruisci path completi
-        char fullObjPath[512], fullHmPath[512], fullWmPath[512];
-        snprintf(fullObjPath, sizeof(fullObjPath), "%s%s", baseDir, objPath);
-        snprintf(fullHmPath, sizeof(fullHmPath), "%s%s", baseDir, hmPath);
+        // Una riga ripetuta per lo stesso chunk: vale l'ultima
+        ChunkLoadJob* job = NULL;
+        if (queued[idx]) {
+            for (int i = 0; i < queue.count; i++) {
+                if (queue.jobs[i].idx == idx) job = &queue.jobs[i];
+            }
+        } else {
+            job = &queue.jobs[queue.count++];
+            queued[idx] = true;
+        }
 
-        const char* wmPathPtr = NULL;
+        // Costruisci path completi
+        job->ix = ix;
+        job->iz = iz;
+        job->idx = idx;
+        job->offsetX = offsetX;
+        job->offsetZ = offsetZ;
+        snprintf(job->objPath, sizeof(job->objPath), "%s%s", baseDir, objPath);
+        snprintf(job->hmPath, sizeof(job->hmPath), "%s%s", baseDir, hmPath);
+        job->wmPath[0] = '\0';
         if (wmPath[0]) {
-            snprintf(fullWmPath, sizeof(fullWmPath), "%s%s", baseDir, wmPath);
-            wmPathPtr = fullWmPath;
+            snprintf(job->wmPath, sizeof(job->wmPath), "%s%s", baseDir, wmPath);
         }
 
         printf("[Level] Loading chunk [%d,%d] at (%.1f, %.1f)...\n", ix, iz, offsetX, offsetZ);
+    }
 
-        if (!terrain_init_hybrid(&lvl->chunks[idx], fullObjPath, fullHmPath, wmPathPtr,
-                                  lvl->chunkSize, offsetX, offsetZ)) {
-            printf("[Level] WARNING: Failed to load chunk %d,%d\n", ix, iz);
+    fclose(f);
+    free(queued);
+
+    // Dati CPU di tutti i chunk in parallelo (stbi, downsampling, clearance),
+    // poi mesh e texture in ordine sul main thread
+    if (queue.count > 0) chunk_load_run(&queue);
+
+    for (int i = 0; i < queue.count; i++) {
+        ChunkLoadJob* job = &queue.jobs[i];
+        if (job->loaded && !headless && !terrain_init_gpu(&lvl->chunks[job->idx], job->objPath)) {
+            // Senza mesh il chunk non c'è, come prima del caricamento parallelo
+            terrain_cleanup(&lvl->chunks[job->idx]);
+            memset(&lvl->chunks[job->idx], 0, sizeof(Terrain));
+            job->loaded = false;
+        }
+        if (!job->loaded) {
+            printf("[Level] WARNING: Failed to load chunk %d,%d\n", job->ix, job->iz);
         } else {
             chunksRead++;
         }
     }
-
-    fclose(f);
+    free(queue.jobs);
 
     printf("[Level] Loaded %d/%d chunks\n", chunksRead, lvl->totalChunks);
+
+    // Clearance sui bordi tra chunk, grafo astratto per i path lunghi, zone
+    // connesse e landmark opzionali (usano i pathgrid appena costruiti).
+    // Il grafo HPA* serve solo se il livello non sta nella finestra 3x3
+    if (chunksRead > 0) {
+        pathfinding_update_clearance(lvl, 0, 0, pathfinding_level_cells_x(lvl) - 1,
+                                     pathfinding_level_cells_z(lvl) - 1);
+        if (lvl->chunksCountX > HPA_MIN_LEVEL_CHUNKS || lvl->chunksCountZ > HPA_MIN_LEVEL_CHUNKS) {
+            hpa_build(lvl);
+        }
+        zones_build(lvl);
+        if (landmarkCount > 0) landmarks_build(lvl, landmarkCount);
+    }
+
     return chunksRead > 0;
 }
 
+bool level_load(Level* lvl, const char* configPath) {
+    return level_load_internal(lvl, configPath, false);
+}
+
+bool level_load_headless(Level* lvl, const char* configPath) {
+    return level_load_internal(lvl, configPath, true);
+}
+
 void level_cleanup(Level* lvl) {
+    pathfinding_discard_changes(lvl);
+    hpa_destroy(lvl);
+    zones_destroy(lvl);
+    layers_destroy(lvl);
+    landmarks_destroy(lvl);
+
     if (lvl->chunks) {
         for (int i = 0; i < lvl->totalChunks; i++) {
             terrain_cleanup(&lvl->chunks[i]);
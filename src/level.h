@@ -24,6 +24,18 @@ typedef struct Level {
     float originX;
     float originZ;
 
+    // Grafo astratto HPA* per path oltre la finestra 3x3 (vedi pathfinding_hpa.h)
+    struct HpaGraph* hpaGraph;
+
+    // Componenti connesse delle celle walkable (vedi pathfinding_zones.h)
+    struct ZoneMap* zoneMap;
+
+    // Ponti e camminamenti sopra il terreno, NULL se nessuno (vedi pathfinding_layers.h)
+    struct PathLayers* pathLayers;
+
+    // Distanze dai landmark per l'euristica ALT, NULL se non richiesti (vedi pathfinding_landmarks.h)
+    struct LandmarkMap* landmarks;
+
     // Statistiche (per debug)
     int chunksRendered;     // Chunk disegnati nell'ultimo frame
     int totalChunks;        // Numero totale di chunk
@@ -37,6 +49,10 @@ typedef struct Level {
 // Carica un livello da file config (.lvl)
 bool level_load(Level* lvl, const char* configPath);
 
+// Come level_load ma senza mesh, texture e shader: niente contesto GL
+// (tool e benchmark headless). Solo heightmap, walkmask e pathfinding.
+bool level_load_headless(Level* lvl, const char* configPath);
+
 // Libera tutte le risorse
 void level_cleanup(Level* lvl);
 
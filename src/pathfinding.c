@@ -4,10 +4,18 @@
 #include <string.h>
 #include <math.h>
 #include <float.h>
+#include <limits.h>
 #include <glad/glad.h>
 #include "terrain.h"
 #include "level.h"
 #include "utils.h"
+#include "pathfinding_internal.h"
+#include "pathfinding_hpa.h"
+#include "pathfinding_cache.h"
+#include "pathfinding_zones.h"
+#include "pathfinding_layers.h"
+#include "pathfinding_landmarks.h"
+#include "pathfinding_arena.h"
 
 // Massimo 3x3 chunks, ogni chunk è 64x64
 #define MAX_CHUNKS_X 3
@@ -16,159 +24,184 @@
 #define TEMP_GRID_HEIGHT (PATHGRID_SIZE * MAX_CHUNKS_Z)  // 192
 #define MAX_GRID_CELLS (TEMP_GRID_WIDTH * TEMP_GRID_HEIGHT) // ~36k
 
+// Un piano della finestra per layer di navigazione:
+// cella (x, z) del layer l = l * MAX_GRID_CELLS + z * TEMP_GRID_WIDTH + x.
+// I piani dei layer > 0 vengono toccati solo se la finestra ne contiene.
+#define MAX_WINDOW_CELLS (MAX_GRID_CELLS * PATH_MAX_LAYERS)
+
+// Bit di grid[] delle celle con link verso altri layer (walkability e classe
+// di terreno restano nei bit bassi)
+#define CELL_LINK 0x80
+#define MAX_WINDOW_LINKS (2 * LAYERS_MAX_LINKS)
+
 // ============================================================================
 // INTERNAL STRUCTURES
 // ============================================================================
 
-// Nodo per A*
-typedef struct PathNode {
-    int x, z;                // Coordinate griglia
-    float g_cost;            // Costo dal punto di partenza
-    float h_cost;            // Euristica al goal
-    float f_cost;            // g + h
-    struct PathNode* parent; // Puntatore al nodo genitore
-    int heap_index;          // Indice nel binary heap
-} PathNode;
+// Entry dell'open set: cella della finestra attiva (indice come grid[]) e
+// f_cost, tenuti insieme così i confronti dell'heap non toccano lo stato per cella
+typedef struct {
+    float f_cost;
+    int cell;
+} HeapEntry;
 
-// Binary heap per open set (min-heap basato su f_cost)
-#define MAX_HEAP_SIZE 32768
+// Link orientato tra due celle della finestra (indici come grid[])
+typedef struct {
+    int from, to;
+    float cost;
+} WindowLink;
 
+// Contenuto di grid[]: stessa chiave = stessa finestra, la copia si può saltare
 typedef struct {
-    PathNode** nodes;
-    int size;
-    int capacity;
-} PriorityQueue;
+    struct Level* lvl;
+    int chunk_x, chunk_z, chunks_x, chunks_z;
+    int clearance;           // min_clearance applicata alla copia
+    uint32_t profile_hash;   // 0 = costi uniformi
+    uint64_t version;        // Versioni dei chunk della finestra + versione dei layer
+} WindowKey;
 
-// Pool di nodi preallocati per evitare malloc in loop A*
-#define MAX_PATH_NODES 32768
-static PathNode g_node_pool[MAX_PATH_NODES];
-static int g_node_pool_used = 0;
+// heap_slot di una cella fuori dall'open set
+#define SLOT_NONE   -1       // Appena visitata, non ancora inserita
+#define SLOT_CLOSED -2       // Già estratta ed espansa
 
-// Statistiche performance
-static struct {
-    int total_paths_requested;
-    int paths_found;
-    int paths_failed;
-    float total_time_ms;
-    float max_time_ms;
-} g_stats = {0};
 
+struct PathfindingContext {
+    // Griglia dati (walkability), un piano per layer
+    uint8_t grid[MAX_WINDOW_CELLS];
 
-// ============================================================================
-// PRIORITY QUEUE (Binary Min-Heap)
-// ============================================================================
+    // Stato per cella (struct-of-arrays indicizzato come grid[]), valido solo
+    // se visited_tag == current_search_id: nessun reset tra una ricerca e l'altra
+    float g_costs[MAX_WINDOW_CELLS];
+    int visited_tag[MAX_WINDOW_CELLS]; // Sostituisce il closed_set bitfield
+    int parent[MAX_WINDOW_CELLS];      // Cella genitore, -1 per lo start
+    int heap_slot[MAX_WINDOW_CELLS];   // Posizione nell'heap, SLOT_NONE o SLOT_CLOSED
 
-static PriorityQueue* pq_create(int capacity) {
-    PriorityQueue* pq = (PriorityQueue*)malloc(sizeof(PriorityQueue));
-    pq->nodes = (PathNode**)malloc(capacity * sizeof(PathNode*));
-    pq->size = 0;
-    pq->capacity = capacity;
-    return pq;
-}
+    // Search ID corrente
+    int current_search_id;
 
-static void pq_destroy(PriorityQueue* pq) {
-    if (!pq) return;
-    free(pq->nodes);
-    free(pq);
-}
+    // Dimensioni attuali della finestra attiva
+    int current_width;
+    int current_height;
+    float current_origin_x;
+    float current_origin_z;
+    float current_cell_size;
+    int window_cell_x;       // Prima cella (coordinate globali del livello)
+    int window_cell_z;
+
+    // Layer di navigazione copiati nella finestra (bit per layer, 0 = solo
+    // terreno) e link orientati tra le loro celle
+    unsigned int window_layers;
+    float layer_height[PATH_MAX_LAYERS];
+    WindowLink window_links[MAX_WINDOW_LINKS];
+    int window_link_count;
+
+    // Finestra costruita da search_setup: la query successiva con la stessa
+    // chiave riusa grid[] così com'è (pathfinding_ctx_setup_window la invalida)
+    WindowKey window_key;
+    bool window_key_valid;
+
+    // Peso per valore di grid[] (0 = bloccata, 1 + classe di terreno).
+    // Tutti 1 con costi uniformi: stesso risultato, nessun ramo nel loop.
+    float cell_weight[256];
+    bool weighted;
+
+    // Clearance richiesta dall'agente della query (<= 1: solo walkability).
+    // La finestra considera bloccate le celle più vicine agli ostacoli.
+    int min_clearance;
+
+    // Ricerca a griglia in corso (ripresa da search_expand)
+    PathSearchMode search_mode;
+    int search_goal_idx;     // Indice del goal in grid[] (layer incluso)
+    int search_goal_x;
+    int search_goal_z;
+
+    // Tabella ALT del livello se la ricerca può usarla (A* sul solo
+    // terreno), altrimenti NULL: euristica euclidea
+    const LandmarkMap* landmarks;
+
+    // Open set: binary min-heap con decrease-key, al massimo una entry per
+    // cella, quindi non può superare la finestra
+    HeapEntry heap[MAX_WINDOW_CELLS];
+    int heap_size;
 
-static void pq_swap(PriorityQueue* pq, int i, int j) {
-    PathNode* temp = pq->nodes[i];
-    pq->nodes[i] = pq->nodes[j];
-    pq->nodes[j] = temp;
-    pq->nodes[i]->heap_index = i;
-    pq->nodes[j]->heap_index = j;
-}
+    // Puntatore al livello corrente (per accesso walkmap full-res)
+    struct Level* current_level;
 
-static void pq_heapify_up(PriorityQueue* pq, int index) {
-    while (index > 0) {
-        int parent = (index - 1) / 2;
-        if (pq->nodes[index]->f_cost >= pq->nodes[parent]->f_cost) break;
-        pq_swap(pq, index, parent);
-        index = parent;
-    }
-}
+    // Statistiche delle ricerche eseguite con questo contesto
+    PathfindingStats stats;
+};
 
-static void pq_heapify_down(PriorityQueue* pq, int index) {
-    while (true) {
-        int smallest = index;
-        int left = 2 * index + 1;
-        int right = 2 * index + 2;
+// Contesto del main thread (usato da pathfinding_find_path)
+static PathfindingContext* g_ctx = NULL;
 
-        if (left < pq->size && pq->nodes[left]->f_cost < pq->nodes[smallest]->f_cost) {
-            smallest = left;
-        }
-        if (right < pq->size && pq->nodes[right]->f_cost < pq->nodes[smallest]->f_cost) {
-            smallest = right;
-        }
 
-        if (smallest == index) break;
+// ============================================================================
+// OPEN SET (Binary Min-Heap indicizzato per cella)
+// ============================================================================
 
-        pq_swap(pq, index, smallest);
-        index = smallest;
+static inline void pq_sift_up(PathfindingContext* ctx, int slot, HeapEntry entry) {
+    while (slot > 0) {
+        int parent = (slot - 1) / 2;
+        if (entry.f_cost >= ctx->heap[parent].f_cost) break;
+        ctx->heap[slot] = ctx->heap[parent];
+        ctx->heap_slot[ctx->heap[slot].cell] = slot;
+        slot = parent;
     }
+    ctx->heap[slot] = entry;
+    ctx->heap_slot[entry.cell] = slot;
 }
 
-static void pq_push(PriorityQueue* pq, PathNode* node) {
-    if (pq->size >= pq->capacity) {
-        printf("[Pathfinding] ERROR: Priority queue overflow!\n");
-        return;
+static inline void pq_sift_down(PathfindingContext* ctx, int slot, HeapEntry entry) {
+    int size = ctx->heap_size;
+    while (true) {
+        int child = 2 * slot + 1;
+        if (child >= size) break;
+        if (child + 1 < size && ctx->heap[child + 1].f_cost < ctx->heap[child].f_cost) child++;
+        if (ctx->heap[child].f_cost >= entry.f_cost) break;
+        ctx->heap[slot] = ctx->heap[child];
+        ctx->heap_slot[ctx->heap[slot].cell] = slot;
+        slot = child;
     }
-    node->heap_index = pq->size;
-    pq->nodes[pq->size] = node;
-    pq->size++;
-    pq_heapify_up(pq, pq->size - 1);
+    ctx->heap[slot] = entry;
+    ctx->heap_slot[entry.cell] = slot;
 }
 
-static PathNode* pq_pop(PriorityQueue* pq) {
-    if (pq->size == 0) return NULL;
-    PathNode* min = pq->nodes[0];
-    pq->nodes[0] = pq->nodes[pq->size - 1];
-    pq->nodes[0]->heap_index = 0;
-    pq->size--;
-    if (pq->size > 0) {
-        pq_heapify_down(pq, 0);
-    }
-    return min;
+// Inserisce la cella nell'open set o, se c'è già, ne abbassa f_cost.
+// Una cella chiusa (SLOT_CLOSED) viene riaperta.
+static inline void pq_update(PathfindingContext* ctx, int cell, float f_cost) {
+    int slot = ctx->heap_slot[cell];
+    if (slot < 0) slot = ctx->heap_size++;
+    pq_sift_up(ctx, slot, (HeapEntry){ f_cost, cell });
 }
 
-static void pq_update(PriorityQueue* pq, PathNode* node) {
-    pq_heapify_up(pq, node->heap_index);
+// Estrae la cella con f_cost minimo e la marca chiusa
+static inline int pq_pop(PathfindingContext* ctx) {
+    int cell = ctx->heap[0].cell;
+    ctx->heap_slot[cell] = SLOT_CLOSED;
+    ctx->heap_size--;
+    if (ctx->heap_size > 0) pq_sift_down(ctx, 0, ctx->heap[ctx->heap_size]);
+    return cell;
 }
 
-static bool pq_is_empty(PriorityQueue* pq) {
-    return pq->size == 0;
+static inline bool pq_is_empty(PathfindingContext* ctx) {
+    return ctx->heap_size == 0;
 }
 
+// Nuovo costo per una cella (prima visita o costo migliore): aggiorna lo
+// stato per cella e la cella entra nell'open set con priorità f_cost
+static inline void ctx_open_cell(PathfindingContext* ctx, int idx, bool visited,
+                                 float g_cost, float f_cost, int parent) {
+    if (!visited) {
+        ctx->visited_tag[idx] = ctx->current_search_id;
+        ctx->heap_slot[idx] = SLOT_NONE;
+    }
+    ctx->g_costs[idx] = g_cost;
+    ctx->parent[idx] = parent;
+    pq_update(ctx, idx, f_cost);
+}
 
-typedef struct {
-    // Griglia dati (walkability)
-    uint8_t grid[MAX_GRID_CELLS];
-
-    // Dati per A* (riutilizzati)
-    // Invece di allocare g_costs e closed_set ogni volta:
-    float g_costs[MAX_GRID_CELLS];
-    int visited_tag[MAX_GRID_CELLS]; // Sostituisce il closed_set bitfield
-    //PathNode* node_map[MAX_GRID_CELLS]; // Mappa rapida indice -> puntatore nodo
-
-    // Search ID corrente
-    int current_search_id;
-
-    // Dimensioni attuali della finestra attiva
-    int current_width;
-    int current_height;
-    float current_origin_x;
-    float current_origin_z;
-    float current_cell_size;
-
-    // Binary Heap preallocato
-    PriorityQueue* pq;
-
-    // Puntatore al livello corrente (per accesso walkmap full-res)
-    struct Level* current_level;
-
-} PathfindingContext;
-static PathfindingContext* g_ctx = NULL;
+// Ultima versione assegnata a un pathgrid (crescente: mai riusata)
+static uint32_t g_pathgrid_version = 0;
 
 
 // ============================================================================
@@ -182,6 +215,11 @@ bool pathgrid_init(PathGrid* pg, int width, int height, float cell_size) {
     pg->grid_height = height;
     pg->grid_cell_size = cell_size;
     pg->layer_id = 0;
+    pg->obstacles = NULL;
+    pg->terrain = NULL;
+    pg->clearance = NULL;
+    // Atomico: level_load costruisce i chunk su più thread
+    pg->version = __atomic_add_fetch(&g_pathgrid_version, 1, __ATOMIC_RELAXED);
 
     int grid_size = width * height;
     pg->grid = (uint8_t*)malloc(grid_size * sizeof(uint8_t));
@@ -193,6 +231,14 @@ bool pathgrid_init(PathGrid* pg, int width, int height, float cell_size) {
     // Inizializza tutto come walkable
     memset(pg->grid, 1, grid_size);
 
+    // Copia a bit (righe e colonne: a 64 celle è una parola per riga)
+    if (!bitgrid_init(&pg->walk_bits, width, height, true)) {
+        free(pg->grid);
+        pg->grid = NULL;
+        return false;
+    }
+    bitgrid_fill(&pg->walk_bits, true);
+
     return true;
 }
 
@@ -202,10 +248,58 @@ void pathgrid_cleanup(PathGrid* pg) {
         free(pg->grid);
         pg->grid = NULL;
     }
+    free(pg->obstacles);
+    pg->obstacles = NULL;
+    free(pg->terrain);
+    pg->terrain = NULL;
+    free(pg->clearance);
+    pg->clearance = NULL;
+    bitgrid_cleanup(&pg->walk_bits);
+}
+
+// Distance transform di Chebyshev in due passate (vicini a 8, passo 1: esatta).
+// In ingresso 0 per le celle bloccate e PATH_CLEARANCE_MAX per le altre;
+// oltre i bordi del buffer non ci sono ostacoli.
+static void clearance_transform(uint8_t* dist, int width, int height) {
+    // Passata in avanti: vicini già visitati a sinistra e nella riga sopra
+    for (int z = 0; z < height; z++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* d = &dist[z * width + x];
+            if (*d == 0) continue;
+
+            int best = *d;
+            if (x > 0 && dist[z * width + x - 1] + 1 < best) best = dist[z * width + x - 1] + 1;
+            if (z > 0) {
+                const uint8_t* up = &dist[(z - 1) * width];
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    if (nx >= 0 && nx < width && up[nx] + 1 < best) best = up[nx] + 1;
+                }
+            }
+            *d = (uint8_t)best;
+        }
+    }
+
+    // Passata all'indietro: vicini a destra e nella riga sotto
+    for (int z = height - 1; z >= 0; z--) {
+        for (int x = width - 1; x >= 0; x--) {
+            uint8_t* d = &dist[z * width + x];
+            if (*d == 0) continue;
+
+            int best = *d;
+            if (x < width - 1 && dist[z * width + x + 1] + 1 < best) best = dist[z * width + x + 1] + 1;
+            if (z < height - 1) {
+                const uint8_t* down = &dist[(z + 1) * width];
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    if (nx >= 0 && nx < width && down[nx] + 1 < best) best = down[nx] + 1;
+                }
+            }
+            *d = (uint8_t)best;
+        }
+    }
 }
 
-bool pathgrid_build(PathGrid* pg, unsigned char* walkmap, int walkmap_width, int walkmap_height) {
-    if (!pg || !walkmap) return false;
+bool pathgrid_build(PathGrid* pg, const BitGrid* walk_bits, float walkable_ratio) {
+    if (!pg || !walk_bits || !walk_bits->rows) return false;
 
     // Inizializza pathgrid 64x64
     if (!pathgrid_init(pg, PATHGRID_SIZE, PATHGRID_SIZE, 1.0f)) {
@@ -213,44 +307,47 @@ bool pathgrid_build(PathGrid* pg, unsigned char* walkmap, int walkmap_width, int
     }
 
     // Downsampling con majority voting
-    int sample_size = walkmap_width / PATHGRID_SIZE;
+    int sample_size = walk_bits->width / PATHGRID_SIZE;
     if (sample_size < 1) sample_size = 1;
 
-    float walkable_threshold = 0.90f;  // 90% dei sample devono essere walkable
-
     for (int gz = 0; gz < PATHGRID_SIZE; gz++) {
         for (int gx = 0; gx < PATHGRID_SIZE; gx++) {
-            // Campiona blocco sample_size x sample_size dalla walkmap
+            // Blocco sample_size x sample_size della walkmap, tagliato sul bordo:
+            // popcount sulle parole delle sue righe invece di un pixel per volta
+            int x0 = gx * sample_size, z0 = gz * sample_size;
+            int x1 = x0 + sample_size - 1, z1 = z0 + sample_size - 1;
+            if (x1 >= walk_bits->width) x1 = walk_bits->width - 1;
+            if (z1 >= walk_bits->height) z1 = walk_bits->height - 1;
+
             int walkable_count = 0;
             int total_samples = 0;
-
-            for (int sy = 0; sy < sample_size; sy++) {
-                for (int sx = 0; sx < sample_size; sx++) {
-                    int hires_x = gx * sample_size + sx;
-                    int hires_y = gz * sample_size + sy;
-
-                    // Bounds check
-                    if (hires_x >= walkmap_width || hires_y >= walkmap_height) {
-                        continue;
-                    }
-
-                    int idx = hires_y * walkmap_width + hires_x;
-                    if (walkmap[idx] > 128) {
-                        walkable_count++;
-                    }
-                    total_samples++;
-                }
+            if (x0 <= x1 && z0 <= z1) {
+                walkable_count = bitgrid_count_rect(walk_bits, x0, z0, x1, z1);
+                total_samples = (x1 - x0 + 1) * (z1 - z0 + 1);
             }
 
             // Majority vote con threshold
             float ratio = (total_samples > 0) ? (float)walkable_count / total_samples : 0.0f;
             int grid_idx = gz * PATHGRID_SIZE + gx;
-            pg->grid[grid_idx] = (ratio >= walkable_threshold) ? 1 : 0;
+            pg->grid[grid_idx] = (ratio >= walkable_ratio) ? 1 : 0;
+            bitgrid_set(&pg->walk_bits, gx, gz, pg->grid[grid_idx] != 0);
         }
     }
 
+    // Clearance del solo chunk: il bordo verso i chunk vicini viene corretto
+    // da pathfinding_update_clearance quando tutto il livello è caricato
+    pg->clearance = (uint8_t*)malloc(PATHGRID_SIZE * PATHGRID_SIZE);
+    if (!pg->clearance) {
+        printf("[Pathfinding] ERROR: Failed to allocate clearance map\n");
+        return false;
+    }
+    for (int i = 0; i < PATHGRID_SIZE * PATHGRID_SIZE; i++) {
+        pg->clearance[i] = pg->grid[i] ? PATH_CLEARANCE_MAX : 0;
+    }
+    clearance_transform(pg->clearance, PATHGRID_SIZE, PATHGRID_SIZE);
+
     printf("[Pathfinding] Built pathgrid %dx%d from walkmap %dx%d\n",
-           PATHGRID_SIZE, PATHGRID_SIZE, walkmap_width, walkmap_height);
+           PATHGRID_SIZE, PATHGRID_SIZE, walk_bits->width, walk_bits->height);
 
     return true;
 }
@@ -264,552 +361,2938 @@ bool pathgrid_is_walkable(PathGrid* pg, int grid_x, int grid_z) {
     return pg->grid[idx] != 0;
 }
 
-// Converte coordinate world in coordinate della griglia statica attuale
-static bool ctx_world_to_grid(vec3 world_pos, int* out_x, int* out_z) {
-    // Calcola la posizione locale relativa all'origine della finestra attuale
-    float localX = world_pos[0] - g_ctx->current_origin_x;
-    float localZ = world_pos[2] - g_ctx->current_origin_z;
+bool pathgrid_has_obstacle(PathGrid* pg, int grid_x, int grid_z) {
+    if (!pg || !pg->obstacles) return false;
+    if (grid_x < 0 || grid_x >= pg->grid_width) return false;
+    if (grid_z < 0 || grid_z >= pg->grid_height) return false;
 
-    // Calcola le dimensioni totali in unità world
-    float totalWidth = g_ctx->current_width * g_ctx->current_cell_size;
-    float totalHeight = g_ctx->current_height * g_ctx->current_cell_size;
+    return pg->obstacles->refcount[grid_z * pg->grid_width + grid_x] > 0;
+}
 
-    // Bounds check: se siamo fuori dalla finestra 3x3 (o 2x2, ecc), errore
-    if (localX < 0.0f || localX >= totalWidth || localZ < 0.0f || localZ >= totalHeight) {
+// ============================================================================
+// LEVEL GRID (coordinate di cella globali, tutti i chunk affiancati)
+// ============================================================================
+
+int pathfinding_level_cells_x(struct Level* lvl) {
+    return lvl->chunksCountX * PATHGRID_SIZE;
+}
+
+int pathfinding_level_cells_z(struct Level* lvl) {
+    return lvl->chunksCountZ * PATHGRID_SIZE;
+}
+
+float pathfinding_level_cell_size(struct Level* lvl) {
+    return lvl->chunkSize / PATHGRID_SIZE;
+}
+
+bool pathfinding_level_world_to_cell(struct Level* lvl, vec3 world_pos, int* out_x, int* out_z) {
+    float cell_size = pathfinding_level_cell_size(lvl);
+    float localX = world_pos[0] - lvl->originX;
+    float localZ = world_pos[2] - lvl->originZ;
+
+    if (localX < 0.0f || localX >= lvl->totalSizeX || localZ < 0.0f || localZ >= lvl->totalSizeZ) {
         return false;
     }
 
-    // Conversione in indici griglia
-    *out_x = (int)(localX / g_ctx->current_cell_size);
-    *out_z = (int)(localZ / g_ctx->current_cell_size);
+    int cells_x = pathfinding_level_cells_x(lvl);
+    int cells_z = pathfinding_level_cells_z(lvl);
 
-    // Clamp di sicurezza (per prevenire overflow di array per floating point error)
-    if (*out_x >= g_ctx->current_width) *out_x = g_ctx->current_width - 1;
-    if (*out_z >= g_ctx->current_height) *out_z = g_ctx->current_height - 1;
+    *out_x = (int)(localX / cell_size);
+    *out_z = (int)(localZ / cell_size);
+
+    // Clamp di sicurezza (floating point error sul bordo)
+    if (*out_x >= cells_x) *out_x = cells_x - 1;
+    if (*out_z >= cells_z) *out_z = cells_z - 1;
 
     return true;
 }
 
+void pathfinding_level_cell_to_world(struct Level* lvl, int cell_x, int cell_z, vec3 out_world) {
+    float cell_size = pathfinding_level_cell_size(lvl);
+    out_world[0] = lvl->originX + (cell_x + 0.5f) * cell_size;
+    out_world[2] = lvl->originZ + (cell_z + 0.5f) * cell_size;
+    out_world[1] = level_get_height(lvl, out_world[0], out_world[2]);
+}
+
+bool pathfinding_level_cell_walkable(struct Level* lvl, int cell_x, int cell_z) {
+    if (cell_x < 0 || cell_z < 0) return false;
+
+    int chunkX = cell_x / PATHGRID_SIZE;
+    int chunkZ = cell_z / PATHGRID_SIZE;
+    if (chunkX >= lvl->chunksCountX || chunkZ >= lvl->chunksCountZ) return false;
 
+    struct Terrain* chunk = &lvl->chunks[chunkZ * lvl->chunksCountX + chunkX];
+    if (!chunk->pathgrid.grid) return false;
 
+    return chunk->pathgrid.grid[(cell_z % PATHGRID_SIZE) * PATHGRID_SIZE + (cell_x % PATHGRID_SIZE)] != 0;
+}
 
+void pathfinding_level_copy_walkability(struct Level* lvl, uint8_t* dst) {
+    int cells_x = pathfinding_level_cells_x(lvl);
 
+    for (int cz = 0; cz < lvl->chunksCountZ; cz++) {
+        for (int cx = 0; cx < lvl->chunksCountX; cx++) {
+            struct Terrain* chunk = &lvl->chunks[cz * lvl->chunksCountX + cx];
 
+            for (int z = 0; z < PATHGRID_SIZE; z++) {
+                uint8_t* row = &dst[(cz * PATHGRID_SIZE + z) * cells_x + cx * PATHGRID_SIZE];
+                if (chunk->pathgrid.grid) {
+                    memcpy(row, &chunk->pathgrid.grid[z * PATHGRID_SIZE], PATHGRID_SIZE);
+                } else {
+                    // Chunk non caricato: non camminabile
+                    memset(row, 0, PATHGRID_SIZE);
+                }
+            }
+        }
+    }
+}
 
+uint8_t pathfinding_level_cell_terrain(struct Level* lvl, int cell_x, int cell_z) {
+    if (cell_x < 0 || cell_z < 0) return PATH_TERRAIN_NORMAL;
 
+    int chunkX = cell_x / PATHGRID_SIZE;
+    int chunkZ = cell_z / PATHGRID_SIZE;
+    if (chunkX >= lvl->chunksCountX || chunkZ >= lvl->chunksCountZ) return PATH_TERRAIN_NORMAL;
 
+    struct Terrain* chunk = &lvl->chunks[chunkZ * lvl->chunksCountX + chunkX];
+    if (!chunk->pathgrid.terrain) return PATH_TERRAIN_NORMAL;
 
+    return chunk->pathgrid.terrain[(cell_z % PATHGRID_SIZE) * PATHGRID_SIZE + (cell_x % PATHGRID_SIZE)];
+}
 
 // ============================================================================
-// PATH SMOOTHING (String Pulling)
+// CLEARANCE
 // ============================================================================
 
-// Helper: Controlla Line of Sight tra due vec3 usando la walkmap a piena risoluzione
-static bool check_world_visibility(vec3 start_pos, vec3 end_pos) {
-    if (!g_ctx->current_level) return false;
+uint8_t pathfinding_level_cell_clearance(struct Level* lvl, int cell_x, int cell_z) {
+    if (!pathfinding_level_cell_walkable(lvl, cell_x, cell_z)) return 0;
+
+    struct Terrain* chunk = &lvl->chunks[(cell_z / PATHGRID_SIZE) * lvl->chunksCountX + (cell_x / PATHGRID_SIZE)];
+    if (!chunk->pathgrid.clearance) return PATH_CLEARANCE_MAX;
+
+    return chunk->pathgrid.clearance[(cell_z % PATHGRID_SIZE) * PATHGRID_SIZE + (cell_x % PATHGRID_SIZE)];
+}
+
+int pathfinding_clearance_for_radius(struct Level* lvl, float radius) {
+    if (!lvl || radius <= 0.0f) return 1;
+
+    // Ostacolo a distanza d (Chebyshev): il suo bordo è a d - 0.5 celle dal centro
+    int clearance = (int)ceilf(radius / pathfinding_level_cell_size(lvl) + 0.5f);
+    if (clearance < 1) clearance = 1;
+    if (clearance > PATH_CLEARANCE_MAX) clearance = PATH_CLEARANCE_MAX;
+    return clearance;
+}
+
+void pathfinding_update_clearance(struct Level* lvl, int x0, int z0, int x1, int z1) {
+    if (!lvl || !lvl->chunks) return;
+
+    int cells_x = pathfinding_level_cells_x(lvl);
+    int cells_z = pathfinding_level_cells_z(lvl);
+
+    // Celle aggiornate: quelle la cui distanza può dipendere dal rettangolo
+    int ux0 = x0 - PATH_CLEARANCE_MAX, uz0 = z0 - PATH_CLEARANCE_MAX;
+    int ux1 = x1 + PATH_CLEARANCE_MAX, uz1 = z1 + PATH_CLEARANCE_MAX;
+    if (ux0 < 0) ux0 = 0;
+    if (uz0 < 0) uz0 = 0;
+    if (ux1 >= cells_x) ux1 = cells_x - 1;
+    if (uz1 >= cells_z) uz1 = cells_z - 1;
+    if (ux0 > ux1 || uz0 > uz1) return;
+
+    // Celle lette: tutti gli ostacoli entro PATH_CLEARANCE_MAX da quelle aggiornate
+    int rx0 = ux0 - PATH_CLEARANCE_MAX, rz0 = uz0 - PATH_CLEARANCE_MAX;
+    int rx1 = ux1 + PATH_CLEARANCE_MAX, rz1 = uz1 + PATH_CLEARANCE_MAX;
+    if (rx0 < 0) rx0 = 0;
+    if (rz0 < 0) rz0 = 0;
+    if (rx1 >= cells_x) rx1 = cells_x - 1;
+    if (rz1 >= cells_z) rz1 = cells_z - 1;
+
+    int width = rx1 - rx0 + 1;
+    int height = rz1 - rz0 + 1;
+    uint8_t* dist = (uint8_t*)malloc(width * height);
+    if (!dist) {
+        printf("[Pathfinding] ERROR: Failed to allocate clearance buffer\n");
+        return;
+    }
+
+    for (int z = 0; z < height; z++) {
+        for (int x = 0; x < width; x++) {
+            dist[z * width + x] = pathfinding_level_cell_walkable(lvl, rx0 + x, rz0 + z) ? PATH_CLEARANCE_MAX : 0;
+        }
+    }
+    clearance_transform(dist, width, height);
 
-    // Calcola direzione e distanza
-    float dx = end_pos[0] - start_pos[0];
-    float dz = end_pos[2] - start_pos[2];
-    float distance = sqrtf(dx * dx + dz * dz);
+    for (int z = uz0; z <= uz1; z++) {
+        for (int x = ux0; x <= ux1; x++) {
+            PathGrid* pg = &lvl->chunks[(z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE)].pathgrid;
+            if (!pg->clearance) continue;
 
-    // Se i punti sono molto vicini, sono visibili
-    if (distance < 0.1f) return true;
+            uint8_t* cell = &pg->clearance[(z % PATHGRID_SIZE) * PATHGRID_SIZE + (x % PATHGRID_SIZE)];
+            uint8_t value = dist[(z - rz0) * width + (x - rx0)];
+            if (*cell == value) continue;
 
-    // Step size: abbastanza piccolo da non saltare ostacoli nella walkmap
-    // La walkmap tipicamente ha risoluzione ~6cm per pixel (64m / 1024px)
-    // Usiamo 0.1m (10cm) come step per sicurezza
-    float step_size = 0.2f;
-    int num_steps = (int)(distance / step_size) + 1;
+            // Le ricerche degli agenti larghi leggono la clearance: invalida la path cache
+            *cell = value;
+            pg->version = ++g_pathgrid_version;
+        }
+    }
 
-    // Raymarching lungo la linea
-    for (int i = 0; i <= num_steps; i++) {
-        float t = (float)i / (float)num_steps;
-        float checkX = start_pos[0] + dx * t;
-        float checkZ = start_pos[2] + dz * t;
+    free(dist);
+}
 
-        // Controlla walkability sulla walkmap a piena risoluzione
-        if (!level_is_walkable(g_ctx->current_level, checkX, checkZ)) {
-            return false; // Ostacolo trovato!
+// Somma delle versioni dei pathgrid di un rettangolo di chunk: le versioni
+// sono uniche e crescenti, quindi la somma cambia a ogni modifica
+static uint64_t level_chunks_version(struct Level* lvl, int chunk_x, int chunk_z, int chunks_x, int chunks_z) {
+    uint64_t sum = 0;
+    for (int cz = chunk_z; cz < chunk_z + chunks_z; cz++) {
+        if (cz < 0 || cz >= lvl->chunksCountZ) continue;
+        for (int cx = chunk_x; cx < chunk_x + chunks_x; cx++) {
+            if (cx < 0 || cx >= lvl->chunksCountX) continue;
+            struct Terrain* chunk = &lvl->chunks[cz * lvl->chunksCountX + cx];
+            if (chunk->pathgrid.grid) sum += chunk->pathgrid.version;
         }
     }
+    return sum;
+}
+
+// ============================================================================
+// WALKABILITY EDITS
+// ============================================================================
 
+typedef struct {
+    PathfindingChangeCallback callback;
+    void* user;
+} ChangeListener;
+
+static ChangeListener g_listeners[PATHFINDING_MAX_CHANGE_LISTENERS];
+static int g_listener_count = 0;
+
+bool pathfinding_add_change_listener(PathfindingChangeCallback callback, void* user) {
+    if (!callback) return false;
+    if (g_listener_count >= PATHFINDING_MAX_CHANGE_LISTENERS) {
+        printf("[Pathfinding] ERROR: Too many change listeners\n");
+        return false;
+    }
+    g_listeners[g_listener_count].callback = callback;
+    g_listeners[g_listener_count].user = user;
+    g_listener_count++;
     return true;
 }
 
+void pathfinding_remove_change_listener(PathfindingChangeCallback callback, void* user) {
+    for (int i = 0; i < g_listener_count; i++) {
+        if (g_listeners[i].callback == callback && g_listeners[i].user == user) {
+            g_listeners[i] = g_listeners[--g_listener_count];
+            return;
+        }
+    }
+}
+
+// Rettangoli cambiati non ancora notificati (di un solo livello)
+typedef struct {
+    int x0, z0, x1, z1;
+} ChangeRect;
 
+static struct Level* g_pending_level = NULL;
+static ChangeRect g_pending[PATHFINDING_MAX_PENDING_CHANGES];
+static int g_pending_count = 0;
 
-Path* path_create(int initial_capacity) {
-    Path* path = (Path*)malloc(sizeof(Path));
-    if (!path) return NULL;
+static int rect_area(int x0, int z0, int x1, int z1) {
+    return (x1 - x0 + 1) * (z1 - z0 + 1);
+}
 
-    path->waypoint_count = 0;
-    path->capacity = initial_capacity;
-    path->layer_id = 0;
-    path->waypoints = (vec3*)malloc(initial_capacity * sizeof(vec3));
+static void rect_merge(ChangeRect* dst, const ChangeRect* src) {
+    if (src->x0 < dst->x0) dst->x0 = src->x0;
+    if (src->z0 < dst->z0) dst->z0 = src->z0;
+    if (src->x1 > dst->x1) dst->x1 = src->x1;
+    if (src->z1 > dst->z1) dst->z1 = src->z1;
+}
 
-    if (!path->waypoints) {
-        free(path);
-        return NULL;
+static void queue_change(struct Level* lvl, int x0, int z0, int x1, int z1) {
+    if (g_pending_level != lvl) {
+        pathfinding_flush_changes();
+        g_pending_level = lvl;
     }
 
-    return path;
+    // Assorbe i rettangoli che tocca (anche solo per adiacenza); dopo ogni
+    // unione ricomincia, il rettangolo cresciuto può toccarne altri
+    ChangeRect r = { x0, z0, x1, z1 };
+    for (int i = 0; i < g_pending_count;) {
+        ChangeRect* p = &g_pending[i];
+        if (r.x0 <= p->x1 + 1 && p->x0 <= r.x1 + 1 && r.z0 <= p->z1 + 1 && p->z0 <= r.z1 + 1) {
+            rect_merge(&r, p);
+            g_pending[i] = g_pending[--g_pending_count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (g_pending_count < PATHFINDING_MAX_PENDING_CHANGES) {
+        g_pending[g_pending_count++] = r;
+        return;
+    }
+
+    // Lista piena: unisce al rettangolo che cresce meno
+    int best = 0;
+    int best_growth = INT_MAX;
+    for (int i = 0; i < g_pending_count; i++) {
+        ChangeRect u = g_pending[i];
+        rect_merge(&u, &r);
+        int growth = rect_area(u.x0, u.z0, u.x1, u.z1) -
+                     rect_area(g_pending[i].x0, g_pending[i].z0, g_pending[i].x1, g_pending[i].z1);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    rect_merge(&g_pending[best], &r);
 }
 
+int pathfinding_flush_changes(void) {
+    if (g_pending_count == 0) return 0;
 
-void pathfinding_init(void) {
-    g_ctx = (PathfindingContext*)calloc(1, sizeof(PathfindingContext));
-    
-    // Prealloca la Priority Queue al massimo
-    g_ctx->pq = pq_create(MAX_HEAP_SIZE);
-    
-    // Inizializza il search ID
-    g_ctx->current_search_id = 0;
-    
-    // Inizializza array visited a 0
-    memset(g_ctx->visited_tag, 0, sizeof(g_ctx->visited_tag));
+    // Copia locale: un listener può rientrare in una query (e quindi qui)
+    ChangeRect rects[PATHFINDING_MAX_PENDING_CHANGES];
+    struct Level* lvl = g_pending_level;
+    int count = g_pending_count;
+    memcpy(rects, g_pending, count * sizeof(ChangeRect));
+    g_pending_count = 0;
+    g_pending_level = NULL;
 
-    // Aumenta il pool di nodi! 
-    // NOTA: 8192 nodi sono pochi per una griglia 192x192 (36k celle).
-    // Se il percorso è complesso, A* potrebbe esplorare quasi tutte le celle.
-    // Suggerisco di aumentare MAX_PATH_NODES almeno a 16384 o 32768
-    
-    printf("[Pathfinding] Static context initialized (Max grid: %dx%d)\n", 
-           TEMP_GRID_WIDTH, TEMP_GRID_HEIGHT);
+    for (int r = 0; r < count; r++) {
+        for (int i = 0; i < g_listener_count; i++) {
+            g_listeners[i].callback(lvl, rects[r].x0, rects[r].z0, rects[r].x1, rects[r].z1, g_listeners[i].user);
+        }
+    }
+    return count;
 }
 
-// Restituisce true se successo, false se errore
-static bool setup_static_grid(struct Level* lvl, vec3 start, vec3 goal) {
-        // Calcola bounding box in coordinate world
-    float minX = fminf(start[0], goal[0]);
-    float maxX = fmaxf(start[0], goal[0]);
-    float minZ = fminf(start[2], goal[2]);
-    float maxZ = fmaxf(start[2], goal[2]);
+void pathfinding_discard_changes(struct Level* lvl) {
+    if (g_pending_level == lvl) {
+        g_pending_count = 0;
+        g_pending_level = NULL;
+    }
+}
 
-    // Espandi ai bordi dei chunk (arrotonda ai chunk interi)
-    float chunkSize = lvl->chunkSize;
+// Aggiorna il blocco della walkmap ad alta risoluzione coperto da una cella,
+// così smoothing e level_is_walkable vedono la stessa modifica
+static void walkmap_set_block(struct Terrain* chunk, int grid_x, int grid_z, bool walkable) {
+    BitGrid* bits = &chunk->walkBits;
+    if (!bits->rows) return;
 
-    // Trova indici chunk
-    int startChunkX = (int)floorf((minX - lvl->originX) / chunkSize);
-    int startChunkZ = (int)floorf((minZ - lvl->originZ) / chunkSize);
-    int endChunkX = (int)floorf((maxX - lvl->originX) / chunkSize);
-    int endChunkZ = (int)floorf((maxZ - lvl->originZ) / chunkSize);
-    
-    // ... clamp indici chunk ...
+    int sample_size = bits->width / PATHGRID_SIZE;
+    if (sample_size < 1) sample_size = 1;
 
-    int chunksX = endChunkX - startChunkX + 1;
-    int chunksZ = endChunkZ - startChunkZ + 1;
-    if (chunksX > MAX_CHUNKS_X) chunksX = MAX_CHUNKS_X;
-    if (chunksZ > MAX_CHUNKS_Z) chunksZ = MAX_CHUNKS_Z;
+    int x0 = grid_x * sample_size, z0 = grid_z * sample_size;
+    if (x0 >= bits->width || z0 >= bits->height) return;
+    int x1 = x0 + sample_size - 1, z1 = z0 + sample_size - 1;
+    if (x1 >= bits->width) x1 = bits->width - 1;
+    if (z1 >= bits->height) z1 = bits->height - 1;
 
-    // Imposta metadati nel contesto statico
-    g_ctx->current_width = chunksX * PATHGRID_SIZE;
-    g_ctx->current_height = chunksZ * PATHGRID_SIZE;
-    g_ctx->current_origin_x = lvl->originX + startChunkX * lvl->chunkSize;
-    g_ctx->current_origin_z = lvl->originZ + startChunkZ * lvl->chunkSize;
-    g_ctx->current_cell_size = lvl->chunkSize / PATHGRID_SIZE;
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            bitgrid_set(bits, x, z, walkable);
+        }
+    }
+    bitgrid_update_blocks(&chunk->walkBlocks, bits, TERRAIN_WALK_BLOCK, x0, z0, x1, z1);
+}
 
-    // Incrementa Search ID per invalidare i dati della ricerca precedente
-    g_ctx->current_search_id++;
-    if (g_ctx->current_search_id == 0) {
-        // Gestione overflow (rarissimo): resetta tutto
-        memset(g_ctx->visited_tag, 0, sizeof(g_ctx->visited_tag));
-        g_ctx->current_search_id = 1;
+int pathfinding_set_cells_walkable(struct Level* lvl, int x0, int z0, int x1, int z1, bool walkable) {
+    if (!lvl || !lvl->chunks) return 0;
+
+    // Normalizza e limita al livello
+    if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+    if (z0 > z1) { int t = z0; z0 = z1; z1 = t; }
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= pathfinding_level_cells_x(lvl)) x1 = pathfinding_level_cells_x(lvl) - 1;
+    if (z1 >= pathfinding_level_cells_z(lvl)) z1 = pathfinding_level_cells_z(lvl) - 1;
+    if (x0 > x1 || z0 > z1) return 0;
+
+    int changed = 0;
+    uint8_t value = walkable ? 1 : 0;
+
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            struct Terrain* chunk = &lvl->chunks[(z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE)];
+            if (!chunk->pathgrid.grid) continue;
+
+            int gx = x % PATHGRID_SIZE;
+            int gz = z % PATHGRID_SIZE;
+            int cell_idx = gz * PATHGRID_SIZE + gx;
+
+            // Sotto un ostacolo dinamico cambia solo la walkability statica,
+            // ripristinata quando l'ostacolo viene rimosso
+            PathObstacleLayer* obstacles = chunk->pathgrid.obstacles;
+            if (obstacles && obstacles->refcount[cell_idx] > 0) {
+                obstacles->base[cell_idx] = value;
+                walkmap_set_block(chunk, gx, gz, walkable);
+                continue;
+            }
+
+            uint8_t* cell = &chunk->pathgrid.grid[cell_idx];
+            if (*cell == value) continue;
+
+            *cell = value;
+            bitgrid_set(&chunk->pathgrid.walk_bits, gx, gz, walkable);
+            chunk->pathgrid.version = ++g_pathgrid_version;
+            walkmap_set_block(chunk, gx, gz, walkable);
+            changed++;
+        }
     }
 
-    // Copia i dati dai chunk alla grid statica
-    // NOTA: Qui non serve memset a 0 della grid se copiamo tutto, 
-    // ma se ci sono "buchi" (chunk mancanti) bisogna fare attenzione.
-    
-    for (int cz = 0; cz < chunksZ; cz++) {
-        for (int cx = 0; cx < chunksX; cx++) {
-             int chunkIdxX = startChunkX + cx;
-            int chunkIdxZ = startChunkZ + cz;
+    if (changed > 0) {
+        pathfinding_update_clearance(lvl, x0, z0, x1, z1);
+        queue_change(lvl, x0, z0, x1, z1);
+    }
+
+    return changed;
+}
+
+bool pathfinding_set_cell_walkable(struct Level* lvl, int cell_x, int cell_z, bool walkable) {
+    return pathfinding_set_cells_walkable(lvl, cell_x, cell_z, cell_x, cell_z, walkable) > 0;
+}
+
+int pathfinding_set_cells_terrain(struct Level* lvl, int x0, int z0, int x1, int z1, uint8_t terrain_class) {
+    if (!lvl || !lvl->chunks) return 0;
+    if (terrain_class >= PATH_TERRAIN_CLASSES) {
+        printf("[Pathfinding] ERROR: Invalid terrain class %d\n", terrain_class);
+        return 0;
+    }
+
+    // Normalizza e limita al livello
+    if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+    if (z0 > z1) { int t = z0; z0 = z1; z1 = t; }
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= pathfinding_level_cells_x(lvl)) x1 = pathfinding_level_cells_x(lvl) - 1;
+    if (z1 >= pathfinding_level_cells_z(lvl)) z1 = pathfinding_level_cells_z(lvl) - 1;
+    if (x0 > x1 || z0 > z1) return 0;
+
+    int changed = 0;
+
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            PathGrid* pg = &lvl->chunks[(z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE)].pathgrid;
+            if (!pg->grid) continue;
+
+            // Layer allocato alla prima classe diversa da NORMAL
+            if (!pg->terrain) {
+                if (terrain_class == PATH_TERRAIN_NORMAL) continue;
+                pg->terrain = (uint8_t*)calloc(PATHGRID_SIZE * PATHGRID_SIZE, sizeof(uint8_t));
+                if (!pg->terrain) {
+                    printf("[Pathfinding] ERROR: Failed to allocate terrain layer\n");
+                    return changed;
+                }
+            }
+
+            uint8_t* cell = &pg->terrain[(z % PATHGRID_SIZE) * PATHGRID_SIZE + (x % PATHGRID_SIZE)];
+            if (*cell == terrain_class) continue;
+
+            *cell = terrain_class;
+            pg->version = ++g_pathgrid_version;
+            changed++;
+        }
+    }
+
+    return changed;
+}
+
+// ============================================================================
+// DYNAMIC OBSTACLES
+// ============================================================================
+
+PathFootprint pathfinding_footprint_circle(vec3 center, float radius) {
+    PathFootprint fp = {0};
+    fp.shape = PATH_FOOTPRINT_CIRCLE;
+    fp.center_x = center[0];
+    fp.center_z = center[2];
+    fp.radius = radius;
+    return fp;
+}
+
+PathFootprint pathfinding_footprint_rect(vec3 center, float half_x, float half_z) {
+    PathFootprint fp = {0};
+    fp.shape = PATH_FOOTPRINT_RECT;
+    fp.center_x = center[0];
+    fp.center_z = center[2];
+    fp.half_x = half_x;
+    fp.half_z = half_z;
+    return fp;
+}
+
+PathFootprint pathfinding_footprint_obb(vec3 center, float half_x, float half_z, float angle) {
+    PathFootprint fp = pathfinding_footprint_rect(center, half_x, half_z);
+    fp.shape = PATH_FOOTPRINT_OBB;
+    fp.angle = angle;
+    return fp;
+}
+
+// Semi-estensione world del rettangolo allineato agli assi che contiene il footprint
+static void footprint_extent(const PathFootprint* fp, float* out_ex, float* out_ez) {
+    if (fp->shape == PATH_FOOTPRINT_CIRCLE) {
+        *out_ex = *out_ez = fp->radius;
+    } else if (fp->shape == PATH_FOOTPRINT_OBB) {
+        float c = fabsf(cosf(fp->angle)), s = fabsf(sinf(fp->angle));
+        *out_ex = c * fp->half_x + s * fp->half_z;
+        *out_ez = s * fp->half_x + c * fp->half_z;
+    } else {
+        *out_ex = fp->half_x;
+        *out_ez = fp->half_z;
+    }
+}
+
+static bool footprint_contains(const PathFootprint* fp, float x, float z) {
+    float dx = x - fp->center_x;
+    float dz = z - fp->center_z;
+
+    if (fp->shape == PATH_FOOTPRINT_CIRCLE) {
+        return dx * dx + dz * dz <= fp->radius * fp->radius;
+    }
+    if (fp->shape == PATH_FOOTPRINT_OBB) {
+        // Punto negli assi locali del rettangolo
+        float c = cosf(fp->angle), s = sinf(fp->angle);
+        float lx = dx * c + dz * s;
+        float lz = -dx * s + dz * c;
+        dx = lx;
+        dz = lz;
+    }
+    return fabsf(dx) <= fp->half_x && fabsf(dz) <= fp->half_z;
+}
+
+// Aggiunge (delta = +1) o toglie (delta = -1) un footprint dall'overlay.
+// Visita solo le celle del rettangolo che lo contiene.
+static int obstacle_apply(struct Level* lvl, const PathFootprint* fp, int delta) {
+    if (!lvl || !lvl->chunks || !fp) return 0;
+
+    int cells_x = pathfinding_level_cells_x(lvl);
+    int cells_z = pathfinding_level_cells_z(lvl);
+    float cell_size = pathfinding_level_cell_size(lvl);
+
+    // Cella del centro, sempre coperta (footprint più piccoli di una cella)
+    vec3 center = { fp->center_x, 0.0f, fp->center_z };
+    int center_x, center_z;
+    if (!pathfinding_level_world_to_cell(lvl, center, &center_x, &center_z)) return 0;
+
+    float ex, ez;
+    footprint_extent(fp, &ex, &ez);
+    int x0 = (int)floorf((fp->center_x - ex - lvl->originX) / cell_size);
+    int z0 = (int)floorf((fp->center_z - ez - lvl->originZ) / cell_size);
+    int x1 = (int)floorf((fp->center_x + ex - lvl->originX) / cell_size);
+    int z1 = (int)floorf((fp->center_z + ez - lvl->originZ) / cell_size);
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= cells_x) x1 = cells_x - 1;
+    if (z1 >= cells_z) z1 = cells_z - 1;
+
+    int changed = 0;
+    int skipped = 0;
+    int cx0 = x1, cz0 = z1, cx1 = x0, cz1 = z0;   // Rettangolo delle celle cambiate
+
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            if (x != center_x || z != center_z) {
+                float wx = lvl->originX + (x + 0.5f) * cell_size;
+                float wz = lvl->originZ + (z + 0.5f) * cell_size;
+                if (!footprint_contains(fp, wx, wz)) continue;
+            }
+
+            PathGrid* pg = &lvl->chunks[(z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE)].pathgrid;
+            if (!pg->grid) continue;
+
+            // Overlay allocato al primo ostacolo del chunk
+            if (!pg->obstacles) {
+                if (delta < 0) { skipped++; continue; }
+                pg->obstacles = (PathObstacleLayer*)calloc(1, sizeof(PathObstacleLayer));
+                if (!pg->obstacles) {
+                    printf("[Pathfinding] ERROR: Failed to allocate obstacle layer\n");
+                    return changed;
+                }
+            }
+
+            int cell_idx = (z % PATHGRID_SIZE) * PATHGRID_SIZE + (x % PATHGRID_SIZE);
+            uint8_t* count = &pg->obstacles->refcount[cell_idx];
+            uint8_t* cell = &pg->grid[cell_idx];
+
+            if (delta > 0) {
+                if (*count == UINT8_MAX) { skipped++; continue; }
+                if ((*count)++ > 0) continue;
+
+                // Primo ostacolo sulla cella: salva la walkability statica
+                pg->obstacles->base[cell_idx] = *cell;
+                if (*cell == 0) continue;
+                *cell = 0;
+            } else {
+                if (*count == 0) { skipped++; continue; }
+                if (--(*count) > 0) continue;
+
+                // Ultimo ostacolo rimosso: torna la walkability statica
+                *cell = pg->obstacles->base[cell_idx];
+                if (*cell == 0) continue;
+            }
+
+            bitgrid_set(&pg->walk_bits, x % PATHGRID_SIZE, z % PATHGRID_SIZE, *cell != 0);
+            pg->version = ++g_pathgrid_version;
+            changed++;
+            if (x < cx0) cx0 = x;
+            if (x > cx1) cx1 = x;
+            if (z < cz0) cz0 = z;
+            if (z > cz1) cz1 = z;
+        }
+    }
+
+    if (skipped > 0) {
+        printf("[Pathfinding] WARNING: %s skipped %d cells (%s)\n",
+               delta > 0 ? "Obstacle stamp" : "Obstacle unstamp", skipped,
+               delta > 0 ? "too many overlapping obstacles" : "not stamped");
+    }
+
+    if (changed > 0) {
+        pathfinding_update_clearance(lvl, cx0, cz0, cx1, cz1);
+        queue_change(lvl, cx0, cz0, cx1, cz1);
+    }
+
+    return changed;
+}
+
+int pathfinding_stamp_obstacle(struct Level* lvl, const PathFootprint* footprint) {
+    return obstacle_apply(lvl, footprint, +1);
+}
+
+int pathfinding_unstamp_obstacle(struct Level* lvl, const PathFootprint* footprint) {
+    return obstacle_apply(lvl, footprint, -1);
+}
+
+// Converte coordinate world in coordinate della griglia statica attuale
+static bool ctx_world_to_grid(PathfindingContext* ctx, vec3 world_pos, int* out_x, int* out_z) {
+    // Calcola la posizione locale relativa all'origine della finestra attuale
+    float localX = world_pos[0] - ctx->current_origin_x;
+    float localZ = world_pos[2] - ctx->current_origin_z;
+
+    // Calcola le dimensioni totali in unità world
+    float totalWidth = ctx->current_width * ctx->current_cell_size;
+    float totalHeight = ctx->current_height * ctx->current_cell_size;
+
+    // Bounds check: se siamo fuori dalla finestra 3x3 (o 2x2, ecc), errore
+    if (localX < 0.0f || localX >= totalWidth || localZ < 0.0f || localZ >= totalHeight) {
+        return false;
+    }
+
+    // Conversione in indici griglia
+    *out_x = (int)(localX / ctx->current_cell_size);
+    *out_z = (int)(localZ / ctx->current_cell_size);
+
+    // Clamp di sicurezza (per prevenire overflow di array per floating point error)
+    if (*out_x >= ctx->current_width) *out_x = ctx->current_width - 1;
+    if (*out_z >= ctx->current_height) *out_z = ctx->current_height - 1;
+
+    return true;
+}
+
+
+
+
+
+
+
+
+
+
+
+// ============================================================================
+// PATH SMOOTHING (String Pulling)
+// ============================================================================
+
+// Pixel della walk mask per lato di chunk nella quantizzazione di
+// sample_walkability (u * (gridWidth - 1)): i chunk si affiancano ogni
+// pitch pixel. 0 se nessun chunk ha la maschera (tutto camminabile)
+static int walkmap_pitch(struct Level* lvl) {
+    for (int i = 0; i < lvl->chunksCountX * lvl->chunksCountZ; i++) {
+        if (lvl->chunks[i].walkBits.rows) return lvl->chunks[i].walkBits.width - 1;
+    }
+    return 0;
+}
+
+// Pixel globali x0..x1 della riga z tutti camminabili: una maschera per
+// parola, spezzata solo sui bordi dei chunk
+static bool walkmap_row_clear(struct Level* lvl, int pitch, int z, int x0, int x1) {
+    int chunkZ = z / pitch;
+    int local_z = z % pitch;
+
+    while (x0 <= x1) {
+        int chunkX = x0 / pitch;
+        int end = (chunkX + 1) * pitch - 1;
+        if (end > x1) end = x1;
+
+        const BitGrid* bits = &lvl->chunks[chunkZ * lvl->chunksCountX + chunkX].walkBits;
+        if (bits->rows && !bitgrid_row_clear(bits, local_z, x0 - chunkX * pitch, end - chunkX * pitch)) {
+            return false;
+        }
+        x0 = end + 1;
+    }
+    return true;
+}
+
+// Bresenham sui pixel globali della walk mask. Le righe (o colonne) fino al
+// bordo del blocco corrente vengono saltate insieme se i loro tratti cadono
+// in blocchi tutti liberi (walkBlocks); altrimenti si verificano i pixel:
+// un tratto orizzontale è una maschera su una parola, uno verticale un bit
+// per riga (la walk mask non ha copia per colonne)
+static bool walkmap_line_clear(struct Level* lvl, int pitch, int px0, int pz0, int px1, int pz1) {
+    BitLineRuns it;
+    int line, a, b;
+    bitline_begin(&it, px0, pz0, px1, pz1);
+
+    while (!it.done) {
+        // Tratti fino al bordo del blocco sull'asse minore (mai oltre il chunk)
+        int chunk_minor = it.minor / pitch;
+        int local_minor = it.minor % pitch;
+        int in_block = local_minor % TERRAIN_WALK_BLOCK;
+        int runs = it.step_minor > 0 ? TERRAIN_WALK_BLOCK - in_block : in_block + 1;
+        if (runs > pitch - local_minor) runs = pitch - local_minor;
+        int runs_left = bitline_runs_left(&it);
+        if (runs > runs_left) runs = runs_left;
+
+        int last = bitline_runs_end(&it, runs);
+        int lo = it.major < last ? it.major : last;
+        int hi = it.major < last ? last : it.major;
+        int chunk_major = lo / pitch;
+
+        if (hi / pitch == chunk_major) {
+            int chunkX = it.x_major ? chunk_major : chunk_minor;
+            int chunkZ = it.x_major ? chunk_minor : chunk_major;
+            struct Terrain* chunk = &lvl->chunks[chunkZ * lvl->chunksCountX + chunkX];
+
+            // Senza maschera il chunk è tutto camminabile
+            if (!chunk->walkBits.rows) {
+                bitline_skip(&it, runs);
+                continue;
+            }
+            if (chunk->walkBlocks.rows) {
+                int block_minor = local_minor / TERRAIN_WALK_BLOCK;
+                int block_lo = (lo - chunk_major * pitch) / TERRAIN_WALK_BLOCK;
+                int block_hi = (hi - chunk_major * pitch) / TERRAIN_WALK_BLOCK;
+                bool full = it.x_major ? bitgrid_row_clear(&chunk->walkBlocks, block_minor, block_lo, block_hi)
+                                       : bitgrid_col_clear(&chunk->walkBlocks, block_minor, block_lo, block_hi);
+                if (full) {
+                    bitline_skip(&it, runs);
+                    continue;
+                }
+            }
+        }
+
+        for (int r = 0; r < runs && bitline_next(&it, &line, &a, &b); r++) {
+            if (it.x_major) {
+                if (!walkmap_row_clear(lvl, pitch, line, a, b)) return false;
+            } else {
+                for (int z = a; z <= b; z++) {
+                    if (!walkmap_row_clear(lvl, pitch, z, line, line)) return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Celle attraversate dal segmento (tutte, anche quelle toccate solo di
+// spigolo): ostacoli dinamici, che la walk mask non contiene, e clearance
+// minima per gli agenti larghi
+static bool cells_line_clear(struct Level* lvl, vec3 start_pos, vec3 end_pos,
+                             int x, int z, int x1, int z1, int min_clearance) {
+    float cell_size = pathfinding_level_cell_size(lvl);
+    float fx = (start_pos[0] - lvl->originX) / cell_size;
+    float fz = (start_pos[2] - lvl->originZ) / cell_size;
+    float dx = (end_pos[0] - lvl->originX) / cell_size - fx;
+    float dz = (end_pos[2] - lvl->originZ) / cell_size - fz;
+
+    // Amanatides-Woo: t al prossimo bordo di cella su ciascun asse
+    int sx = dx > 0.0f ? 1 : -1;
+    int sz = dz > 0.0f ? 1 : -1;
+    float delta_x = dx != 0.0f ? fabsf(1.0f / dx) : FLT_MAX;
+    float delta_z = dz != 0.0f ? fabsf(1.0f / dz) : FLT_MAX;
+    float next_x = dx != 0.0f ? (dx > 0.0f ? x + 1 - fx : fx - x) * delta_x : FLT_MAX;
+    float next_z = dz != 0.0f ? (dz > 0.0f ? z + 1 - fz : fz - z) * delta_z : FLT_MAX;
+
+    // Limite di passi contro gli errori di arrotondamento vicino agli spigoli
+    int steps = abs(x1 - x) + abs(z1 - z);
+    for (int i = 0; i <= steps; i++) {
+        PathGrid* pg = &lvl->chunks[(z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE)].pathgrid;
+        int idx = (z % PATHGRID_SIZE) * PATHGRID_SIZE + (x % PATHGRID_SIZE);
+        if (pg->obstacles && pg->obstacles->refcount[idx] > 0) return false;
+        if (min_clearance > 1 && (!pg->clearance || pg->clearance[idx] < min_clearance)) return false;
+
+        if (x == x1 && z == z1) break;
+        if (next_x < next_z) {
+            if (x == x1) break;
+            x += sx;
+            next_x += delta_x;
+        } else {
+            if (z == z1) break;
+            z += sz;
+            next_z += delta_z;
+        }
+    }
+    return true;
+}
+
+// Helper: Controlla Line of Sight tra due vec3 usando la walkmap a piena risoluzione
+// min_clearance > 1: ogni cella attraversata deve anche avere clearance sufficiente
+//
+// Tutti i pixel della walk mask lungo l'asse principale (Bresenham), non più
+// campioni ogni 0.2m che potevano saltare un muro sottile, verificati a
+// parole intere e saltando i blocchi tutti liberi
+static bool check_world_visibility(struct Level* lvl, vec3 start_pos, vec3 end_pos, int min_clearance) {
+    if (!lvl || !lvl->chunks) return false;
+
+    // Estremi fuori dal livello: nessun chunk da attraversare
+    int cell_x0, cell_z0, cell_x1, cell_z1;
+    if (!pathfinding_level_world_to_cell(lvl, start_pos, &cell_x0, &cell_z0) ||
+        !pathfinding_level_world_to_cell(lvl, end_pos, &cell_x1, &cell_z1)) {
+        return false;
+    }
+
+    int pitch = walkmap_pitch(lvl);
+    if (pitch > 0) {
+        float scale = pitch / lvl->chunkSize;
+        int max_x = lvl->chunksCountX * pitch - 1;
+        int max_z = lvl->chunksCountZ * pitch - 1;
+        int px0 = (int)((start_pos[0] - lvl->originX) * scale);
+        int pz0 = (int)((start_pos[2] - lvl->originZ) * scale);
+        int px1 = (int)((end_pos[0] - lvl->originX) * scale);
+        int pz1 = (int)((end_pos[2] - lvl->originZ) * scale);
+        if (px0 > max_x) px0 = max_x;
+        if (px1 > max_x) px1 = max_x;
+        if (pz0 > max_z) pz0 = max_z;
+        if (pz1 > max_z) pz1 = max_z;
+
+        if (!walkmap_line_clear(lvl, pitch, px0, pz0, px1, pz1)) return false;
+    }
+
+    // Celle: servono solo con un agente largo o con ostacoli nei chunk coperti
+    bool check_cells = min_clearance > 1;
+    int chunk_x0 = (cell_x0 < cell_x1 ? cell_x0 : cell_x1) / PATHGRID_SIZE;
+    int chunk_x1 = (cell_x0 < cell_x1 ? cell_x1 : cell_x0) / PATHGRID_SIZE;
+    int chunk_z0 = (cell_z0 < cell_z1 ? cell_z0 : cell_z1) / PATHGRID_SIZE;
+    int chunk_z1 = (cell_z0 < cell_z1 ? cell_z1 : cell_z0) / PATHGRID_SIZE;
+    for (int cz = chunk_z0; cz <= chunk_z1 && !check_cells; cz++) {
+        for (int cx = chunk_x0; cx <= chunk_x1; cx++) {
+            if (lvl->chunks[cz * lvl->chunksCountX + cx].pathgrid.obstacles) check_cells = true;
+        }
+    }
+
+    return !check_cells ||
+           cells_line_clear(lvl, start_pos, end_pos, cell_x0, cell_z0, cell_x1, cell_z1, min_clearance);
+}
+
+bool pathfinding_level_line_clear(struct Level* lvl, vec3 a, vec3 b, int min_clearance) {
+    return check_world_visibility(lvl, a, b, min_clearance);
+}
+
+
+
+// Intestazione e waypoint dall'arena (vedi pathfinding_arena.h): nessuna
+// malloc a regime
+Path* path_create(int initial_capacity) {
+    return path_arena_alloc_path(initial_capacity);
+}
+
+
+void pathfinding_cost_profile_init(PathCostProfile* profile) {
+    if (!profile) return;
+    for (int i = 0; i < PATH_TERRAIN_CLASSES; i++) profile->weights[i] = 1.0f;
+}
+
+// Tabella dei pesi per le ricerche successive sul contesto (NULL = uniformi)
+static void ctx_set_cost_profile(PathfindingContext* ctx, const PathCostProfile* profile) {
+    ctx->weighted = false;
+    for (int v = 0; v < 256; v++) ctx->cell_weight[v] = 1.0f;
+    if (!profile) return;
+
+    for (int c = 0; c < PATH_TERRAIN_CLASSES; c++) {
+        float w = profile->weights[c] > 1.0f ? profile->weights[c] : 1.0f;
+        ctx->cell_weight[1 + c] = w;
+        if (w != 1.0f) ctx->weighted = true;
+    }
+
+    // Le celle con link verso altri layer pesano come le altre
+    for (int v = 0; v < CELL_LINK; v++) ctx->cell_weight[v | CELL_LINK] = ctx->cell_weight[v];
+}
+
+PathfindingContext* pathfinding_context_create(void) {
+    PathfindingContext* ctx = (PathfindingContext*)calloc(1, sizeof(PathfindingContext));
+    if (!ctx) return NULL;
+
+    // Search ID e visited_tag partono da 0 (calloc)
+    ctx->current_search_id = 0;
+    ctx_set_cost_profile(ctx, NULL);
+
+    return ctx;
+}
+
+void pathfinding_context_destroy(PathfindingContext* ctx) {
+    if (!ctx) return;
+    free(ctx);
+}
+
+void pathfinding_init(void) {
+    if (g_ctx) return;
+
+    g_ctx = pathfinding_context_create();
+    if (!g_ctx) return;
+
+    printf("[Pathfinding] Static context initialized (Max grid: %dx%d)\n", 
+           TEMP_GRID_WIDTH, TEMP_GRID_HEIGHT);
+}
+
+void pathfinding_cleanup(void) {
+    pathfinding_context_destroy(g_ctx);
+    g_ctx = NULL;
+}
+
+// Calcola il rettangolo di chunk che contiene start e goal.
+// Ritorna false se supera la finestra massima (MAX_CHUNKS_X x MAX_CHUNKS_Z)
+static bool compute_chunk_window(struct Level* lvl, vec3 start, vec3 goal,
+                                 int* out_chunk_x, int* out_chunk_z, int* out_chunks_x, int* out_chunks_z) {
+    // Calcola bounding box in coordinate world
+    float minX = fminf(start[0], goal[0]);
+    float maxX = fmaxf(start[0], goal[0]);
+    float minZ = fminf(start[2], goal[2]);
+    float maxZ = fmaxf(start[2], goal[2]);
+
+    // Espandi ai bordi dei chunk (arrotonda ai chunk interi)
+    float chunkSize = lvl->chunkSize;
+
+    // Trova indici chunk
+    int startChunkX = (int)floorf((minX - lvl->originX) / chunkSize);
+    int startChunkZ = (int)floorf((minZ - lvl->originZ) / chunkSize);
+    int endChunkX = (int)floorf((maxX - lvl->originX) / chunkSize);
+    int endChunkZ = (int)floorf((maxZ - lvl->originZ) / chunkSize);
+
+    int chunksX = endChunkX - startChunkX + 1;
+    int chunksZ = endChunkZ - startChunkZ + 1;
+
+    *out_chunk_x = startChunkX;
+    *out_chunk_z = startChunkZ;
+    *out_chunks_x = chunksX > MAX_CHUNKS_X ? MAX_CHUNKS_X : chunksX;
+    *out_chunks_z = chunksZ > MAX_CHUNKS_Z ? MAX_CHUNKS_Z : chunksZ;
+
+    return chunksX <= MAX_CHUNKS_X && chunksZ <= MAX_CHUNKS_Z;
+}
+
+// Impronta dei pesi per classe (0 = uniformi)
+static uint32_t weights_hash(const float* class_weights) {
+    bool weighted = false;
+    uint32_t hash = 2166136261u;
+    for (int c = 0; c < PATH_TERRAIN_CLASSES; c++) {
+        uint32_t bits;
+        memcpy(&bits, &class_weights[c], sizeof(bits));
+        hash = (hash ^ bits) * 16777619u;
+        if (class_weights[c] != 1.0f) weighted = true;
+    }
+    if (!weighted) return 0;
+    return hash ? hash : 1;
+}
+
+// Impronta dei pesi per la chiave della path cache (0 = uniformi)
+static uint32_t ctx_cost_profile_hash(PathfindingContext* ctx) {
+    if (!ctx->weighted) return 0;
+    return weights_hash(&ctx->cell_weight[1]);
+}
+
+// Stessa impronta di ctx_cost_profile_hash dopo ctx_set_cost_profile(profile)
+static uint32_t cost_profile_hash(const PathCostProfile* profile) {
+    if (!profile) return 0;
+
+    float weights[PATH_TERRAIN_CLASSES];
+    for (int c = 0; c < PATH_TERRAIN_CLASSES; c++) {
+        weights[c] = profile->weights[c] > 1.0f ? profile->weights[c] : 1.0f;
+    }
+    return weights_hash(weights);
+}
+
+static bool window_key_equal(const WindowKey* a, const WindowKey* b) {
+    return a->lvl == b->lvl &&
+           a->chunk_x == b->chunk_x && a->chunk_z == b->chunk_z &&
+           a->chunks_x == b->chunks_x && a->chunks_z == b->chunks_z &&
+           a->clearance == b->clearance && a->profile_hash == b->profile_hash &&
+           a->version == b->version;
+}
+
+// Nuovo search ID: invalida g_costs/visited_tag della ricerca precedente
+static void ctx_begin_search(PathfindingContext* ctx) {
+    ctx->current_search_id++;
+    if (ctx->current_search_id == 0) {
+        // Gestione overflow (rarissimo): resetta tutto
+        memset(ctx->visited_tag, 0, sizeof(ctx->visited_tag));
+        ctx->current_search_id = 1;
+    }
+}
+
+// Copia nel contesto i pathgrid del rettangolo di chunk indicato
+bool pathfinding_ctx_setup_window(PathfindingContext* ctx, struct Level* lvl,
+                                  int startChunkX, int startChunkZ, int chunksX, int chunksZ) {
+    if (chunksX < 1 || chunksZ < 1 || chunksX > MAX_CHUNKS_X || chunksZ > MAX_CHUNKS_Z) {
+        return false;
+    }
+
+    // Imposta metadati nel contesto statico
+    ctx->current_width = chunksX * PATHGRID_SIZE;
+    ctx->current_height = chunksZ * PATHGRID_SIZE;
+    ctx->current_origin_x = lvl->originX + startChunkX * lvl->chunkSize;
+    ctx->current_origin_z = lvl->originZ + startChunkZ * lvl->chunkSize;
+    ctx->current_cell_size = lvl->chunkSize / PATHGRID_SIZE;
+    ctx->window_cell_x = startChunkX * PATHGRID_SIZE;
+    ctx->window_cell_z = startChunkZ * PATHGRID_SIZE;
+    ctx->window_layers = 0;
+    ctx->window_link_count = 0;
+    ctx->window_key_valid = false;
+
+    // Incrementa Search ID per invalidare i dati della ricerca precedente
+    ctx_begin_search(ctx);
+
+    // Copia i dati dai chunk alla grid statica
+    // NOTA: Qui non serve memset a 0 della grid se copiamo tutto, 
+    // ma se ci sono "buchi" (chunk mancanti) bisogna fare attenzione.
+    
+    for (int cz = 0; cz < chunksZ; cz++) {
+        for (int cx = 0; cx < chunksX; cx++) {
+             int chunkIdxX = startChunkX + cx;
+            int chunkIdxZ = startChunkZ + cz;
+
+            // Bounds check
+            if (chunkIdxX < 0 || chunkIdxX >= lvl->chunksCountX ||
+                chunkIdxZ < 0 || chunkIdxZ >= lvl->chunksCountZ) {
+                continue;
+            }
+
+            
+            struct Terrain* chunk = &lvl->chunks[chunkIdxZ * lvl->chunksCountX + chunkIdxX];
+            
+            // Calcola offset nella griglia statica (larga TEMP_GRID_WIDTH)
+            int destOffsetX = cx * PATHGRID_SIZE;
+            int destOffsetZ = cz * PATHGRID_SIZE;
+
+            if (chunk && chunk->pathgrid.grid && ctx->weighted && chunk->pathgrid.terrain) {
+                // Ricerca pesata: grid = 1 + classe di terreno (0 resta bloccata)
+                for (int z = 0; z < PATHGRID_SIZE; z++) {
+                    uint8_t* dest = &ctx->grid[(destOffsetZ + z) * TEMP_GRID_WIDTH + destOffsetX];
+                    const uint8_t* src = &chunk->pathgrid.grid[z * PATHGRID_SIZE];
+                    const uint8_t* terrain = &chunk->pathgrid.terrain[z * PATHGRID_SIZE];
+                    for (int x = 0; x < PATHGRID_SIZE; x++) {
+                        dest[x] = src[x] ? (uint8_t)(1 + terrain[x]) : 0;
+                    }
+                }
+            } else if (chunk && chunk->pathgrid.grid) {
+                // Copia riga per riga per mantenere la continuità
+                for (int z = 0; z < PATHGRID_SIZE; z++) {
+                     // Calcola puntatori per memcpy veloce
+                     uint8_t* dest = &ctx->grid[(destOffsetZ + z) * TEMP_GRID_WIDTH + destOffsetX];
+                     uint8_t* src = &chunk->pathgrid.grid[z * PATHGRID_SIZE];
+                     memcpy(dest, src, PATHGRID_SIZE);
+                }
+            } else {
+                // Chunk non caricato? Segna come non camminabile
+                for (int z = 0; z < PATHGRID_SIZE; z++) {
+                    uint8_t* dest = &ctx->grid[(destOffsetZ + z) * TEMP_GRID_WIDTH + destOffsetX];
+                    memset(dest, 0, PATHGRID_SIZE);
+                }
+                continue;
+            }
+
+            // Agente largo: le celle troppo vicine agli ostacoli diventano bloccate
+            if (ctx->min_clearance > 1 && chunk->pathgrid.clearance) {
+                for (int z = 0; z < PATHGRID_SIZE; z++) {
+                    uint8_t* dest = &ctx->grid[(destOffsetZ + z) * TEMP_GRID_WIDTH + destOffsetX];
+                    const uint8_t* clearance = &chunk->pathgrid.clearance[z * PATHGRID_SIZE];
+                    for (int x = 0; x < PATHGRID_SIZE; x++) {
+                        if (clearance[x] < ctx->min_clearance) dest[x] = 0;
+                    }
+                }
+            }
+        }
+    }
+    
+    return true;
+}
+
+// Indice in grid[] di una cella globale su un layer (-1 se fuori dalla
+// finestra o se il layer non è stato copiato nella finestra)
+static int ctx_layer_cell(PathfindingContext* ctx, int layer, int cell_x, int cell_z) {
+    int x = cell_x - ctx->window_cell_x;
+    int z = cell_z - ctx->window_cell_z;
+    if (x < 0 || x >= ctx->current_width || z < 0 || z >= ctx->current_height) return -1;
+    if (layer > 0 && (ctx->window_layers & (1u << layer)) == 0) return -1;
+    return layer * MAX_GRID_CELLS + z * TEMP_GRID_WIDTH + x;
+}
+
+// Copia nei piani 1.. di grid[] i layer attivi con celle nei chunk della
+// finestra e raccoglie i link con entrambe le estremità walkable nella
+// finestra. Da chiamare dopo pathfinding_ctx_setup_window (che li azzera).
+static void ctx_setup_layers(PathfindingContext* ctx, struct Level* lvl,
+                             int startChunkX, int startChunkZ, int chunksX, int chunksZ) {
+    PathLayers* pl = lvl->pathLayers;
+    if (!pl) return;
+
+    for (int layer = 1; layer < PATH_MAX_LAYERS; layer++) {
+        if (!pl->active[layer] || !pl->grids[layer]) continue;
+
+        // Pathgrid del layer nei chunk della finestra (NULL dove non ha celle)
+        PathGrid* grids[MAX_CHUNKS_X * MAX_CHUNKS_Z];
+        bool any = false;
+        for (int cz = 0; cz < chunksZ; cz++) {
+            for (int cx = 0; cx < chunksX; cx++) {
+                int chunkIdxX = startChunkX + cx;
+                int chunkIdxZ = startChunkZ + cz;
+                PathGrid* pg = NULL;
+                if (chunkIdxX >= 0 && chunkIdxX < lvl->chunksCountX &&
+                    chunkIdxZ >= 0 && chunkIdxZ < lvl->chunksCountZ) {
+                    pg = &pl->grids[layer][chunkIdxZ * lvl->chunksCountX + chunkIdxX];
+                    if (!pg->grid) pg = NULL;
+                }
+                grids[cz * chunksX + cx] = pg;
+                if (pg) any = true;
+            }
+        }
+        if (!any) continue;
+
+        uint8_t* plane = &ctx->grid[layer * MAX_GRID_CELLS];
+        for (int cz = 0; cz < chunksZ; cz++) {
+            for (int cx = 0; cx < chunksX; cx++) {
+                PathGrid* pg = grids[cz * chunksX + cx];
+                for (int z = 0; z < PATHGRID_SIZE; z++) {
+                    uint8_t* dest = &plane[(cz * PATHGRID_SIZE + z) * TEMP_GRID_WIDTH + cx * PATHGRID_SIZE];
+                    if (pg) memcpy(dest, &pg->grid[z * PATHGRID_SIZE], PATHGRID_SIZE);
+                    else memset(dest, 0, PATHGRID_SIZE);
+                }
+            }
+        }
+
+        ctx->window_layers |= 1u << layer;
+        ctx->layer_height[layer] = pl->height_offset[layer];
+    }
+
+    // Link in entrambe le direzioni; le estremità vengono marcate con CELL_LINK
+    for (int i = 0; i < pl->link_count; i++) {
+        PathLayerLink* link = &pl->links[i];
+        int a = ctx_layer_cell(ctx, link->layer_a, link->cell_ax, link->cell_az);
+        int b = ctx_layer_cell(ctx, link->layer_b, link->cell_bx, link->cell_bz);
+        if (a < 0 || b < 0 || ctx->grid[a] == 0 || ctx->grid[b] == 0) continue;
+
+        WindowLink* out = &ctx->window_links[ctx->window_link_count];
+        out[0].from = a; out[0].to = b; out[0].cost = link->cost;
+        out[1].from = b; out[1].to = a; out[1].cost = link->cost;
+        ctx->window_link_count += 2;
+        ctx->grid[a] |= CELL_LINK;
+        ctx->grid[b] |= CELL_LINK;
+    }
+}
+
+static float heuristic_euclidean(int x1, int z1, int x2, int z2) {
+    int dx = x2 - x1;
+    int dz = z2 - z1;
+    return sqrtf(dx * dx + dz * dz);
+}
+
+// Euristica tra due celle della finestra: euclidea, alzata dal limite dei
+// landmark quando la ricerca li usa (mai sotto l'euclidea)
+static inline float ctx_heuristic(const PathfindingContext* ctx, int x1, int z1, int x2, int z2) {
+    float h = heuristic_euclidean(x1, z1, x2, z2);
+    const LandmarkMap* lm = ctx->landmarks;
+    if (!lm) return h;
+
+    int row = ctx->window_cell_z * lm->width + ctx->window_cell_x;
+    float alt = landmarks_bound(lm, row + z1 * lm->width + x1, row + z2 * lm->width + x2);
+    return alt > h ? alt : h;
+}
+
+// Converte coordinate della griglia statica in coordinate World
+static void ctx_grid_to_world(PathfindingContext* ctx, int grid_x, int grid_z, struct Level* lvl, vec3 out_world) {
+    // Calcola X e Z usando l'origine e la cell_size memorizzate nel contesto
+    out_world[0] = ctx->current_origin_x + (grid_x + 0.5f) * ctx->current_cell_size;
+    out_world[2] = ctx->current_origin_z + (grid_z + 0.5f) * ctx->current_cell_size;
+    
+    // Calcola Y usando l'heightmap del livello
+    out_world[1] = level_get_height(lvl, out_world[0], out_world[2]);
+}
+
+// Path vuoto per count celle della finestra (waypoint_layers se il path lascia il terreno)
+static Path* path_create_cells(int count, bool layered) {
+    Path* path = path_create(count);
+    if (!path) return NULL;
+
+    if (layered) {
+        path->waypoint_layers = path_arena_layer_storage(path);
+        memset(path->waypoint_layers, 0, count * sizeof(uint8_t));
+    }
+
+    // Impostiamo subito il count finale, così possiamo accedere all'array direttamente
+    path->waypoint_count = count;
+    return path;
+}
+
+// Waypoint i del path al centro della cella idx di grid[] (layer incluso)
+static void path_set_cell(PathfindingContext* ctx, struct Level* lvl, Path* path, int i, int idx) {
+    int layer = idx / MAX_GRID_CELLS;
+    int cell = idx - layer * MAX_GRID_CELLS;
+    ctx_grid_to_world(ctx, cell % TEMP_GRID_WIDTH, cell / TEMP_GRID_WIDTH, lvl, path->waypoints[i]);
+    if (layer > 0) {
+        path->waypoints[i][1] += ctx->layer_height[layer];
+        path->waypoint_layers[i] = (uint8_t)layer;
+    }
+}
+
+static Path* reconstruct_path_static(PathfindingContext* ctx, int goal_idx, struct Level* lvl) {
+    // 1. Conta le celle risalendo i parent (e se il path lascia il terreno)
+    int count = 0;
+    bool layered = false;
+    for (int idx = goal_idx; idx >= 0; idx = ctx->parent[idx]) {
+        count++;
+        if (idx >= MAX_GRID_CELLS) layered = true;
+    }
+
+    if (count == 0) return NULL;
+
+    // 2. Crea l'oggetto Path finale
+    Path* path = path_create_cells(count, layered);
+    if (!path) return NULL;
+    path->layer_id = goal_idx / MAX_GRID_CELLS;
+
+    // 3. Riempi i waypoint direttamente in ordine inverso
+    // (Dal Goal allo Start, ma scrivendo dall'ultimo indice al primo)
+    int i = count - 1;
+    for (int idx = goal_idx; idx >= 0; idx = ctx->parent[idx]) {
+        path_set_cell(ctx, lvl, path, i--, idx);
+    }
+
+    return path;
+}
+
+// Limite di lavoro di una chiamata a search_expand (0 = nessun limite)
+typedef struct {
+    int max_expansions;
+    double deadline_ms;      // Istante get_time_ms() oltre il quale fermarsi
+} SearchBudget;
+
+typedef enum {
+    CELLS_RUNNING,           // Budget esaurito, open set ancora pieno
+    CELLS_FOUND,
+    CELLS_FAILED
+} CellSearchState;
+
+// Il tempo viene letto ogni 64 espansioni; almeno un'espansione per chiamata
+static bool search_budget_exhausted(const SearchBudget* budget, int expanded) {
+    if (expanded == 0) return false;
+    if (budget->max_expansions > 0 && expanded >= budget->max_expansions) return true;
+    if (budget->deadline_ms > 0.0 && (expanded & 63) == 0 && get_time_ms() >= budget->deadline_ms) return true;
+    return false;
+}
+
+// Prepara open set e nodo start per una ricerca tra due celle della finestra
+// attiva (indici di grid[], layer inclusi). Ritorna false se start o goal non
+// sono walkable.
+static bool search_start(PathfindingContext* ctx, struct Level* lvl, PathSearchMode mode,
+                         int start_idx, int goal_idx) {
+    // Reset open set (lo stato per cella è invalidato dal search ID)
+    ctx->heap_size = 0;
+
+    // Verifica walkability immediata (Fail-Fast)
+    if (ctx->grid[start_idx] == 0 || ctx->grid[goal_idx] == 0) return false;
+
+    // Nota: Usiamo sempre TEMP_GRID_WIDTH (192) per l'indicizzazione dell'array statico
+    int start_cell = start_idx % MAX_GRID_CELLS;
+    int goal_cell = goal_idx % MAX_GRID_CELLS;
+    int goal_x = goal_cell % TEMP_GRID_WIDTH;
+    int goal_z = goal_cell / TEMP_GRID_WIDTH;
+
+    ctx->search_mode = mode;
+    ctx->search_goal_idx = goal_idx;
+    ctx->search_goal_x = goal_x;
+    ctx->search_goal_z = goal_z;
+
+    // Le distanze dei landmark sono sul terreno 8-connected: non valgono per
+    // i link tra layer né per i segmenti any-angle di Theta*. JPS segue le
+    // stesse regole ma valuta l'euristica solo sui jump point.
+    ctx->landmarks = mode == PATH_SEARCH_ASTAR && ctx->window_layers == 0 ? lvl->landmarks : NULL;
+
+    ctx_open_cell(ctx, start_idx, false, 0.0f,
+                  ctx_heuristic(ctx, start_cell % TEMP_GRID_WIDTH, start_cell / TEMP_GRID_WIDTH, goal_x, goal_z), -1);
+    return true;
+}
+
+// A*: espande nodi dall'open set finché trova il goal o esaurisce il budget
+static CellSearchState astar_expand(PathfindingContext* ctx, struct Level* lvl,
+                                    const SearchBudget* budget, Path** out_path) {
+    int goal_x = ctx->search_goal_x;
+    int goal_z = ctx->search_goal_z;
+    int goal_idx = ctx->search_goal_idx;
+    int expanded = 0;
+
+    // Direzioni: 8-connected
+    int dx[] = {0, 0, 1, -1, 1, -1, 1, -1};
+    int dz[] = {1, -1, 0, 0, 1, 1, -1, -1};
+    float costs[] = {1.0f, 1.0f, 1.0f, 1.0f, 1.414f, 1.414f, 1.414f, 1.414f};
+
+    // Loop A* principale
+    while (!pq_is_empty(ctx)) {
+        if (search_budget_exhausted(budget, expanded)) return CELLS_RUNNING;
+
+        int c_idx = pq_pop(ctx);
+        ctx->stats.nodes_expanded++;
+        expanded++;
+
+        if (c_idx == goal_idx) {
+            *out_path = reconstruct_path_static(ctx, c_idx, lvl);
+            return CELLS_FOUND;
+        }
+
+        // Piano del layer della cella: i vicini restano sullo stesso layer
+        int cell = c_idx % MAX_GRID_CELLS;
+        int plane = c_idx - cell;
+        int cx = cell % TEMP_GRID_WIDTH;
+        int cz = cell / TEMP_GRID_WIDTH;
+        float c_g = ctx->g_costs[c_idx];
+
+        // Espansione vicini
+        for (int i = 0; i < 8; i++) {
+            int nx = cx + dx[i];
+            int nz = cz + dz[i];
+
+            // Bounds check usando le dimensioni ATTUALI della finestra (non 192, ma la larghezza reale caricata)
+            if (nx < 0 || nx >= ctx->current_width || nz < 0 || nz >= ctx->current_height) continue;
+
+            int n_idx = plane + nz * TEMP_GRID_WIDTH + nx;
+
+            // Walkability check su static grid
+            if (ctx->grid[n_idx] == 0) continue;
+
+            // Costo del passo pesato dal terreno della cella di arrivo
+            float new_g = c_g + costs[i] * ctx->cell_weight[ctx->grid[n_idx]];
+
+            // Check se già visitato in QUESTO search ID
+            bool visited_in_this_search = (ctx->visited_tag[n_idx] == ctx->current_search_id);
+            
+            // Se visitato e il costo non è migliore, skip
+            if (visited_in_this_search && new_g >= ctx->g_costs[n_idx]) {
+                continue;
+            }
+
+            // Trovato percorso migliore o nuova cella: decrease-key se è già nell'open set
+            ctx_open_cell(ctx, n_idx, visited_in_this_search, new_g,
+                          new_g + ctx_heuristic(ctx, nx, nz, goal_x, goal_z), c_idx);
+        }
+
+        // Link verso altri layer (scale, rampe, estremità dei ponti)
+        if ((ctx->grid[c_idx] & CELL_LINK) == 0) continue;
+
+        for (int l = 0; l < ctx->window_link_count; l++) {
+            const WindowLink* link = &ctx->window_links[l];
+            if (link->from != c_idx) continue;
+
+            int n_idx = link->to;
+            float new_g = c_g + link->cost * ctx->cell_weight[ctx->grid[n_idx]];
+            bool visited_in_this_search = (ctx->visited_tag[n_idx] == ctx->current_search_id);
+            if (visited_in_this_search && new_g >= ctx->g_costs[n_idx]) continue;
+
+            int n_cell = n_idx % MAX_GRID_CELLS;
+            ctx_open_cell(ctx, n_idx, visited_in_this_search, new_g,
+                          new_g + heuristic_euclidean(n_cell % TEMP_GRID_WIDTH, n_cell / TEMP_GRID_WIDTH,
+                                                      goal_x, goal_z), c_idx);
+        }
+    }
+    
+    return CELLS_FAILED;
+}
+
+// ============================================================================
+// JUMP POINT SEARCH
+// ============================================================================
+// Stesso modello di movimento dell'A* (8-connected, diagonali sempre permesse
+// anche tra due ostacoli): pruning e forced neighbour della variante originale
+// di Harabor & Grastien senza vincoli sugli angoli.
+
+static inline bool ctx_walkable(PathfindingContext* ctx, int x, int z) {
+    if (x < 0 || x >= ctx->current_width || z < 0 || z >= ctx->current_height) return false;
+    return ctx->grid[z * TEMP_GRID_WIDTH + x] != 0;
+}
+
+// Avanza da (x,z) in direzione (dx,dz) fino al prossimo jump point.
+// Ritorna false se la linea finisce contro un ostacolo o il bordo.
+static bool jps_jump(PathfindingContext* ctx, int x, int z, int dx, int dz,
+                     int goal_x, int goal_z, int* out_x, int* out_z) {
+    while (true) {
+        x += dx;
+        z += dz;
+
+        if (!ctx_walkable(ctx, x, z)) return false;
+        if (x == goal_x && z == goal_z) break;
+
+        if (dx != 0 && dz != 0) {
+            // Diagonale: forced neighbour o jump point sulle componenti dritte
+            if ((ctx_walkable(ctx, x - dx, z + dz) && !ctx_walkable(ctx, x - dx, z)) ||
+                (ctx_walkable(ctx, x + dx, z - dz) && !ctx_walkable(ctx, x, z - dz))) {
+                break;
+            }
+            int jx, jz;
+            if (jps_jump(ctx, x, z, dx, 0, goal_x, goal_z, &jx, &jz) ||
+                jps_jump(ctx, x, z, 0, dz, goal_x, goal_z, &jx, &jz)) {
+                break;
+            }
+        } else if (dx != 0) {
+            if ((ctx_walkable(ctx, x + dx, z + 1) && !ctx_walkable(ctx, x, z + 1)) ||
+                (ctx_walkable(ctx, x + dx, z - 1) && !ctx_walkable(ctx, x, z - 1))) {
+                break;
+            }
+        } else {
+            if ((ctx_walkable(ctx, x + 1, z + dz) && !ctx_walkable(ctx, x + 1, z)) ||
+                (ctx_walkable(ctx, x - 1, z + dz) && !ctx_walkable(ctx, x - 1, z))) {
+                break;
+            }
+        }
+    }
+
+    *out_x = x;
+    *out_z = z;
+    return true;
+}
+
+// Direzioni da esplorare dalla cella (pruning rispetto alla direzione di arrivo).
+// Ritorna il numero di direzioni scritte in out_dx/out_dz (max 8).
+static int jps_directions(PathfindingContext* ctx, int idx, int* out_dx, int* out_dz) {
+    int count = 0;
+    int x = idx % TEMP_GRID_WIDTH, z = idx / TEMP_GRID_WIDTH;
+    int parent = ctx->parent[idx];
+
+    if (parent < 0) {
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dz == 0) continue;
+                out_dx[count] = dx;
+                out_dz[count] = dz;
+                count++;
+            }
+        }
+        return count;
+    }
+
+    int px = parent % TEMP_GRID_WIDTH, pz = parent / TEMP_GRID_WIDTH;
+    int dx = (x > px) - (x < px);
+    int dz = (z > pz) - (z < pz);
+
+    if (dx != 0 && dz != 0) {
+        out_dx[count] = 0;   out_dz[count] = dz;  count++;
+        out_dx[count] = dx;  out_dz[count] = 0;   count++;
+        out_dx[count] = dx;  out_dz[count] = dz;  count++;
+        if (!ctx_walkable(ctx, x - dx, z)) { out_dx[count] = -dx; out_dz[count] = dz;  count++; }
+        if (!ctx_walkable(ctx, x, z - dz)) { out_dx[count] = dx;  out_dz[count] = -dz; count++; }
+    } else if (dx != 0) {
+        out_dx[count] = dx;  out_dz[count] = 0;   count++;
+        if (!ctx_walkable(ctx, x, z + 1)) { out_dx[count] = dx; out_dz[count] = 1;  count++; }
+        if (!ctx_walkable(ctx, x, z - 1)) { out_dx[count] = dx; out_dz[count] = -1; count++; }
+    } else {
+        out_dx[count] = 0;   out_dz[count] = dz;  count++;
+        if (!ctx_walkable(ctx, x + 1, z)) { out_dx[count] = 1;  out_dz[count] = dz; count++; }
+        if (!ctx_walkable(ctx, x - 1, z)) { out_dx[count] = -1; out_dz[count] = dz; count++; }
+    }
+    return count;
+}
+
+// Ricostruisce il path cella per cella (i jump point sono collegati da linee
+// dritte o diagonali), così lo smoothing lavora come con l'A*
+static Path* reconstruct_path_jps(PathfindingContext* ctx, int goal_idx, struct Level* lvl) {
+    int count = 1;
+    for (int idx = goal_idx; ctx->parent[idx] >= 0; idx = ctx->parent[idx]) {
+        int parent = ctx->parent[idx];
+        int steps_x = abs(idx % TEMP_GRID_WIDTH - parent % TEMP_GRID_WIDTH);
+        int steps_z = abs(idx / TEMP_GRID_WIDTH - parent / TEMP_GRID_WIDTH);
+        count += steps_x > steps_z ? steps_x : steps_z;
+    }
+
+    Path* path = path_create(count);
+    if (!path) return NULL;
+    path->waypoint_count = count;
+
+    int i = count - 1;
+    for (int idx = goal_idx; idx >= 0; idx = ctx->parent[idx]) {
+        int x = idx % TEMP_GRID_WIDTH, z = idx / TEMP_GRID_WIDTH;
+        int parent = ctx->parent[idx];
+        if (parent < 0) {
+            ctx_grid_to_world(ctx, x, z, lvl, path->waypoints[i]);
+            break;
+        }
+
+        int px = parent % TEMP_GRID_WIDTH, pz = parent / TEMP_GRID_WIDTH;
+        int dx = (px > x) - (px < x);
+        int dz = (pz > z) - (pz < z);
+        for (; x != px || z != pz; x += dx, z += dz) {
+            ctx_grid_to_world(ctx, x, z, lvl, path->waypoints[i--]);
+        }
+    }
+
+    return path;
+}
+
+static CellSearchState jps_expand(PathfindingContext* ctx, struct Level* lvl,
+                                  const SearchBudget* budget, Path** out_path) {
+    int goal_x = ctx->search_goal_x;
+    int goal_z = ctx->search_goal_z;
+    int goal_idx = goal_z * TEMP_GRID_WIDTH + goal_x;
+    int expanded = 0;
+
+    int dir_x[8], dir_z[8];
+
+    while (!pq_is_empty(ctx)) {
+        if (search_budget_exhausted(budget, expanded)) return CELLS_RUNNING;
+
+        int c_idx = pq_pop(ctx);
+        ctx->stats.nodes_expanded++;
+        expanded++;
+
+        if (c_idx == goal_idx) {
+            *out_path = reconstruct_path_jps(ctx, c_idx, lvl);
+            return CELLS_FOUND;
+        }
+
+        int cx = c_idx % TEMP_GRID_WIDTH;
+        int cz = c_idx / TEMP_GRID_WIDTH;
+        float c_g = ctx->g_costs[c_idx];
+
+        int dir_count = jps_directions(ctx, c_idx, dir_x, dir_z);
+        for (int d = 0; d < dir_count; d++) {
+            int jx, jz;
+            if (!jps_jump(ctx, cx, cz, dir_x[d], dir_z[d], goal_x, goal_z, &jx, &jz)) continue;
+
+            // Distanza lungo la linea dritta o diagonale
+            int steps = abs(jx - cx) > abs(jz - cz) ? abs(jx - cx) : abs(jz - cz);
+            float new_g = c_g + steps * ((dir_x[d] != 0 && dir_z[d] != 0) ? 1.414f : 1.0f);
+
+            int j_idx = jz * TEMP_GRID_WIDTH + jx;
+            bool visited = ctx->visited_tag[j_idx] == ctx->current_search_id;
+            if (visited && new_g >= ctx->g_costs[j_idx]) continue;
+
+            ctx_open_cell(ctx, j_idx, visited, new_g,
+                          new_g + heuristic_euclidean(jx, jz, goal_x, goal_z), c_idx);
+        }
+    }
+
+    return CELLS_FAILED;
+}
+
+// ============================================================================
+// THETA* (any-angle)
+// ============================================================================
+// Come A*, ma un vicino può avere come parent il parent del nodo corrente se
+// c'è line of sight sul pathgrid: i waypoint sono solo i vertici del path teso.
+
+// Line of sight (Bresenham) sulla griglia della finestra attiva
+static bool ctx_line_of_sight(PathfindingContext* ctx, int x0, int z0, int x1, int z1) {
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dz = abs(z1 - z0), sz = z0 < z1 ? 1 : -1;
+    int err = (dx > dz ? dx : -dz) / 2, e2;
+
+    while (true) {
+        if (!ctx_walkable(ctx, x0, z0)) return false;
+        if (x0 == x1 && z0 == z1) break;
+        e2 = err;
+        if (e2 > -dx) { err -= dz; x0 += sx; }
+        if (e2 < dz) { err += dx; z0 += sz; }
+    }
+    return true;
+}
+
+// Lazy Theta*: la line of sight viene verificata una sola volta, quando il
+// nodo viene estratto dall'open set, invece che per ogni vicino generato
+static CellSearchState theta_expand(PathfindingContext* ctx, struct Level* lvl,
+                                    const SearchBudget* budget, Path** out_path) {
+    int goal_x = ctx->search_goal_x;
+    int goal_z = ctx->search_goal_z;
+    int goal_idx = goal_z * TEMP_GRID_WIDTH + goal_x;
+    int expanded = 0;
+
+    int dx[] = {0, 0, 1, -1, 1, -1, 1, -1};
+    int dz[] = {1, -1, 0, 0, 1, 1, -1, -1};
+    float costs[] = {1.0f, 1.0f, 1.0f, 1.0f, 1.414f, 1.414f, 1.414f, 1.414f};
+
+    while (!pq_is_empty(ctx)) {
+        if (search_budget_exhausted(budget, expanded)) return CELLS_RUNNING;
+
+        int c_idx = pq_pop(ctx);
+        int cx = c_idx % TEMP_GRID_WIDTH;
+        int cz = c_idx / TEMP_GRID_WIDTH;
+        ctx->stats.nodes_expanded++;
+        expanded++;
+
+        // Parent non visibile: ripiega sul miglior vicino già chiuso
+        int parent = ctx->parent[c_idx];
+        if (parent >= 0 && !ctx_line_of_sight(ctx, parent % TEMP_GRID_WIDTH, parent / TEMP_GRID_WIDTH, cx, cz)) {
+            float best_g = FLT_MAX;
+            for (int i = 0; i < 8; i++) {
+                int nx = cx + dx[i];
+                int nz = cz + dz[i];
+                if (nx < 0 || nx >= ctx->current_width || nz < 0 || nz >= ctx->current_height) continue;
+
+                int n_idx = nz * TEMP_GRID_WIDTH + nx;
+                if (ctx->visited_tag[n_idx] != ctx->current_search_id) continue;
+                if (ctx->heap_slot[n_idx] != SLOT_CLOSED) continue;
+
+                if (ctx->g_costs[n_idx] + costs[i] < best_g) {
+                    best_g = ctx->g_costs[n_idx] + costs[i];
+                    ctx->parent[c_idx] = n_idx;
+                }
+            }
+            ctx->g_costs[c_idx] = best_g;
+        }
+
+        if (c_idx == goal_idx) {
+            *out_path = reconstruct_path_static(ctx, c_idx, lvl);
+            return CELLS_FOUND;
+        }
+
+        // I vicini ereditano il parent della cella corrente (verifica rimandata)
+        int origin = ctx->parent[c_idx] >= 0 ? ctx->parent[c_idx] : c_idx;
+        int ox = origin % TEMP_GRID_WIDTH, oz = origin / TEMP_GRID_WIDTH;
+        float origin_g = ctx->g_costs[origin];
+
+        for (int i = 0; i < 8; i++) {
+            int nx = cx + dx[i];
+            int nz = cz + dz[i];
+            if (!ctx_walkable(ctx, nx, nz)) continue;
+
+            int n_idx = nz * TEMP_GRID_WIDTH + nx;
+            bool visited = ctx->visited_tag[n_idx] == ctx->current_search_id;
+            if (visited && ctx->heap_slot[n_idx] == SLOT_CLOSED) continue;
+
+            float new_g = (origin == c_idx) ? origin_g + costs[i]
+                                            : origin_g + heuristic_euclidean(ox, oz, nx, nz);
+            if (visited && new_g >= ctx->g_costs[n_idx]) continue;
+
+            ctx_open_cell(ctx, n_idx, visited, new_g,
+                          new_g + heuristic_euclidean(nx, nz, goal_x, goal_z), origin);
+        }
+    }
+
+    return CELLS_FAILED;
+}
+
+// Riprende la ricerca avviata da search_start con l'algoritmo scelto
+static CellSearchState search_expand(PathfindingContext* ctx, struct Level* lvl,
+                                     const SearchBudget* budget, Path** out_path) {
+    *out_path = NULL;
+
+    // Tra due fette landmarks_build può aver sostituito la tabella
+    if (ctx->landmarks) ctx->landmarks = lvl->landmarks;
+
+    CellSearchState state;
+    if (ctx->search_mode == PATH_SEARCH_JPS) {
+        state = jps_expand(ctx, lvl, budget, out_path);
+    } else if (ctx->search_mode == PATH_SEARCH_THETA) {
+        state = theta_expand(ctx, lvl, budget, out_path);
+    } else {
+        state = astar_expand(ctx, lvl, budget, out_path);
+    }
+    // Ricostruzione fallita (memoria): trattata come path non trovato
+    if (state == CELLS_FOUND && !*out_path) state = CELLS_FAILED;
+    return state;
+}
+
+// Ricerca completa tra due celle della finestra attiva con l'algoritmo richiesto
+static Path* search_cells(PathfindingContext* ctx, struct Level* lvl, PathSearchMode mode,
+                          int start_x, int start_z, int goal_x, int goal_z) {
+    if (!search_start(ctx, lvl, mode, start_z * TEMP_GRID_WIDTH + start_x, goal_z * TEMP_GRID_WIDTH + goal_x)) {
+        return NULL;
+    }
+
+    SearchBudget unlimited = { 0, 0.0 };
+    Path* path = NULL;
+    search_expand(ctx, lvl, &unlimited, &path);
+    return path;
+}
+
+Path* pathfinding_ctx_search_cells(PathfindingContext* ctx, struct Level* lvl, PathSearchMode mode,
+                                   int start_x, int start_z, int goal_x, int goal_z) {
+    start_x -= ctx->window_cell_x;
+    start_z -= ctx->window_cell_z;
+    goal_x -= ctx->window_cell_x;
+    goal_z -= ctx->window_cell_z;
+
+    if (start_x < 0 || start_x >= ctx->current_width || start_z < 0 || start_z >= ctx->current_height ||
+        goal_x < 0 || goal_x >= ctx->current_width || goal_z < 0 || goal_z >= ctx->current_height) {
+        return NULL;
+    }
+
+    ctx_begin_search(ctx);
+    return search_cells(ctx, lvl, mode, start_x, start_z, goal_x, goal_z);
+}
+
+int pathfinding_ctx_cell_costs(PathfindingContext* ctx, int src_x, int src_z,
+                               const int* target_x, const int* target_z, int count, float* out_costs) {
+    for (int t = 0; t < count; t++) out_costs[t] = FLT_MAX;
+
+    // Coordinate globali -> locali alla finestra
+    src_x -= ctx->window_cell_x;
+    src_z -= ctx->window_cell_z;
+    if (src_x < 0 || src_x >= ctx->current_width || src_z < 0 || src_z >= ctx->current_height) return 0;
+
+    int src_idx = src_z * TEMP_GRID_WIDTH + src_x;
+    if (ctx->grid[src_idx] == 0) return 0;
+
+    ctx_begin_search(ctx);
+    ctx->heap_size = 0;
+    ctx_open_cell(ctx, src_idx, false, 0.0f, 0.0f, -1);
+
+    int dx[] = {0, 0, 1, -1, 1, -1, 1, -1};
+    int dz[] = {1, -1, 0, 0, 1, 1, -1, -1};
+    float costs[] = {1.0f, 1.0f, 1.0f, 1.0f, 1.414f, 1.414f, 1.414f, 1.414f};
+
+    // Dijkstra (A* senza euristica) fino ad esaurimento della finestra
+    while (!pq_is_empty(ctx)) {
+        int c_idx = pq_pop(ctx);
+        int cx = c_idx % TEMP_GRID_WIDTH;
+        int cz = c_idx / TEMP_GRID_WIDTH;
+        float c_g = ctx->g_costs[c_idx];
+
+        for (int i = 0; i < 8; i++) {
+            int nx = cx + dx[i];
+            int nz = cz + dz[i];
+            if (nx < 0 || nx >= ctx->current_width || nz < 0 || nz >= ctx->current_height) continue;
+
+            int n_idx = nz * TEMP_GRID_WIDTH + nx;
+            if (ctx->grid[n_idx] == 0) continue;
+
+            float new_g = c_g + costs[i] * ctx->cell_weight[ctx->grid[n_idx]];
+            bool visited = ctx->visited_tag[n_idx] == ctx->current_search_id;
+            if (visited && new_g >= ctx->g_costs[n_idx]) continue;
+
+            ctx_open_cell(ctx, n_idx, visited, new_g, new_g, c_idx);
+        }
+    }
+
+    int reached = 0;
+    for (int t = 0; t < count; t++) {
+        int tx = target_x[t] - ctx->window_cell_x;
+        int tz = target_z[t] - ctx->window_cell_z;
+        if (tx < 0 || tx >= ctx->current_width || tz < 0 || tz >= ctx->current_height) continue;
+
+        int t_idx = tz * TEMP_GRID_WIDTH + tx;
+        if (ctx->visited_tag[t_idx] == ctx->current_search_id) {
+            out_costs[t] = ctx->g_costs[t_idx];
+            reached++;
+        }
+    }
+    return reached;
+}
+
+
+bool path_add_waypoint(Path* path, vec3 waypoint) {
+    if (!path) return false;
+
+    // Espandi se necessario (blocco della classe successiva dell'arena)
+    if (path->waypoint_count >= path->capacity &&
+        !path_arena_grow_path(path, path->waypoint_count + 1)) {
+        return false;
+    }
+
+    // Waypoint aggiunti a mano: sul layer 0
+    if (path->waypoint_layers) path->waypoint_layers[path->waypoint_count] = 0;
+    glm_vec3_copy(waypoint, path->waypoints[path->waypoint_count]);
+    path->waypoint_count++;
+    return true;
+}
+
+void path_free(Path* path) {
+    path_arena_free_path(path);
+}
+
+Path* path_clone(Path* path) {
+    if (!path) return NULL;
+
+    Path* copy = path_create(path->waypoint_count > 0 ? path->waypoint_count : 1);
+    if (!copy) return NULL;
+
+    memcpy(copy->waypoints, path->waypoints, path->waypoint_count * sizeof(vec3));
+    copy->waypoint_count = path->waypoint_count;
+    copy->layer_id = path->layer_id;
+    copy->partial = path->partial;
+
+    if (path->waypoint_layers) {
+        copy->waypoint_layers = path_arena_layer_storage(copy);
+        memcpy(copy->waypoint_layers, path->waypoint_layers, path->waypoint_count * sizeof(uint8_t));
+    }
+    return copy;
+}
+
+bool world_to_grid(struct Terrain* chunk, vec3 world_pos, int* out_x, int* out_z) {
+    if (!chunk || !out_x || !out_z) return false;
+
+    // Converti world → UV (0.0 a 1.0)
+    float u = (world_pos[0] - chunk->offsetX) / chunk->worldSize;
+    float v = (world_pos[2] - chunk->offsetZ) / chunk->worldSize;
+
+    // Bounds check
+    if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f) {
+        return false;
+    }
+
+    // UV → Grid coords (ogni cella copre 1/PATHGRID_SIZE dello spazio UV)
+    *out_x = (int)(u * PATHGRID_SIZE);
+    *out_z = (int)(v * PATHGRID_SIZE);
+
+    // Clamp per sicurezza (u=1.0 esatto va a cella 64, che non esiste)
+    if (*out_x >= PATHGRID_SIZE) *out_x = PATHGRID_SIZE - 1;
+    if (*out_z >= PATHGRID_SIZE) *out_z = PATHGRID_SIZE - 1;
+
+    return true;
+}
+
+// Bresenham sulla copia a bit: un tratto orizzontale (o verticale) per volta,
+// verificato con una maschera sulla parola della riga (o colonna)
+bool pathgrid_line_of_sight(PathGrid* pg, int x0, int z0, int x1, int z1) {
+    if (!pg || !pg->grid) return false;
+    return bitgrid_line_of_sight(&pg->walk_bits, x0, z0, x1, z1);
+}
+
+// Peso del terreno in una posizione world (cell_weight indicizzato come ctx->grid)
+static float world_cell_weight(struct Level* lvl, vec3 pos, const float* cell_weight) {
+    int cell_x, cell_z;
+    if (!pathfinding_level_world_to_cell(lvl, pos, &cell_x, &cell_z)) return 1.0f;
+    return cell_weight[1 + pathfinding_level_cell_terrain(lvl, cell_x, cell_z)];
+}
+
+// Costo pesato di un segmento dritto (integrato a passi di 1/4 di cella)
+static float segment_weighted_cost(struct Level* lvl, vec3 a, vec3 b, const float* cell_weight) {
+    float dx = b[0] - a[0];
+    float dz = b[2] - a[2];
+    float length = sqrtf(dx * dx + dz * dz) / pathfinding_level_cell_size(lvl);
+    int num_steps = (int)(length * 4.0f) + 1;
+    float step = length / num_steps;
+
+    float cost = 0.0f;
+    for (int i = 0; i < num_steps; i++) {
+        float t = (i + 0.5f) / num_steps;
+        vec3 p = { a[0] + dx * t, 0.0f, a[2] + dz * t };
+        cost += step * world_cell_weight(lvl, p, cell_weight);
+    }
+    return cost;
+}
+
+// String pulling. cell_weight != NULL (ricerca pesata): una scorciatoia è
+// accettata solo se non costa più del tratto di path che sostituisce,
+// altrimenti taglierebbe dritto attraverso fango o zone pericolose.
+// Con waypoint_layers le scorciatoie restano dentro i tratti sul terreno:
+// la line of sight della walkmap non sa nulla di ponti e camminamenti.
+// min_clearance > 1: le scorciatoie rispettano la clearance dell'agente.
+static void smooth_path(struct Level* lvl, Path* path, const float* cell_weight, int min_clearance) {
+    if (!path || path->waypoint_count <= 2) return;
+
+    // Costo pesato cumulativo lungo il path originale (come il g dell'A*)
+    float* prefix_cost = NULL;
+    if (cell_weight) {
+        prefix_cost = (float*)path_arena_alloc(path->waypoint_count * sizeof(float));
+        if (!prefix_cost) return;
+        prefix_cost[0] = 0.0f;
+        for (int k = 1; k < path->waypoint_count; k++) {
+            float dist = glm_vec3_distance(path->waypoints[k - 1], path->waypoints[k]) / pathfinding_level_cell_size(lvl);
+            prefix_cost[k] = prefix_cost[k - 1] + dist * world_cell_weight(lvl, path->waypoints[k], cell_weight);
+        }
+    }
+
+    // I punti ottimizzati si scrivono sullo stesso array: il punto scelto
+    // (indice current_idx) finisce in new_count <= current_idx, e le letture
+    // successive partono da current_idx, mai da indici già sovrascritti
+    vec3* new_waypoints = path->waypoints;
+    uint8_t* layers = path->waypoint_layers;
+    uint8_t* new_layers = layers;
+    int new_count = 0;
+
+    // Aggiungi sempre il primo punto (Start)
+    glm_vec3_copy(path->waypoints[0], new_waypoints[0]);
+    if (new_layers) new_layers[0] = layers[0];
+    new_count++;
+
+    int current_idx = 0;
+
+    while (current_idx < path->waypoint_count - 1) {
+        // Cerca il punto più lontano visibile dal corrente
+        // Partiamo dalla fine e torniamo indietro verso current
+        bool found_shortcut = false;
+
+        // Ultimo waypoint raggiungibile con una scorciatoia (fine del tratto sul terreno)
+        int last_idx = path->waypoint_count - 1;
+        if (layers) {
+            last_idx = current_idx;
+            if (layers[current_idx] == 0) {
+                while (last_idx + 1 < path->waypoint_count && layers[last_idx + 1] == 0) last_idx++;
+            }
+        }
+        
+        for (int check_idx = last_idx; check_idx > current_idx + 1; check_idx--) {
+            if (check_world_visibility(lvl, path->waypoints[current_idx], path->waypoints[check_idx], min_clearance) &&
+                (!prefix_cost ||
+                 segment_weighted_cost(lvl, path->waypoints[current_idx], path->waypoints[check_idx], cell_weight) <=
+                     prefix_cost[check_idx] - prefix_cost[current_idx] + 0.01f)) {
+                // Trovato shortcut! Il punto check_idx diventa il prossimo nel path
+                current_idx = check_idx;
+                glm_vec3_copy(path->waypoints[current_idx], new_waypoints[new_count]);
+                if (new_layers) new_layers[new_count] = layers[current_idx];
+                new_count++;
+                found_shortcut = true;
+                break;
+            }
+        }
+
+        // Se non trovo scorciatoie lunghe, devo per forza andare al punto successivo
+        if (!found_shortcut) {
+            current_idx++;
+            glm_vec3_copy(path->waypoints[current_idx], new_waypoints[new_count]);
+            if (new_layers) new_layers[new_count] = layers[current_idx];
+            new_count++;
+        }
+    }
+
+    path_arena_release(prefix_cost);
+    path->waypoint_count = new_count;
+}
+
+// String pulling con line of sight sulla walkmap del livello
+void pathfinding_smooth_path_level(struct Level* lvl, Path* path) {
+    smooth_path(lvl, path, NULL, 0);
+}
+
+// String pulling sul livello associato al contesto (ctx->current_level),
+// con i pesi del terreno se l'ultima ricerca era pesata
+static void path_smooth_ctx(PathfindingContext* ctx, Path* path) {
+    smooth_path(ctx->current_level, path, ctx->weighted ? ctx->cell_weight : NULL, ctx->min_clearance);
+}
+
+void path_smooth(Path* path) {
+    if (!g_ctx) return;
+    smooth_path(g_ctx->current_level, path, NULL, 0);
+}
+
+// ============================================================================
+// NEAREST REACHABLE (click su terreno bloccato)
+// ============================================================================
+
+// true se una cella del terreno può essere il goal di un agente che parte
+// dalla zona start_zone (< 0 = nessun filtro) con la clearance richiesta
+static bool nearest_cell_accepted(struct Level* lvl, int cell_x, int cell_z, int start_zone, int min_clearance) {
+    int clearance = pathfinding_level_cell_clearance(lvl, cell_x, cell_z);
+    if (clearance == 0 || clearance < min_clearance) return false;
+    if (start_zone < 0) return true;
+
+    int zone = zones_get_cell(lvl, cell_x, cell_z);
+    return zone == start_zone || layers_zones_linked(lvl, start_zone, zone);
+}
+
+// Ring search attorno alla cella target: anelli di Chebyshev crescenti fino a
+// PATH_NEAREST_MAX_RADIUS, fermandosi quando l'anello è più lontano della
+// migliore cella trovata (distanza euclidea)
+static bool nearest_cell(struct Level* lvl, int target_x, int target_z, int start_zone, int min_clearance,
+                         int* out_x, int* out_z) {
+    int cells_x = pathfinding_level_cells_x(lvl);
+    int cells_z = pathfinding_level_cells_z(lvl);
+    int best_d2 = -1;
+
+    for (int r = 0; r <= PATH_NEAREST_MAX_RADIUS; r++) {
+        if (best_d2 >= 0 && r * r > best_d2) break;
+
+        for (int dz = -r; dz <= r; dz++) {
+            int z = target_z + dz;
+            if (z < 0 || z >= cells_z) continue;
+
+            // Righe interne dell'anello: solo le due colonne di bordo
+            int step = (dz == -r || dz == r) ? 1 : 2 * r;
+            for (int dx = -r; dx <= r; dx += step) {
+                int x = target_x + dx;
+                if (x < 0 || x >= cells_x) continue;
+
+                int d2 = dx * dx + dz * dz;
+                if (best_d2 >= 0 && d2 >= best_d2) continue;
+                if (!nearest_cell_accepted(lvl, x, z, start_zone, min_clearance)) continue;
+
+                best_d2 = d2;
+                *out_x = x;
+                *out_z = z;
+            }
+        }
+    }
+
+    return best_d2 >= 0;
+}
+
+// Sostituto del goal per PATH_QUERY_NEAREST (vedi pathfinding_nearest_reachable).
+// start_zone < 0: start su un layer o senza mappa delle zone, solo walkability.
+static bool nearest_goal(struct Level* lvl, vec3 goal, int start_zone, int min_clearance, vec3 out_pos) {
+    if (!lvl->chunks) return false;
+
+    // Goal fuori dal livello: cella di bordo più vicina
+    float cell_size = pathfinding_level_cell_size(lvl);
+    int target_x = (int)floorf((goal[0] - lvl->originX) / cell_size);
+    int target_z = (int)floorf((goal[2] - lvl->originZ) / cell_size);
+    int cells_x = pathfinding_level_cells_x(lvl);
+    int cells_z = pathfinding_level_cells_z(lvl);
+    if (target_x < 0) target_x = 0;
+    if (target_z < 0) target_z = 0;
+    if (target_x >= cells_x) target_x = cells_x - 1;
+    if (target_z >= cells_z) target_z = cells_z - 1;
+
+    int cell_x, cell_z;
+    if (!nearest_cell(lvl, target_x, target_z, start_zone, min_clearance, &cell_x, &cell_z)) return false;
+
+    // Il goal originale resta com'è se la sua cella è già accettabile
+    if (cell_x == target_x && cell_z == target_z && pathfinding_level_world_to_cell(lvl, goal, &cell_x, &cell_z)) {
+        glm_vec3_copy(goal, out_pos);
+        return true;
+    }
+
+    pathfinding_level_cell_to_world(lvl, cell_x, cell_z, out_pos);
+    return true;
+}
+
+bool pathfinding_nearest_reachable(struct Level* lvl, vec3 start, vec3 target, float agent_radius, vec3 out_pos) {
+    if (!lvl || !lvl->chunks) return false;
+
+    int start_zone = -1;
+    if (lvl->zoneMap && layers_pick(lvl, start) == 0) {
+        start_zone = zones_get(lvl, start);
+        if (start_zone == ZONE_NONE) return false;
+    }
+
+    int min_clearance = pathfinding_clearance_for_radius(lvl, agent_radius);
+    return nearest_goal(lvl, target, start_zone, min_clearance, out_pos);
+}
+
+// ============================================================================
+// RICERCA (bloccante o time-sliced)
+// ============================================================================
+// Una query passa sempre da search_setup + search_advance: pathfinding_find_path
+// le esegue con budget illimitato, pathfinding_search_step a fette.
+
+// Popola grid[] con la finestra di chunk, o la riusa così com'è se la query
+// precedente sul contesto ha letto la stessa finestra con la stessa clearance,
+// gli stessi pesi e la stessa versione dei dati: allora basta un nuovo search ID
+static bool ctx_prepare_window(PathfindingContext* ctx, struct Level* lvl,
+                               int chunkX, int chunkZ, int chunksX, int chunksZ, uint64_t version) {
+    WindowKey window_key;
+    memset(&window_key, 0, sizeof(window_key));
+    window_key.lvl = lvl;
+    window_key.chunk_x = chunkX;
+    window_key.chunk_z = chunkZ;
+    window_key.chunks_x = chunksX;
+    window_key.chunks_z = chunksZ;
+    window_key.clearance = ctx->min_clearance;
+    window_key.profile_hash = ctx_cost_profile_hash(ctx);
+    window_key.version = version;
+
+    if (ctx->window_key_valid && window_key_equal(&ctx->window_key, &window_key)) {
+        ctx_begin_search(ctx);
+        ctx->stats.windows_reused++;
+        return true;
+    }
+
+    if (!pathfinding_ctx_setup_window(ctx, lvl, chunkX, chunkZ, chunksX, chunksZ)) {
+        printf("[Pathfinding] Failed to build static grid context\n");
+        return false;
+    }
+    ctx_setup_layers(ctx, lvl, chunkX, chunkZ, chunksX, chunksZ);
+    ctx->window_key = window_key;
+    ctx->window_key_valid = true;
+    return true;
+}
+
+struct PathSearch {
+    PathfindingContext* ctx;
+    struct Level* lvl;
+    PathQueryParams params;
+    vec3 start;
+    vec3 goal;
+    PathSearchStatus status;
+    int search_id;           // ctx->current_search_id della ricerca a griglia
+    bool use_hpa;            // Oltre la finestra 3x3: HPA*, un chunk raffinato per volta
+    HpaQuery* hpa;           // Query HPA* avviata dal primo step
+    bool smooth;
+    bool cacheable;          // Risultato da salvare nella path cache
+    bool partial;            // Goal sostituito (PATH_QUERY_NEAREST)
+    PathCacheKey cache_key;
+    Path* path;              // Risultato (FOUND) finché non viene preso
+    float time_ms;           // Tempo speso in begin + step
+};
+
+// Validazione, scorciatoia in line of sight e setup della finestra.
+// Nessuna espansione: status è FOUND/FAILED se la query è già risolta.
+static void search_setup(PathSearch* search, PathfindingContext* ctx, struct Level* lvl,
+                         vec3 start, vec3 goal, const PathQueryParams* params) {
+    memset(search, 0, sizeof(*search));
+    search->ctx = ctx;
+    search->lvl = lvl;
+    search->params = *params;
+    glm_vec3_copy(start, search->start);
+    glm_vec3_copy(goal, search->goal);
+    search->status = PATH_STATUS_FAILED;
+    search->smooth = (params->flags & PATH_QUERY_NO_SMOOTH) == 0;
+
+    // Pesi del terreno: JPS e Theta* presuppongono costi uniformi
+    ctx_set_cost_profile(ctx, params->cost_profile);
+    if (ctx->weighted) search->params.mode = PATH_SEARCH_ASTAR;
+
+    // Taglia dell'agente: clearance minima delle celle attraversabili
+    ctx->min_clearance = pathfinding_clearance_for_radius(lvl, params->agent_radius);
+
+    // Goal bloccato, fuori dal livello o in un'altra zona: con PATH_QUERY_NEAREST
+    // la ricerca (una sola) punta alla cella raggiungibile più vicina
+    if (params->flags & PATH_QUERY_NEAREST) {
+        int start_zone = -1;
+        if (lvl->zoneMap && layers_pick(lvl, start) == 0) start_zone = zones_get(lvl, start);
+
+        if (start_zone != ZONE_NONE && layers_pick(lvl, goal) == 0 &&
+            nearest_goal(lvl, goal, start_zone, ctx->min_clearance, search->goal)) {
+            search->partial = search->goal[0] != goal[0] || search->goal[2] != goal[2];
+            goal = search->goal;
+        }
+    }
+
+    // 1. Identifica i chunk di partenza e arrivo per validazione di base
+    struct Terrain* start_chunk = level_get_chunk_at(lvl, start[0], start[2]);
+    struct Terrain* goal_chunk = level_get_chunk_at(lvl, goal[0], goal[2]);
+
+    if (!start_chunk) {
+        printf("[Pathfinding] Start position outside level\n");
+        return;
+    }
+    if (!goal_chunk) {
+        printf("[Pathfinding] Goal position outside level\n");
+        return;
+    }
+
+    // Layer di start e goal (0 = terreno, vedi pathfinding_layers.h)
+    int start_layer = layers_pick(lvl, start);
+    int goal_layer = layers_pick(lvl, goal);
+    bool on_ground = start_layer == 0 && goal_layer == 0;
+
+    // Zone connesse: start e goal in componenti diverse (o fuori da zone_id)
+    // non hanno path, inutile esplorare la finestra per scoprirlo.
+    // Zone diverse restano raggiungibili se i link dei layer le collegano.
+    if (lvl->zoneMap && on_ground) {
+        int start_zone = zones_get(lvl, start);
+        int goal_zone = zones_get(lvl, goal);
+        if (start_zone == ZONE_NONE || (params->zone_id >= 0 && start_zone != params->zone_id) ||
+            (start_zone != goal_zone && !layers_zones_linked(lvl, start_zone, goal_zone))) {
+            ctx->stats.paths_rejected_zone++;
+            return;
+        }
+    }
+
+    // Finestra 3x3 o, oltre, tutto il livello (HPA*)
+    int chunkX, chunkZ, chunksX, chunksZ;
+    bool in_window = compute_chunk_window(lvl, start, goal, &chunkX, &chunkZ, &chunksX, &chunksZ);
+
+    // Versione dei dati letti dalla ricerca (path cache e riuso della finestra)
+    uint64_t version = in_window ? level_chunks_version(lvl, chunkX, chunkZ, chunksX, chunksZ)
+                                 : level_chunks_version(lvl, 0, 0, lvl->chunksCountX, lvl->chunksCountZ);
+    if (lvl->pathLayers) version += lvl->pathLayers->version;
+
+    // Path cache: stesse celle e parametri, chunk letti dalla ricerca non modificati
+    PathCacheKey* key = &search->cache_key;
+    if ((params->flags & PATH_QUERY_NO_CACHE) == 0 &&
+        pathfinding_level_world_to_cell(lvl, start, &key->start_x, &key->start_z) &&
+        pathfinding_level_world_to_cell(lvl, goal, &key->goal_x, &key->goal_z)) {
+        key->lvl = lvl;
+        key->start_layer = start_layer;
+        key->goal_layer = goal_layer;
+        key->agent_class = params->agent_class;
+        key->clearance = ctx->min_clearance;
+        key->profile_hash = ctx_cost_profile_hash(ctx);
+        key->mode = search->params.mode;
+        key->flags = params->flags;
+        key->zone_id = params->zone_id;
+        key->version = version;
+
+        if (path_cache_lookup(key, &search->path)) {
+            // Stessa cella di goal, ma il path in cache può venire da un click sostituito
+            if (search->path) search->path->partial = search->partial;
+            search->status = search->path ? PATH_STATUS_FOUND : PATH_STATUS_FAILED;
+            return;
+        }
+        search->cacheable = true;
+    }
+
+    // 2. OTTIMIZZAZIONE: Line of Sight (Raycast)
+    // Se siamo nello stesso chunk, prova prima a tracciare una linea retta.
+    // Se la linea è libera, evita completamente il costo di setup della finestra e A*.
+    if (start_chunk == goal_chunk && on_ground && ctx->min_clearance <= 1) {
+        int sx, sz, gx, gz;
+        // Nota: qui usiamo la funzione locale del chunk, non quella globale del contesto
+        if (world_to_grid(start_chunk, start, &sx, &sz) && 
+            world_to_grid(start_chunk, goal, &gx, &gz)) {
+            
+            // Ricerca pesata: la linea retta è ottima solo se attraversa
+            // terreno a peso 1 (i pesi non scendono sotto 1), altrimenti
+            // taglierebbe dritto attraverso fango o zone pericolose
+            bool straight_optimal = !ctx->weighted;
+            if (ctx->weighted) {
+                float dx = goal[0] - start[0];
+                float dz = goal[2] - start[2];
+                float length = sqrtf(dx * dx + dz * dz) / pathfinding_level_cell_size(lvl);
+                straight_optimal = segment_weighted_cost(lvl, start, goal, ctx->cell_weight) <= length * 1.001f;
+            }
+
+            if (straight_optimal && pathgrid_line_of_sight(&start_chunk->pathgrid, sx, sz, gx, gz)) {
+                 Path* simple_path = path_create(2);
+                 path_add_waypoint(simple_path, start); // Start
+                 path_add_waypoint(simple_path, goal);  // End
+                 if (simple_path) simple_path->partial = search->partial;
+                 search->path = simple_path;
+                 search->status = simple_path ? PATH_STATUS_FOUND : PATH_STATUS_FAILED;
+                 if (simple_path && search->cacheable) path_cache_store(key, simple_path);
+                 return;
+            }
+        }
+    }
+
+    if (in_window) {
+        // ====================================================================
+        // 3. PREPARAZIONE CONTESTO
+        // ====================================================================
+        // Qui popoliamo ctx->grid copiando i dati dai chunk necessari (max 3x3).
+        // Questo sovrascrive i dati della richiesta precedente nel buffer del contesto,
+        // a meno che la richiesta precedente non abbia letto la stessa finestra
+        // (es. un'ondata di creature che cerca nella stessa zona): allora basta
+        // un nuovo search ID.
+        if (!ctx_prepare_window(ctx, lvl, chunkX, chunkZ, chunksX, chunksZ, version)) return;
+
+        // JPS e Theta* conoscono solo il piano del terreno
+        if (ctx->window_layers || ctx->window_link_count > 0) {
+            search->params.mode = PATH_SEARCH_ASTAR;
+        }
+
+        int start_x, start_z, goal_x, goal_z;
+
+        // Converti coordinate World -> Grid
+        if (!ctx_world_to_grid(ctx, start, &start_x, &start_z)) {
+            printf("[Pathfinding] Start position outside active window (%.2f, %.2f)\n", start[0], start[2]);
+            return;
+        }
+        if (!ctx_world_to_grid(ctx, goal, &goal_x, &goal_z)) {
+            printf("[Pathfinding] Goal position outside active window (%.2f, %.2f)\n", goal[0], goal[2]);
+            return;
+        }
+
+        // ====================================================================
+        // 4. AVVIO A* (le espansioni avvengono in search_advance)
+        // ====================================================================
+        // A* legge solo dal contesto passato: contesti diversi possono lavorare
+        // in parallelo su thread diversi (il livello è accesso in sola lettura).
+        int start_idx = ctx_layer_cell(ctx, start_layer, ctx->window_cell_x + start_x, ctx->window_cell_z + start_z);
+        int goal_idx = ctx_layer_cell(ctx, goal_layer, ctx->window_cell_x + goal_x, ctx->window_cell_z + goal_z);
+        if (start_idx < 0 || goal_idx < 0) {
+            printf("[Pathfinding] Start or goal layer not available in active window\n");
+            return;
+        }
+
+        if (!search_start(ctx, lvl, search->params.mode, start_idx, goal_idx)) return;
+
+        search->search_id = ctx->current_search_id;
+        search->status = PATH_STATUS_IN_PROGRESS;
+
+        // Theta* produce già un path teso: lo string pulling non serve
+        if (search->params.mode == PATH_SEARCH_THETA) search->smooth = false;
+    } else if (lvl->hpaGraph && ctx->min_clearance > 1) {
+        // Ingressi e costi intra del grafo valgono per agenti di una cella:
+        // il raffinamento con clearance fallirebbe (o devierebbe) nei varchi
+        // stretti senza cercare alternative larghe
+        printf("[Pathfinding] Path spans more than %dx%d chunks: HPA* does not support agent_radius %.2f\n",
+               MAX_CHUNKS_X, MAX_CHUNKS_Z, search->params.agent_radius);
+    } else if (lvl->hpaGraph) {
+        // Oltre la finestra 3x3: A* sul grafo astratto, poi raffinamento
+        // solo dei chunk attraversati (vedi pathfinding_hpa.h)
+        search->use_hpa = true;
+        search->status = PATH_STATUS_IN_PROGRESS;
+    } else {
+        printf("[Pathfinding] Path spans more than %dx%d chunks and no HPA graph is built\n",
+               MAX_CHUNKS_X, MAX_CHUNKS_Z);
+    }
+}
+
+// HPA*: il primo step esegue la ricerca astratta, poi ogni tratto raffinato
+// (un A* nel chunk) conta come una fetta. Il budget è controllato tra un
+// chunk e l'altro; almeno un'unità di lavoro per chiamata. Ritorna false se
+// la query non è ancora conclusa.
+static bool search_advance_hpa(PathSearch* search, const SearchBudget* budget) {
+    PathfindingContext* ctx = search->ctx;
+    long long nodes_before = ctx->stats.nodes_expanded;
+
+    // Tra due step il contesto può aver servito altre query: i raffinamenti
+    // ripreparano la finestra, pesi e clearance vanno rimessi
+    ctx_set_cost_profile(ctx, search->params.cost_profile);
+    ctx->min_clearance = pathfinding_clearance_for_radius(search->lvl, search->params.agent_radius);
+
+    bool worked = false;
+    if (!search->hpa) {
+        search->hpa = hpa_query_begin(ctx, search->lvl, search->start, search->goal, search->params.mode);
+        if (!search->hpa) return true;
+        worked = true;
+    }
+
+    while (true) {
+        if (worked) {
+            long long expanded = ctx->stats.nodes_expanded - nodes_before;
+            if (budget->max_expansions > 0 && expanded >= budget->max_expansions) return false;
+            if (budget->deadline_ms > 0.0 && get_time_ms() >= budget->deadline_ms) return false;
+        }
+        if (hpa_query_refine(search->hpa) != HPA_QUERY_RUNNING) return true;
+        worked = true;
+    }
+}
+
+// Avanza la ricerca entro il budget. A ricerca conclusa applica lo smoothing.
+static void search_advance(PathSearch* search, const SearchBudget* budget) {
+    if (search->status != PATH_STATUS_IN_PROGRESS) return;
+
+    PathfindingContext* ctx = search->ctx;
+    struct Level* lvl = search->lvl;
+    Path* path = NULL;
+
+    if (search->use_hpa) {
+        if (!search_advance_hpa(search, budget)) return;
+        path = hpa_query_take_path(search->hpa);
+        hpa_query_destroy(search->hpa);
+        search->hpa = NULL;
+    } else {
+        // Un'altra query sullo stesso contesto ha sovrascritto open set e griglia
+        if (ctx->current_search_id != search->search_id) {
+            printf("[Pathfinding] Search context reused by another query, search aborted\n");
+            search->status = PATH_STATUS_FAILED;
+            return;
+        }
+
+        if (search_expand(ctx, lvl, budget, &path) == CELLS_RUNNING) return;
+    }
+
+    if (!path) {
+        // Anche "irraggiungibile" va in cache: è la ricerca più costosa
+        if (search->cacheable) path_cache_store(&search->cache_key, NULL);
+        search->status = PATH_STATUS_FAILED;
+        return;
+    }
+
+    path->partial = search->partial;
+
+    // 5. SMOOTHING (usa walkmap a piena risoluzione per line-of-sight)
+    if (search->smooth) {
+        // Salva il puntatore al livello per check_world_visibility
+        ctx->current_level = lvl;
+        path_smooth_ctx(ctx, path);
+        ctx->current_level = NULL; // Cleanup
+    }
+
+    if (search->cacheable) path_cache_store(&search->cache_key, path);
+
+    search->path = path;
+    search->status = PATH_STATUS_FOUND;
+}
+
+static Path* find_path_internal(PathfindingContext* ctx, struct Level* lvl, vec3 start, vec3 goal,
+                                const PathQueryParams* params) {
+    PathSearch search;
+    search_setup(&search, ctx, lvl, start, goal, params);
 
-            // Bounds check
-            if (chunkIdxX < 0 || chunkIdxX >= lvl->chunksCountX ||
-                chunkIdxZ < 0 || chunkIdxZ >= lvl->chunksCountZ) {
-                continue;
-            }
+    SearchBudget unlimited = { 0, 0.0 };
+    search_advance(&search, &unlimited);
+    return search.path;
+}
 
-            
-            struct Terrain* chunk = &lvl->chunks[chunkIdxZ * lvl->chunksCountX + chunkIdxX];
-            
-            // Calcola offset nella griglia statica (larga TEMP_GRID_WIDTH)
-            int destOffsetX = cx * PATHGRID_SIZE;
-            int destOffsetZ = cz * PATHGRID_SIZE;
+// Aggiorna statistiche del contesto (nessuna condivisione tra thread)
+static void ctx_record_query(PathfindingContext* ctx, bool found, float elapsed) {
+    ctx->stats.total_paths_requested++;
+    if (found) ctx->stats.paths_found++;
+    else ctx->stats.paths_failed++;
+    ctx->stats.total_time_ms += elapsed;
+    if (elapsed > ctx->stats.max_time_ms) ctx->stats.max_time_ms = elapsed;
+}
 
-            if (chunk && chunk->pathgrid.grid) {
-                // Copia riga per riga per mantenere la continuità
-                for (int z = 0; z < PATHGRID_SIZE; z++) {
-                     // Calcola puntatori per memcpy veloce
-                     uint8_t* dest = &g_ctx->grid[(destOffsetZ + z) * TEMP_GRID_WIDTH + destOffsetX];
-                     uint8_t* src = &chunk->pathgrid.grid[z * PATHGRID_SIZE];
-                     memcpy(dest, src, PATHGRID_SIZE);
-                }
-            } else {
-                // Chunk non caricato? Segna come non camminabile
-                for (int z = 0; z < PATHGRID_SIZE; z++) {
-                    uint8_t* dest = &g_ctx->grid[(destOffsetZ + z) * TEMP_GRID_WIDTH + destOffsetX];
-                    memset(dest, 0, PATHGRID_SIZE);
-                }
-            }
-        }
-    }
-    
-    return true;
+PathQueryParams pathfinding_query_defaults(void) {
+    // Zero-init: i campi aggiunti in futuro partono a 0 / NULL
+    PathQueryParams params = {0};
+    params.mode = PATH_SEARCH_ASTAR;
+    params.zone_id = -1;
+    params.flags = 0;
+    params.agent_class = 0;
+    params.agent_radius = 0.0f;
+    params.cost_profile = NULL;
+    return params;
 }
 
+Path* pathfinding_find_path_ctx_ex(PathfindingContext* ctx, struct Level* lvl, vec3 start, vec3 goal,
+                                   const PathQueryParams* params) {
+    if (!ctx || !lvl || !params) return NULL;
 
+    double t_start = get_time_ms();
+    Path* path = find_path_internal(ctx, lvl, start, goal, params);
+    ctx_record_query(ctx, path != NULL, (float)(get_time_ms() - t_start));
 
-static float heuristic_euclidean(int x1, int z1, int x2, int z2) {
-    int dx = x2 - x1;
-    int dz = z2 - z1;
-    return sqrtf(dx * dx + dz * dz);
+    return path;
+}
+
+Path* pathfinding_find_path_ctx(PathfindingContext* ctx, struct Level* lvl, vec3 start, vec3 goal, int zone_id) {
+    PathQueryParams params = pathfinding_query_defaults();
+    params.zone_id = zone_id;
+    return pathfinding_find_path_ctx_ex(ctx, lvl, start, goal, &params);
 }
 
-static PathNode* get_node_from_pool(int x, int z) {
-    if (g_node_pool_used >= MAX_PATH_NODES) {
-        printf("[Pathfinding] ERROR: Node pool exhausted!\n");
+Path* pathfinding_find_path_ex(struct Level* lvl, vec3 start, vec3 goal, const PathQueryParams* params) {
+    if (!g_ctx) {
+        printf("[Pathfinding] ERROR: pathfinding_init() not called\n");
         return NULL;
     }
-    PathNode* node = &g_node_pool[g_node_pool_used++];
-    node->x = x;
-    node->z = z;
-    node->g_cost = FLT_MAX;
-    node->h_cost = 0.0f;
-    node->f_cost = FLT_MAX;
-    node->parent = NULL;
-    node->heap_index = -1;
-    return node;
+    pathfinding_flush_changes();
+    return pathfinding_find_path_ctx_ex(g_ctx, lvl, start, goal, params);
 }
 
-// Converte coordinate della griglia statica in coordinate World
-static void ctx_grid_to_world(int grid_x, int grid_z, struct Level* lvl, vec3 out_world) {
-    // Calcola X e Z usando l'origine e la cell_size memorizzate nel contesto
-    out_world[0] = g_ctx->current_origin_x + (grid_x + 0.5f) * g_ctx->current_cell_size;
-    out_world[2] = g_ctx->current_origin_z + (grid_z + 0.5f) * g_ctx->current_cell_size;
-    
-    // Calcola Y usando l'heightmap del livello
-    out_world[1] = level_get_height(lvl, out_world[0], out_world[2]);
-}
+// ============================================================================
+// OBIETTIVO PIÙ VICINO (multi-goal)
+// ============================================================================
 
-static Path* reconstruct_path_static(PathNode* goal_node, struct Level* lvl) {
-    // 1. Conta i nodi risalendo i parent
-    int count = 0;
-    PathNode* node = goal_node;
-    while (node != NULL) {
-        count++;
-        node = node->parent;
-    }
+// Sotto questa soglia di obiettivi l'A* usa la distanza dal rettangolo più
+// vicino come euristica; oltre costa più di quanto fa risparmiare: Dijkstra
+#define NEAREST_HEURISTIC_GOALS 16
 
-    if (count == 0) return NULL;
+// Cella goal (indice in grid[], piano del terreno) e obiettivo che rappresenta
+typedef struct {
+    int cell;
+    int goal;
+} GoalCell;
 
-    // 2. Crea l'oggetto Path finale
-    Path* path = path_create(count);
-    if (!path) return NULL;
+// Rettangolo delle celle goal di un obiettivo (coordinate della finestra)
+typedef struct {
+    int x0, z0, x1, z1;
+} GoalRect;
 
-    // Impostiamo subito il count finale, così possiamo accedere all'array direttamente
-    path->waypoint_count = count;
+typedef struct {
+    GoalCell* cells;
+    int count;
+    int capacity;
+    GoalRect rects[NEAREST_HEURISTIC_GOALS];
+    int rect_count;          // 0 = Dijkstra
+    float max_cost;          // Early-out in celle (FLT_MAX = nessun limite)
+    int start_zone;          // -1 = nessun filtro
+} GoalSet;
+
+static int goal_cell_compare(const void* a, const void* b) {
+    const GoalCell* ga = (const GoalCell*)a;
+    const GoalCell* gb = (const GoalCell*)b;
+    if (ga->cell != gb->cell) return ga->cell < gb->cell ? -1 : 1;
+    return ga->goal - gb->goal;
+}
 
-    // 3. Riempi i waypoint direttamente in ordine inverso
-    // (Dal Goal allo Start, ma scrivendo dall'ultimo indice al primo)
-    int i = count - 1;
-    node = goal_node;
-    
-    while (node != NULL) {
-        // Scriviamo direttamente nella memoria del Path finale
-        // Nota: path->waypoints[i] è un vec3, che è un array float[3]
-        ctx_grid_to_world(node->x, node->z, lvl, path->waypoints[i]);
-        
-        i--;
-        node = node->parent;
+static bool goal_set_add(GoalSet* set, int cell, int goal) {
+    if (set->count >= set->capacity) {
+        int new_capacity = set->capacity ? set->capacity * 2 : 256;
+        GoalCell* new_cells = (GoalCell*)realloc(set->cells, new_capacity * sizeof(GoalCell));
+        if (!new_cells) return false;
+        set->cells = new_cells;
+        set->capacity = new_capacity;
     }
+    set->cells[set->count].cell = cell;
+    set->cells[set->count].goal = goal;
+    set->count++;
+    return true;
+}
 
-    return path;
+// Obiettivo della cella (indice più basso se più obiettivi la condividono), -1 se nessuno
+static int goal_set_find(const GoalSet* set, int cell) {
+    int lo = 0, hi = set->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (set->cells[mid].cell < cell) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < set->count && set->cells[lo].cell == cell ? set->cells[lo].goal : -1;
 }
 
+// Distanza dal rettangolo più vicino: ammissibile e consistente (ogni cella
+// goal sta nel rettangolo del suo obiettivo)
+static float goal_set_heuristic(const GoalSet* set, int x, int z) {
+    if (set->rect_count == 0) return 0.0f;
+
+    float best = FLT_MAX;
+    for (int i = 0; i < set->rect_count; i++) {
+        const GoalRect* r = &set->rects[i];
+        int dx = x < r->x0 ? r->x0 - x : (x > r->x1 ? x - r->x1 : 0);
+        int dz = z < r->z0 ? r->z0 - z : (z > r->z1 ? z - r->z1 : 0);
+        float d = sqrtf((float)(dx * dx + dz * dz));
+        if (d < best) best = d;
+    }
+    return best;
+}
 
-static Path* astar_static_context(vec3 start, vec3 goal, struct Level* lvl) {
-    // Reset pool nodi e heap
-    g_node_pool_used = 0;
-    g_ctx->pq->size = 0; 
+// Cella della finestra accettabile come goal: walkable per l'agente (grid[]
+// tiene già conto della clearance) e nella zona dello start
+static bool goal_cell_usable(PathfindingContext* ctx, struct Level* lvl, const GoalSet* set, int x, int z) {
+    if (x < 0 || x >= ctx->current_width || z < 0 || z >= ctx->current_height) return false;
+    if (ctx->grid[z * TEMP_GRID_WIDTH + x] == 0) return false;
+    if (set->start_zone < 0) return true;
 
-    int start_x, start_z, goal_x, goal_z;
+    int zone = zones_get_cell(lvl, ctx->window_cell_x + x, ctx->window_cell_z + z);
+    return zone == set->start_zone || layers_zones_linked(lvl, set->start_zone, zone);
+}
 
-    // 1. Converti coordinate World -> Grid
-    if (!ctx_world_to_grid(start, &start_x, &start_z)) {
-        printf("[Pathfinding] Start position outside active window (%.2f, %.2f)\n", start[0], start[2]);
-        return NULL;
+// Celle goal di un obiettivo: quelle coperte dal footprint se almeno una è
+// walkable, altrimenti (struttura che blocca le proprie celle) quelle a
+// distanza di Chebyshev <= reach dal footprint, dove l'agente può arrivare
+static bool goal_set_add_footprint(GoalSet* set, PathfindingContext* ctx, struct Level* lvl,
+                                   const PathFootprint* fp, int goal, int reach) {
+    float cell_size = ctx->current_cell_size;
+    float ex, ez;
+    footprint_extent(fp, &ex, &ez);
+
+    // Rettangolo del footprint in celle della finestra, allargato di reach
+    int fx0 = (int)floorf((fp->center_x - ex - ctx->current_origin_x) / cell_size);
+    int fz0 = (int)floorf((fp->center_z - ez - ctx->current_origin_z) / cell_size);
+    int fx1 = (int)floorf((fp->center_x + ex - ctx->current_origin_x) / cell_size);
+    int fz1 = (int)floorf((fp->center_z + ez - ctx->current_origin_z) / cell_size);
+    int center_x = (int)floorf((fp->center_x - ctx->current_origin_x) / cell_size);
+    int center_z = (int)floorf((fp->center_z - ctx->current_origin_z) / cell_size);
+
+    int w = fx1 - fx0 + 1 + 2 * reach;
+    int h = fz1 - fz0 + 1 + 2 * reach;
+    uint8_t* covered = (uint8_t*)calloc((size_t)w * h, 1);
+    if (!covered) return false;
+
+    // Celle coperte (stessa regola degli ostacoli dinamici: centro della cella
+    // nel footprint, sempre la cella del centro)
+    bool any_walkable = false;
+    for (int z = fz0; z <= fz1; z++) {
+        for (int x = fx0; x <= fx1; x++) {
+            float wx = ctx->current_origin_x + (x + 0.5f) * cell_size;
+            float wz = ctx->current_origin_z + (z + 0.5f) * cell_size;
+            if ((x != center_x || z != center_z) && !footprint_contains(fp, wx, wz)) continue;
+
+            covered[(z - fz0 + reach) * w + (x - fx0 + reach)] = 1;
+            if (goal_cell_usable(ctx, lvl, set, x, z)) any_walkable = true;
+        }
     }
 
-    if (!ctx_world_to_grid(goal, &goal_x, &goal_z)) {
-        printf("[Pathfinding] Goal position outside active window (%.2f, %.2f)\n", goal[0], goal[2]);
-        return NULL;
-    }
+    int first = set->count;
+    GoalRect rect = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+    bool ok = true;
 
-    // 2. Calcola indici lineari (UNA VOLTA SOLA)
-    // Nota: Usiamo sempre TEMP_GRID_WIDTH (192) per l'indicizzazione dell'array statico
-    int start_idx = start_z * TEMP_GRID_WIDTH + start_x;
-    int goal_idx = goal_z * TEMP_GRID_WIDTH + goal_x;
+    for (int j = 0; j < h && ok; j++) {
+        for (int i = 0; i < w && ok; i++) {
+            int x = fx0 - reach + i;
+            int z = fz0 - reach + j;
+
+            bool is_goal;
+            if (any_walkable) {
+                is_goal = covered[j * w + i] != 0;
+            } else {
+                // Anello attorno al footprint: una cella coperta entro reach
+                is_goal = false;
+                for (int dj = -reach; dj <= reach && !is_goal; dj++) {
+                    int nj = j + dj;
+                    if (nj < 0 || nj >= h) continue;
+                    for (int di = -reach; di <= reach; di++) {
+                        int ni = i + di;
+                        if (ni >= 0 && ni < w && covered[nj * w + ni]) {
+                            is_goal = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (!is_goal || !goal_cell_usable(ctx, lvl, set, x, z)) continue;
 
-    // 3. Verifica walkability immediata (Fail-Fast)
-    if (g_ctx->grid[start_idx] == 0) {
-         //printf("[Pathfinding] Start position is not walkable\n");
-         return NULL;
+            ok = goal_set_add(set, z * TEMP_GRID_WIDTH + x, goal);
+            if (x < rect.x0) rect.x0 = x;
+            if (z < rect.z0) rect.z0 = z;
+            if (x > rect.x1) rect.x1 = x;
+            if (z > rect.z1) rect.z1 = z;
+        }
     }
-    if (g_ctx->grid[goal_idx] == 0) {
-         //printf("[Pathfinding] Goal position is not walkable\n");
-         return NULL;
+    free(covered);
+
+    if (ok && set->count > first) {
+        // Troppi obiettivi per l'euristica: la ricerca diventa una Dijkstra
+        if (set->rect_count >= 0 && set->rect_count < NEAREST_HEURISTIC_GOALS) {
+            set->rects[set->rect_count++] = rect;
+        } else {
+            set->rect_count = -1;
+        }
     }
+    return ok;
+}
 
-    // 4. Setup nodo start
-    PathNode* start_node = get_node_from_pool(start_x, start_z);
-    if (!start_node) return NULL; // Safety check se il pool esplode
-
-    start_node->g_cost = 0.0f;
-    // Assicurati che heuristic sia definita (es. heuristic_euclidean)
-    start_node->h_cost = heuristic_euclidean(start_x, start_z, goal_x, goal_z);
-    start_node->f_cost = start_node->h_cost;
-    
-    // 5. Inseriamo nell'array "visited" e "g_costs"
-    // CORREZIONE: Qui usiamo start_idx già calcolato sopra, senza "int" davanti
-    g_ctx->visited_tag[start_idx] = g_ctx->current_search_id; 
-    g_ctx->g_costs[start_idx] = 0.0f;
-    
-    pq_push(g_ctx->pq, start_node);
-
-    // Direzioni: 8-connected
+// A* (o Dijkstra) dalla cella start fino alla prima cella goal estratta
+// dall'open set: la più vicina per costo del path tra tutti gli obiettivi
+static Path* nearest_expand(PathfindingContext* ctx, struct Level* lvl, const GoalSet* set,
+                            int start_idx, int* out_goal) {
     int dx[] = {0, 0, 1, -1, 1, -1, 1, -1};
     int dz[] = {1, -1, 0, 0, 1, 1, -1, -1};
     float costs[] = {1.0f, 1.0f, 1.0f, 1.0f, 1.414f, 1.414f, 1.414f, 1.414f};
 
-    // 6. Loop A* principale
-    while (!pq_is_empty(g_ctx->pq)) {
-        PathNode* current = pq_pop(g_ctx->pq);
+    ctx->heap_size = 0;
+    ctx->landmarks = NULL;
+    int start_cell = start_idx % MAX_GRID_CELLS;
+    ctx_open_cell(ctx, start_idx, false, 0.0f,
+                  goal_set_heuristic(set, start_cell % TEMP_GRID_WIDTH, start_cell / TEMP_GRID_WIDTH), -1);
+
+    while (!pq_is_empty(ctx)) {
+        // f non scende mai sotto il costo di un path che passa dalla cella:
+        // oltre max_cost nessun obiettivo è abbastanza vicino
+        if (ctx->heap[0].f_cost > set->max_cost) break;
 
-        if (current->x == goal_x && current->z == goal_z) {
-            return reconstruct_path_static(current, lvl);
+        int c_idx = pq_pop(ctx);
+        ctx->stats.nodes_expanded++;
+
+        int goal = c_idx < MAX_GRID_CELLS ? goal_set_find(set, c_idx) : -1;
+        if (goal >= 0) {
+            *out_goal = goal;
+            return reconstruct_path_static(ctx, c_idx, lvl);
         }
 
-        // Espansione vicini
-        for (int i = 0; i < 8; i++) {
-            int nx = current->x + dx[i];
-            int nz = current->z + dz[i];
+        int cell = c_idx % MAX_GRID_CELLS;
+        int plane = c_idx - cell;
+        int cx = cell % TEMP_GRID_WIDTH;
+        int cz = cell / TEMP_GRID_WIDTH;
+        float c_g = ctx->g_costs[c_idx];
 
-            // Bounds check usando le dimensioni ATTUALI della finestra (non 192, ma la larghezza reale caricata)
-            if (nx < 0 || nx >= g_ctx->current_width || nz < 0 || nz >= g_ctx->current_height) continue;
+        for (int i = 0; i < 8; i++) {
+            int nx = cx + dx[i];
+            int nz = cz + dz[i];
+            if (nx < 0 || nx >= ctx->current_width || nz < 0 || nz >= ctx->current_height) continue;
 
-            int n_idx = nz * TEMP_GRID_WIDTH + nx;
+            int n_idx = plane + nz * TEMP_GRID_WIDTH + nx;
+            if (ctx->grid[n_idx] == 0) continue;
 
-            // Walkability check su static grid
-            if (g_ctx->grid[n_idx] == 0) continue;
+            float new_g = c_g + costs[i] * ctx->cell_weight[ctx->grid[n_idx]];
+            bool visited = ctx->visited_tag[n_idx] == ctx->current_search_id;
+            if (visited && new_g >= ctx->g_costs[n_idx]) continue;
 
-            float new_g = current->g_cost + costs[i];
+            float f = new_g + goal_set_heuristic(set, nx, nz);
+            if (f > set->max_cost) continue;
+            ctx_open_cell(ctx, n_idx, visited, new_g, f, c_idx);
+        }
 
-            // Check se già visitato in QUESTO search ID
-            bool visited_in_this_search = (g_ctx->visited_tag[n_idx] == g_ctx->current_search_id);
-            
-            // Se visitato e il costo non è migliore, skip
-            if (visited_in_this_search && new_g >= g_ctx->g_costs[n_idx]) {
-                continue;
-            }
+        // Link verso altri layer (i goal restano sul terreno)
+        if ((ctx->grid[c_idx] & CELL_LINK) == 0) continue;
 
-            // Trovato percorso migliore o nuovo nodo
-            PathNode* neighbor = get_node_from_pool(nx, nz);
-            if (!neighbor) return NULL; // Pool esaurito, path fallito
+        for (int l = 0; l < ctx->window_link_count; l++) {
+            const WindowLink* link = &ctx->window_links[l];
+            if (link->from != c_idx) continue;
 
-            neighbor->g_cost = new_g;
-            neighbor->h_cost = heuristic_euclidean(nx, nz, goal_x, goal_z);
-            neighbor->f_cost = new_g + neighbor->h_cost;
-            neighbor->parent = current;
+            int n_idx = link->to;
+            float new_g = c_g + link->cost * ctx->cell_weight[ctx->grid[n_idx]];
+            bool visited = ctx->visited_tag[n_idx] == ctx->current_search_id;
+            if (visited && new_g >= ctx->g_costs[n_idx]) continue;
 
-            // Aggiorna tag e costi
-            g_ctx->visited_tag[n_idx] = g_ctx->current_search_id;
-            g_ctx->g_costs[n_idx] = new_g;
-            
-            pq_push(g_ctx->pq, neighbor);
+            int n_cell = n_idx % MAX_GRID_CELLS;
+            float f = new_g + goal_set_heuristic(set, n_cell % TEMP_GRID_WIDTH, n_cell / TEMP_GRID_WIDTH);
+            if (f > set->max_cost) continue;
+            ctx_open_cell(ctx, n_idx, visited, new_g, f, c_idx);
         }
     }
-    
+
     return NULL;
 }
 
+static Path* find_nearest_internal(PathfindingContext* ctx, struct Level* lvl, vec3 start,
+                                   const PathFootprint* goals, int goal_count, float max_dist,
+                                   const PathQueryParams* params, int* out_goal) {
+    if (goal_count <= 0 || !level_get_chunk_at(lvl, start[0], start[2])) return NULL;
+
+    ctx_set_cost_profile(ctx, params->cost_profile);
+    ctx->min_clearance = pathfinding_clearance_for_radius(lvl, params->agent_radius);
+    int reach = ctx->min_clearance > 1 ? ctx->min_clearance : 1;
+    float cell_size = pathfinding_level_cell_size(lvl);
+
+    // Zona dello start: obiettivi in zone non collegate scartati senza cercare
+    int start_layer = layers_pick(lvl, start);
+    int start_zone = -1;
+    if (lvl->zoneMap && start_layer == 0) {
+        start_zone = zones_get(lvl, start);
+        if (start_zone == ZONE_NONE) {
+            ctx->stats.paths_rejected_zone++;
+            return NULL;
+        }
+    }
 
-bool path_add_waypoint(Path* path, vec3 waypoint) {
-    if (!path) return false;
+    // Finestra: start e obiettivi entro max_dist in linea d'aria (il path non
+    // è mai più corto), limitata ai chunk del livello
+    float min_x = start[0], max_x = start[0];
+    float min_z = start[2], max_z = start[2];
+    float margin = (reach + 1) * cell_size;
+    for (int g = 0; g < goal_count; g++) {
+        float ex, ez;
+        footprint_extent(&goals[g], &ex, &ez);
+        float dx = fmaxf(fabsf(goals[g].center_x - start[0]) - ex - margin, 0.0f);
+        float dz = fmaxf(fabsf(goals[g].center_z - start[2]) - ez - margin, 0.0f);
+        if (max_dist > 0.0f && dx * dx + dz * dz > max_dist * max_dist) continue;
+
+        min_x = fminf(min_x, goals[g].center_x - ex - margin);
+        max_x = fmaxf(max_x, goals[g].center_x + ex + margin);
+        min_z = fminf(min_z, goals[g].center_z - ez - margin);
+        max_z = fmaxf(max_z, goals[g].center_z + ez + margin);
+    }
+    vec3 lo = { fmaxf(min_x, lvl->originX), 0.0f, fmaxf(min_z, lvl->originZ) };
+    vec3 hi = { fminf(max_x, lvl->originX + lvl->totalSizeX - 0.001f), 0.0f,
+                fminf(max_z, lvl->originZ + lvl->totalSizeZ - 0.001f) };
+
+    int chunkX, chunkZ, chunksX, chunksZ;
+    if (!compute_chunk_window(lvl, lo, hi, &chunkX, &chunkZ, &chunksX, &chunksZ)) {
+        // Obiettivi oltre la finestra 3x3: la finestra attorno allo start
+        chunkX = (int)floorf((start[0] - lvl->originX) / lvl->chunkSize) - MAX_CHUNKS_X / 2;
+        chunkZ = (int)floorf((start[2] - lvl->originZ) / lvl->chunkSize) - MAX_CHUNKS_Z / 2;
+        chunksX = lvl->chunksCountX < MAX_CHUNKS_X ? lvl->chunksCountX : MAX_CHUNKS_X;
+        chunksZ = lvl->chunksCountZ < MAX_CHUNKS_Z ? lvl->chunksCountZ : MAX_CHUNKS_Z;
+        if (chunkX > lvl->chunksCountX - chunksX) chunkX = lvl->chunksCountX - chunksX;
+        if (chunkZ > lvl->chunksCountZ - chunksZ) chunkZ = lvl->chunksCountZ - chunksZ;
+        if (chunkX < 0) chunkX = 0;
+        if (chunkZ < 0) chunkZ = 0;
+    }
 
-    // Espandi se necessario
-    if (path->waypoint_count >= path->capacity) {
-        int new_capacity = path->capacity * 2;
-        vec3* new_waypoints = (vec3*)realloc(path->waypoints, new_capacity * sizeof(vec3));
-        if (!new_waypoints) return false;
-        path->waypoints = new_waypoints;
-        path->capacity = new_capacity;
+    uint64_t version = level_chunks_version(lvl, chunkX, chunkZ, chunksX, chunksZ);
+    if (lvl->pathLayers) version += lvl->pathLayers->version;
+    if (!ctx_prepare_window(ctx, lvl, chunkX, chunkZ, chunksX, chunksZ, version)) return NULL;
+
+    int start_x, start_z;
+    if (!ctx_world_to_grid(ctx, start, &start_x, &start_z)) return NULL;
+    int start_idx = ctx_layer_cell(ctx, start_layer, ctx->window_cell_x + start_x, ctx->window_cell_z + start_z);
+    if (start_idx < 0 || ctx->grid[start_idx] == 0) return NULL;
+
+    // Celle goal di tutti gli obiettivi, ordinate per la ricerca binaria
+    GoalSet set;
+    memset(&set, 0, sizeof(set));
+    set.max_cost = max_dist > 0.0f ? max_dist / cell_size : FLT_MAX;
+    set.start_zone = start_zone;
+
+    for (int g = 0; g < goal_count; g++) {
+        if (!goal_set_add_footprint(&set, ctx, lvl, &goals[g], g, reach)) {
+            printf("[Pathfinding] ERROR: Failed to allocate goal cells\n");
+            free(set.cells);
+            return NULL;
+        }
+    }
+    if (set.count == 0) {
+        ctx->stats.paths_rejected_zone++;
+        return NULL;
     }
+    if (set.rect_count < 0) set.rect_count = 0;
+    qsort(set.cells, set.count, sizeof(GoalCell), goal_cell_compare);
 
-    glm_vec3_copy(waypoint, path->waypoints[path->waypoint_count]);
-    path->waypoint_count++;
-    return true;
-}
+    Path* path = nearest_expand(ctx, lvl, &set, start_idx, out_goal);
+    free(set.cells);
 
-void path_free(Path* path) {
-    if (!path) return;
-    if (path->waypoints) {
-        free(path->waypoints);
+    if (path && (params->flags & PATH_QUERY_NO_SMOOTH) == 0) {
+        ctx->current_level = lvl;
+        path_smooth_ctx(ctx, path);
+        ctx->current_level = NULL;
     }
-    free(path);
+    return path;
 }
 
-bool world_to_grid(struct Terrain* chunk, vec3 world_pos, int* out_x, int* out_z) {
-    if (!chunk || !out_x || !out_z) return false;
+Path* pathfinding_find_nearest_ctx(PathfindingContext* ctx, struct Level* lvl, vec3 start,
+                                   const PathFootprint* goals, int goal_count, float max_dist,
+                                   const PathQueryParams* params, int* out_goal) {
+    if (out_goal) *out_goal = -1;
+    if (!ctx || !lvl || !goals || !params) return NULL;
 
-    // Converti world → UV (0.0 a 1.0)
-    float u = (world_pos[0] - chunk->offsetX) / chunk->worldSize;
-    float v = (world_pos[2] - chunk->offsetZ) / chunk->worldSize;
+    double t_start = get_time_ms();
+    int goal = -1;
+    Path* path = find_nearest_internal(ctx, lvl, start, goals, goal_count, max_dist, params, &goal);
+    ctx_record_query(ctx, path != NULL, (float)(get_time_ms() - t_start));
 
-    // Bounds check
-    if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f) {
-        return false;
+    if (path && out_goal) *out_goal = goal;
+    return path;
+}
+
+Path* pathfinding_find_nearest(struct Level* lvl, vec3 start, const PathFootprint* goals, int goal_count,
+                               float max_dist, const PathQueryParams* params, int* out_goal) {
+    if (!g_ctx) {
+        printf("[Pathfinding] ERROR: pathfinding_init() not called\n");
+        return NULL;
     }
+    return pathfinding_find_nearest_ctx(g_ctx, lvl, start, goals, goal_count, max_dist, params, out_goal);
+}
 
-    // UV → Grid coords (ogni cella copre 1/PATHGRID_SIZE dello spazio UV)
-    *out_x = (int)(u * PATHGRID_SIZE);
-    *out_z = (int)(v * PATHGRID_SIZE);
+// ============================================================================
+// BATCH
+// ============================================================================
 
-    // Clamp per sicurezza (u=1.0 esatto va a cella 64, che non esiste)
-    if (*out_x >= PATHGRID_SIZE) *out_x = PATHGRID_SIZE - 1;
-    if (*out_z >= PATHGRID_SIZE) *out_z = PATHGRID_SIZE - 1;
+// Chiave di ordinamento di una richiesta del batch
+typedef struct {
+    int in_window;           // 0 oltre la finestra (HPA*): in fondo, senza riuso
+    int chunk_x, chunk_z, chunks_x, chunks_z;
+    uint32_t profile_hash;
+    int clearance;
+    int index;
+} BatchEntry;
+
+// Confronto dei campi prima di index: 0 = stessa finestra
+static int batch_entry_compare_window(const BatchEntry* a, const BatchEntry* b) {
+    if (a->in_window != b->in_window) return b->in_window - a->in_window;
+    if (a->chunk_z != b->chunk_z) return a->chunk_z - b->chunk_z;
+    if (a->chunk_x != b->chunk_x) return a->chunk_x - b->chunk_x;
+    if (a->chunks_z != b->chunks_z) return a->chunks_z - b->chunks_z;
+    if (a->chunks_x != b->chunks_x) return a->chunks_x - b->chunks_x;
+    if (a->profile_hash != b->profile_hash) return a->profile_hash < b->profile_hash ? -1 : 1;
+    return a->clearance - b->clearance;
+}
 
-    return true;
+static int batch_entry_compare(const void* a, const void* b) {
+    const BatchEntry* ea = (const BatchEntry*)a;
+    const BatchEntry* eb = (const BatchEntry*)b;
+    int cmp = batch_entry_compare_window(ea, eb);
+    return cmp != 0 ? cmp : ea->index - eb->index;  // Ordine stabile dentro il gruppo
 }
 
-// Algoritmo di Bresenham o raymarching sulla griglia per vedere se la linea è libera
-bool pathgrid_line_of_sight(PathGrid* pg, int x0, int z0, int x1, int z1) {
-    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-    int dz = abs(z1 - z0), sz = z0 < z1 ? 1 : -1; 
-    int err = (dx > dz ? dx : -dz) / 2, e2;
- 
-    while (true) {
-        if (!pathgrid_is_walkable(pg, x0, z0)) return false;
-        if (x0 == x1 && z0 == z1) break;
-        e2 = err;
-        if (e2 > -dx) { err -= dz; x0 += sx; }
-        if (e2 < dz) { err += dx; z0 += sz; }
+int pathfinding_batch_order(struct Level* lvl, const PathBatchRequest* requests, int count,
+                            int* out_order, int* out_group_start) {
+    if (!lvl || !requests || count <= 0 || !out_order || !out_group_start) return 0;
+
+    BatchEntry* entries = (BatchEntry*)malloc(count * sizeof(BatchEntry));
+    if (!entries) {
+        // Senza memoria: un solo gruppo nell'ordine originale
+        for (int i = 0; i < count; i++) out_order[i] = i;
+        out_group_start[0] = 0;
+        out_group_start[1] = count;
+        return 1;
     }
-    return true;
-}
 
-void path_smooth(Path* path) {
-    if (!path || path->waypoint_count <= 2) return;
+    for (int i = 0; i < count; i++) {
+        const PathBatchRequest* req = &requests[i];
+        BatchEntry* e = &entries[i];
+        memset(e, 0, sizeof(*e));
+        e->index = i;
+
+        vec3 start, goal;
+        glm_vec3_copy((float*)req->start, start);
+        glm_vec3_copy((float*)req->goal, goal);
+        e->in_window = compute_chunk_window(lvl, start, goal, &e->chunk_x, &e->chunk_z,
+                                            &e->chunks_x, &e->chunks_z) ? 1 : 0;
+        if (!e->in_window) e->chunk_x = e->chunk_z = e->chunks_x = e->chunks_z = 0;
+
+        e->profile_hash = cost_profile_hash(req->params.cost_profile);
+        e->clearance = pathfinding_clearance_for_radius(lvl, req->params.agent_radius);
+    }
 
-    // Creiamo un nuovo path temporaneo per i punti ottimizzati
-    // Nel caso peggiore avrà la stessa dimensione dell'originale
-    vec3* new_waypoints = (vec3*)malloc(path->capacity * sizeof(vec3));
-    int new_count = 0;
+    qsort(entries, count, sizeof(BatchEntry), batch_entry_compare);
 
-    // Aggiungi sempre il primo punto (Start)
-    glm_vec3_copy(path->waypoints[0], new_waypoints[0]);
-    new_count++;
+    int groups = 0;
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || batch_entry_compare_window(&entries[i - 1], &entries[i]) != 0) {
+            out_group_start[groups++] = i;
+        }
+        out_order[i] = entries[i].index;
+    }
+    out_group_start[groups] = count;
 
-    int current_idx = 0;
+    free(entries);
+    return groups;
+}
 
-    while (current_idx < path->waypoint_count - 1) {
-        // Cerca il punto più lontano visibile dal corrente
-        // Partiamo dalla fine e torniamo indietro verso current
-        bool found_shortcut = false;
-        
-        for (int check_idx = path->waypoint_count - 1; check_idx > current_idx + 1; check_idx--) {
-            if (check_world_visibility(path->waypoints[current_idx], path->waypoints[check_idx])) {
-                // Trovato shortcut! Il punto check_idx diventa il prossimo nel path
-                current_idx = check_idx;
-                glm_vec3_copy(path->waypoints[current_idx], new_waypoints[new_count]);
-                new_count++;
-                found_shortcut = true;
-                break;
-            }
-        }
+void pathfinding_find_paths_ctx(PathfindingContext* ctx, struct Level* lvl,
+                                const PathBatchRequest* requests, int count, Path** results) {
+    if (!results || count <= 0) return;
+    for (int i = 0; i < count; i++) results[i] = NULL;
+    if (!ctx || !lvl || !requests) return;
 
-        // Se non trovo scorciatoie lunghe, devo per forza andare al punto successivo
-        if (!found_shortcut) {
-            current_idx++;
-            glm_vec3_copy(path->waypoints[current_idx], new_waypoints[new_count]);
-            new_count++;
-        }
+    int* order = (int*)malloc((2 * count + 1) * sizeof(int));
+    if (!order) {
+        printf("[Pathfinding] ERROR: Failed to allocate batch of %d requests\n", count);
+        return;
+    }
+    int* group_start = order + count;
+    pathfinding_batch_order(lvl, requests, count, order, group_start);
+
+    // Gruppi consecutivi: search_setup ricostruisce la finestra solo al cambio di gruppo
+    for (int i = 0; i < count; i++) {
+        const PathBatchRequest* req = &requests[order[i]];
+        vec3 start, goal;
+        glm_vec3_copy((float*)req->start, start);
+        glm_vec3_copy((float*)req->goal, goal);
+        results[order[i]] = pathfinding_find_path_ctx_ex(ctx, lvl, start, goal, &req->params);
     }
 
-    // Sostituisci i waypoint vecchi con quelli nuovi
-    free(path->waypoints);
-    path->waypoints = new_waypoints;
-    path->waypoint_count = new_count;
-    
-  
+    free(order);
+}
+
+void pathfinding_find_paths(struct Level* lvl, const PathBatchRequest* requests, int count, Path** results) {
+    if (!g_ctx) {
+        printf("[Pathfinding] ERROR: pathfinding_init() not called\n");
+        for (int i = 0; results && i < count; i++) results[i] = NULL;
+        return;
+    }
+    pathfinding_flush_changes();
+    pathfinding_find_paths_ctx(g_ctx, lvl, requests, count, results);
 }
 
 Path* pathfinding_find_path(struct Level* lvl, vec3 start, vec3 goal, int zone_id) {
-    (void)zone_id; // Non usato per ora
+    PathQueryParams params = pathfinding_query_defaults();
+    params.zone_id = zone_id;
+    return pathfinding_find_path_ex(lvl, start, goal, &params);
+}
 
-    if (!lvl) return NULL;
+PathSearch* pathfinding_search_begin_ctx(PathfindingContext* ctx, struct Level* lvl, vec3 start, vec3 goal,
+                                         const PathQueryParams* params) {
+    if (!ctx || !lvl || !params) return NULL;
 
-    // 1. Identifica i chunk di partenza e arrivo per validazione di base
-    struct Terrain* start_chunk = level_get_chunk_at(lvl, start[0], start[2]);
-    struct Terrain* goal_chunk = level_get_chunk_at(lvl, goal[0], goal[2]);
+    PathSearch* search = (PathSearch*)malloc(sizeof(PathSearch));
+    if (!search) return NULL;
 
-    if (!start_chunk) {
-        printf("[Pathfinding] Start position outside level\n");
-        return NULL;
-    }
-    if (!goal_chunk) {
-        printf("[Pathfinding] Goal position outside level\n");
-        return NULL;
-    }
+    double t_start = get_time_ms();
+    search_setup(search, ctx, lvl, start, goal, params);
+    search->time_ms = (float)(get_time_ms() - t_start);
 
-    // 2. OTTIMIZZAZIONE: Line of Sight (Raycast)
-    // Se siamo nello stesso chunk, prova prima a tracciare una linea retta.
-    // Se la linea è libera, evita completamente il costo di setup_static_grid e A*.
-    if (start_chunk == goal_chunk) {
-        int sx, sz, gx, gz;
-        // Nota: qui usiamo la funzione locale del chunk, non quella globale del contesto
-        if (world_to_grid(start_chunk, start, &sx, &sz) && 
-            world_to_grid(start_chunk, goal, &gx, &gz)) {
-            
-            // Supponendo tu abbia implementato pathgrid_line_of_sight come discusso prima
-            if (pathgrid_line_of_sight(&start_chunk->pathgrid, sx, sz, gx, gz)) {
-                 Path* simple_path = path_create(2);
-                 path_add_waypoint(simple_path, start); // Start
-                 path_add_waypoint(simple_path, goal);  // End
-                 return simple_path;
-            }
-        }
+    if (search->status != PATH_STATUS_IN_PROGRESS) {
+        ctx_record_query(ctx, search->status == PATH_STATUS_FOUND, search->time_ms);
     }
+    return search;
+}
 
-    // ========================================================================
-    // 3. PREPARAZIONE CONTESTO (Il punto che chiedevi)
-    // ========================================================================
-    // Qui popoliamo g_ctx->grid copiando i dati dai chunk necessari (max 3x3).
-    // Questo sovrascrive i dati della richiesta precedente nel buffer statico.
-    if (!setup_static_grid(lvl, start, goal)) {
-        printf("[Pathfinding] Failed to build static grid context\n");
+PathSearch* pathfinding_search_begin(struct Level* lvl, vec3 start, vec3 goal, const PathQueryParams* params) {
+    if (!g_ctx) {
+        printf("[Pathfinding] ERROR: pathfinding_init() not called\n");
         return NULL;
     }
+    pathfinding_flush_changes();
+    return pathfinding_search_begin_ctx(g_ctx, lvl, start, goal, params);
+}
 
-    // ========================================================================
-    // 4. ESECUZIONE A*
-    // ========================================================================
-    // Ora che g_ctx è pronto, lanciamo l'algoritmo.
-    // Non passiamo più griglie temporanee, perché A* leggerà da g_ctx globale.
-    Path* path = astar_static_context(start, goal, lvl);
-     
-    // 5. SMOOTHING (usa walkmap a piena risoluzione per line-of-sight)
-    if (path) {
-        // Salva il puntatore al livello per check_world_visibility
-        g_ctx->current_level = lvl;
-        path_smooth(path);
-        g_ctx->current_level = NULL; // Cleanup
+PathSearchStatus pathfinding_search_step(PathSearch* search, int max_expansions, float max_time_us) {
+    if (!search) return PATH_STATUS_FAILED;
+    if (search->status != PATH_STATUS_IN_PROGRESS) return search->status;
+
+    double t_start = get_time_ms();
+
+    SearchBudget budget;
+    budget.max_expansions = max_expansions > 0 ? max_expansions : 0;
+    budget.deadline_ms = max_time_us > 0.0f ? t_start + max_time_us / 1000.0 : 0.0;
+
+    search_advance(search, &budget);
+    search->time_ms += (float)(get_time_ms() - t_start);
+
+    if (search->status != PATH_STATUS_IN_PROGRESS) {
+        ctx_record_query(search->ctx, search->status == PATH_STATUS_FOUND, search->time_ms);
     }
-    
+    return search->status;
+}
+
+PathSearchStatus pathfinding_search_status(PathSearch* search) {
+    return search ? search->status : PATH_STATUS_FAILED;
+}
+
+Path* pathfinding_search_take_path(PathSearch* search) {
+    if (!search) return NULL;
+    Path* path = search->path;
+    search->path = NULL;
     return path;
 }
+
+void pathfinding_search_end(PathSearch* search) {
+    if (!search) return;
+    hpa_query_destroy(search->hpa);
+    path_free(search->path);
+    free(search);
+}
+
 // ============================================================================
 // DEBUG UTILITIES
 // ============================================================================
@@ -926,29 +3409,54 @@ void pathfinding_debug_draw_path(Path* path, mat4 viewProj, vec3 color) {
     glBindVertexArray(0);
 }
 
+void pathfinding_context_print_stats(PathfindingContext* ctx) {
+    if (!ctx) return;
+    PathfindingStats* st = &ctx->stats;
+    printf("  Total requests: %d\n", st->total_paths_requested);
+    printf("  Found: %d\n", st->paths_found);
+    printf("  Failed: %d (%d rejected by zones)\n", st->paths_failed, st->paths_rejected_zone);
+    printf("  Windows reused: %d\n", st->windows_reused);
+    printf("  Avg time: %.2fms\n", st->total_paths_requested > 0 ?
+           st->total_time_ms / st->total_paths_requested : 0.0f);
+    printf("  Max time: %.2fms\n", st->max_time_ms);
+    printf("  Avg nodes expanded: %.1f\n", st->total_paths_requested > 0 ?
+           (double)st->nodes_expanded / st->total_paths_requested : 0.0);
+}
+
+void pathfinding_context_get_stats(PathfindingContext* ctx, PathfindingStats* out) {
+    if (!ctx || !out) return;
+    *out = ctx->stats;
+}
+
+size_t pathfinding_context_memory(void) {
+    return sizeof(PathfindingContext);
+}
+
 void pathfinding_print_stats(void) {
     printf("[Pathfinding] Stats:\n");
-    printf("  Total requests: %d\n", g_stats.total_paths_requested);
-    printf("  Found: %d\n", g_stats.paths_found);
-    printf("  Failed: %d\n", g_stats.paths_failed);
-    printf("  Avg time: %.2fms\n", g_stats.total_paths_requested > 0 ?
-           g_stats.total_time_ms / g_stats.total_paths_requested : 0.0f);
-    printf("  Max time: %.2fms\n", g_stats.max_time_ms);
+    pathfinding_context_print_stats(g_ctx);
+    pathfinding_cache_print_stats();
 }
 
 void pathfinding_reset_stats(void) {
-    memset(&g_stats, 0, sizeof(g_stats));
+    pathfinding_cache_reset_stats();
+    if (!g_ctx) return;
+    memset(&g_ctx->stats, 0, sizeof(g_ctx->stats));
 }
 
-void pathfinding_run_benchmark(struct Level* lvl) {
-    int iterations = 1000; // Numero di path da calcolare
+// Esegue il benchmark con un algoritmo (stesse coppie start/goal per ogni modalità)
+static void run_benchmark_mode(struct Level* lvl, PathSearchMode mode, const char* name, int iterations) {
     int found_count = 0;
-    
-    printf("=== PATHFINDING BENCHMARK (%d iterations) ===\n", iterations);
-    
+
+    PathQueryParams params = pathfinding_query_defaults();
+    params.mode = mode;
+    params.zone_id = -1;
+    params.flags = PATH_QUERY_NO_CACHE;   // Misura la ricerca, non la cache
+
     // Seed random fisso per ripetibilità (stessi path su Old vs New)
     srand(12345); 
 
+    long long nodes_before = g_ctx->stats.nodes_expanded;
     double start_time = get_time_ms();
 
     for (int i = 0; i < iterations; i++) {
@@ -973,7 +3481,7 @@ void pathfinding_run_benchmark(struct Level* lvl) {
         goal[1]  = level_get_height(lvl, goal[0], goal[2]);
 
         // Chiama il pathfinding
-        Path* p = pathfinding_find_path(lvl, start, goal, 0);
+        Path* p = pathfinding_find_path_ex(lvl, start, goal, &params);
         
         if (p) {
             found_count++;
@@ -984,9 +3492,25 @@ void pathfinding_run_benchmark(struct Level* lvl) {
     double end_time = get_time_ms();
     double total_time = end_time - start_time;
     double avg_time = total_time / iterations;
+    long long nodes = g_ctx->stats.nodes_expanded - nodes_before;
 
+    printf("[%s]\n", name);
     printf("Total Time: %.2f ms\n", total_time);
     printf("Avg Time per Path: %.4f ms\n", avg_time);
+    printf("Avg Nodes Expanded: %.1f\n", (double)nodes / iterations);
     printf("Paths Found: %d/%d\n", found_count, iterations);
+}
+
+void pathfinding_run_benchmark(struct Level* lvl) {
+    if (!g_ctx) return;
+
+    int iterations = 1000; // Numero di path da calcolare
+    
+    printf("=== PATHFINDING BENCHMARK (%d iterations) ===\n", iterations);
+
+    run_benchmark_mode(lvl, PATH_SEARCH_ASTAR, "A*", iterations);
+    run_benchmark_mode(lvl, PATH_SEARCH_JPS, "JPS", iterations);
+    run_benchmark_mode(lvl, PATH_SEARCH_THETA, "Theta*", iterations);
+
     printf("=============================================\n");
 }
@@ -2,25 +2,74 @@
 #define PATHFINDING_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <cglm/cglm.h>
+#include "pathfinding_bitgrid.h"
 
 // Forward declarations (opaque pointers)
 struct Level;
 struct Terrain;
 
+// Contesto di ricerca: griglia temporanea, stato per cella, open set e statistiche.
+// Ogni thread che esegue ricerche deve avere il proprio contesto.
+typedef struct PathfindingContext PathfindingContext;
+
 // ============================================================================
 // PATHFINDING GRID
 // ============================================================================
 
 #define PATHGRID_SIZE 64  // 64x64 grid per chunk (1m risoluzione)
 
+// Layer verticali: 0 = terreno, 1..PATH_MAX_LAYERS-1 ponti e camminamenti
+// sovrapposti (vedi pathfinding_layers.h)
+#define PATH_MAX_LAYERS 4
+
+// Classi di terreno del layer di costo (il peso di ogni classe lo decide la
+// query con PathCostProfile: fango lento, foresta, zona sotto tiro delle torri)
+#define PATH_TERRAIN_CLASSES 16
+
+typedef enum {
+    PATH_TERRAIN_NORMAL = 0,
+    PATH_TERRAIN_MUD,
+    PATH_TERRAIN_FOREST,
+    PATH_TERRAIN_DANGER
+    // Classi libere fino a PATH_TERRAIN_CLASSES - 1
+} PathTerrainClass;
+
+// Clearance di una cella: distanza (Chebyshev, in celle) dalla cella bloccata
+// più vicina, saturata a PATH_CLEARANCE_MAX. 0 = bloccata, 1 = walkable
+// accanto a un ostacolo; un agente di raggio r passa dove clearance >= r + 0.5 celle
+#define PATH_CLEARANCE_MAX 8
+
+// Downsampling della walkmap: un pixel è libero se > pixel_threshold, una
+// cella è walkable se almeno walkable_ratio dei suoi pixel sono liberi.
+// I pixel per cella seguono la risoluzione della walkmap (1024 / 64 = 16)
+#define PATHGRID_DEFAULT_PIXEL_THRESHOLD 128
+#define PATHGRID_DEFAULT_WALKABLE_RATIO 0.90f
+
 typedef struct {
-    uint8_t* grid;           // 64x64 walkability grid (0=blocked, 1=walkable)
+    uint8_t pixel_threshold;
+    float walkable_ratio;
+} PathGridBuildParams;
+
+// Overlay degli ostacoli dinamici di un chunk (torri, muri, caserme piazzati a runtime)
+typedef struct {
+    uint8_t refcount[PATHGRID_SIZE * PATHGRID_SIZE]; // Footprint che coprono la cella
+    uint8_t base[PATHGRID_SIZE * PATHGRID_SIZE];     // Walkability statica sotto gli ostacoli (valida se refcount > 0)
+} PathObstacleLayer;
+
+typedef struct {
+    uint8_t* grid;           // 64x64 walkability grid (0=blocked, 1=walkable), ostacoli dinamici inclusi
+    PathObstacleLayer* obstacles; // NULL finché nessun ostacolo è stato piazzato nel chunk
+    uint8_t* terrain;        // 64x64 classi di terreno (NULL = tutto PATH_TERRAIN_NORMAL)
+    uint8_t* clearance;      // 64x64 clearance (NULL = non calcolata, es. pathgrid dei layer)
+    BitGrid walk_bits;       // grid a 1 bit per cella (righe e colonne), per la line of sight
     int layer_id;            // ID del layer verticale (0 = ground level)
     float grid_cell_size;    // Dimensione cella in metri (tipicamente 1.0m)
     int grid_width;          // Larghezza griglia (64)
     int grid_height;         // Altezza griglia (64)
+    uint32_t version;        // Cambia a ogni modifica della griglia (invalida la path cache)
 } PathGrid;
 
 // ============================================================================
@@ -31,40 +80,322 @@ typedef struct {
     vec3* waypoints;         // Array di posizioni world
     int waypoint_count;      // Numero totale di waypoints
     int capacity;            // Capacità allocata
-    int layer_id;            // Layer su cui si trova questo path
+    int layer_id;            // Layer su cui si trova questo path (del goal, se attraversa più layer)
+    uint8_t* waypoint_layers; // Layer di ogni waypoint (NULL = tutti sul layer 0)
+    bool partial;            // Goal sostituito dalla cella raggiungibile più vicina (PATH_QUERY_NEAREST)
 } Path;
 
 // ============================================================================
 // PATHFINDING CORE API
 // ============================================================================
 
-// Inizializzazione/cleanup sistema pathfinding
+// Inizializzazione/cleanup sistema pathfinding (contesto del main thread)
 void pathfinding_init(void);
 void pathfinding_cleanup(void);
 
+// Contesti aggiuntivi (es. uno per worker thread, vedi pathfinding_service.h)
+PathfindingContext* pathfinding_context_create(void);
+void pathfinding_context_destroy(PathfindingContext* ctx);
+
 // PathGrid management
 bool pathgrid_init(PathGrid* pg, int width, int height, float cell_size);
 void pathgrid_cleanup(PathGrid* pg);
 
 // Build pathgrid da walkmap ad alta risoluzione
-// walkmap: array unsigned char (0-255, >128 = walkable)
-// walkmap_width/height: dimensioni della walkmap originale (es. 1024x1024)
-bool pathgrid_build(PathGrid* pg, unsigned char* walkmap, int walkmap_width, int walkmap_height);
+// walk_bits: walkmap già a bit (es. 1024x1024, vedi bitgrid_from_bytes)
+// walkable_ratio: frazione di pixel liberi per una cella walkable
+// Nessuno stato globale condiviso: chunk diversi si costruiscono in parallelo
+bool pathgrid_build(PathGrid* pg, const BitGrid* walk_bits, float walkable_ratio);
 
 // Verifica se una cella della griglia è walkable
 bool pathgrid_is_walkable(PathGrid* pg, int grid_x, int grid_z);
 
+// Verifica se una cella della griglia è coperta da un ostacolo dinamico
+bool pathgrid_has_obstacle(PathGrid* pg, int grid_x, int grid_z);
+
+// Line of sight (Bresenham) tra due celle dello stesso pathgrid, a tratti
+// sulle parole di walk_bits
+bool pathgrid_line_of_sight(PathGrid* pg, int x0, int z0, int x1, int z1);
+
+// ============================================================================
+// LEVEL GRID
+// ============================================================================
+// Coordinate di cella globali: i pathgrid di tutti i chunk affiancati
+// (cella 0,0 = angolo originX/originZ del livello)
+
+int pathfinding_level_cells_x(struct Level* lvl);
+int pathfinding_level_cells_z(struct Level* lvl);
+float pathfinding_level_cell_size(struct Level* lvl);
+
+// World -> cella globale. Ritorna false se fuori dal livello
+bool pathfinding_level_world_to_cell(struct Level* lvl, vec3 world_pos, int* out_x, int* out_z);
+
+// Cella globale -> world (centro cella, Y dall'heightmap)
+void pathfinding_level_cell_to_world(struct Level* lvl, int cell_x, int cell_z, vec3 out_world);
+
+// Walkability di una cella globale (false se fuori livello o chunk mancante)
+bool pathfinding_level_cell_walkable(struct Level* lvl, int cell_x, int cell_z);
+
+// Copia la walkability di tutto il livello in dst (cells_x * cells_z byte, row-major)
+void pathfinding_level_copy_walkability(struct Level* lvl, uint8_t* dst);
+
+// Classe di terreno di una cella globale (PATH_TERRAIN_NORMAL se fuori livello)
+uint8_t pathfinding_level_cell_terrain(struct Level* lvl, int cell_x, int cell_z);
+
+// Clearance di una cella globale (0 se bloccata o fuori livello)
+uint8_t pathfinding_level_cell_clearance(struct Level* lvl, int cell_x, int cell_z);
+
+// Clearance minima per un agente di raggio radius (m): 1 fino a mezza cella,
+// al massimo PATH_CLEARANCE_MAX
+int pathfinding_clearance_for_radius(struct Level* lvl, float radius);
+
+// Line of sight world tra a e b, la stessa dello smoothing dei path: walk mask
+// a piena risoluzione, ostacoli dinamici e (min_clearance > 1) clearance
+bool pathfinding_level_line_clear(struct Level* lvl, vec3 a, vec3 b, int min_clearance);
+
+// Ricalcola la clearance delle celle entro PATH_CLEARANCE_MAX dal rettangolo di
+// celle globali, tenendo conto dei chunk vicini (pathgrid_build la calcola per
+// il solo chunk). Chiamata da level_load su tutto il livello e dalle modifiche
+// di walkability; i chunk la cui clearance cambia ricevono una nuova versione.
+void pathfinding_update_clearance(struct Level* lvl, int x0, int z0, int x1, int z1);
+
+// ============================================================================
+// WALKABILITY EDITS
+// ============================================================================
+// Unico punto di modifica della walkability a runtime (muri distrutti, fiumi
+// ghiacciati, foreste bruciate...). Aggiorna subito pathgrid, walkmap e
+// clearance dei chunk (ricerche e line of sight vedono la modifica), mentre i
+// listener (flow field, HPA*, zone, landmark, planner D* Lite) vengono
+// notificati in differita: i rettangoli cambiati si accumulano, uniti quando
+// si toccano, fino a pathfinding_flush_changes. Così molti edit nello stesso
+// frame costano un solo aggiornamento delle strutture derivate.
+// Solo main thread, con pathfinding_service inattivo (path_service_wait_idle).
+
+// Rettangolo di celle globali modificate (estremi inclusi)
+typedef void (*PathfindingChangeCallback)(struct Level* lvl, int x0, int z0, int x1, int z1, void* user);
+
+#define PATHFINDING_MAX_CHANGE_LISTENERS 16
+
+#define PATHFINDING_MAX_PENDING_CHANGES 16
+
+bool pathfinding_add_change_listener(PathfindingChangeCallback callback, void* user);
+void pathfinding_remove_change_listener(PathfindingChangeCallback callback, void* user);
+
+// Notifica ai listener i rettangoli in attesa. Da chiamare una volta per
+// frame; la chiamano anche le query del main thread (pathfinding_find_path*,
+// pathfinding_search_begin, path_service_submit/find_paths, flow field e
+// D* Lite) prima di leggere le strutture derivate. Le varianti _ctx non la
+// chiamano (possono girare sui worker): chi legge zone, HPA* o landmark
+// direttamente vede lo stato dell'ultimo flush.
+// Ritorna il numero di rettangoli notificati
+int pathfinding_flush_changes(void);
+
+// Scarta le notifiche in attesa per il livello (da level_cleanup)
+void pathfinding_discard_changes(struct Level* lvl);
+
+// Imposta la walkability di un rettangolo di celle globali (estremi inclusi).
+// Ritorna il numero di celle effettivamente cambiate (0 = nessuna notifica)
+int pathfinding_set_cells_walkable(struct Level* lvl, int x0, int z0, int x1, int z1, bool walkable);
+bool pathfinding_set_cell_walkable(struct Level* lvl, int cell_x, int cell_z, bool walkable);
+
+// Imposta la classe di terreno (PathTerrainClass) di un rettangolo di celle
+// globali. Cambia solo i costi, non la connettività: invalida la path cache
+// ma non notifica i listener. Ritorna il numero di celle cambiate.
+int pathfinding_set_cells_terrain(struct Level* lvl, int x0, int z0, int x1, int z1, uint8_t terrain_class);
+
+// ============================================================================
+// DYNAMIC OBSTACLES
+// ============================================================================
+// Strutture piazzate e distrutte durante la partita. Ogni chunk ha un overlay
+// con un contatore per cella: footprint sovrapposti si sommano e la cella
+// torna walkable (se lo era staticamente) solo quando l'ultimo viene rimosso.
+// PathGrid.grid contiene già il risultato, quindi ricerche, line of sight e
+// level_is_walkable lo vedono senza ricostruire nulla. Costo O(celle coperte),
+// più i listener come per pathfinding_set_cells_walkable. Solo main thread.
+
+typedef enum {
+    PATH_FOOTPRINT_CIRCLE,
+    PATH_FOOTPRINT_RECT,     // Rettangolo allineato agli assi
+    PATH_FOOTPRINT_OBB       // Rettangolo ruotato attorno all'asse Y
+} PathFootprintShape;
+
+// Area occupata in coordinate world: copre le celle con il centro all'interno
+// (almeno la cella del centro)
+typedef struct {
+    PathFootprintShape shape;
+    float center_x, center_z;
+    float radius;            // CIRCLE
+    float half_x, half_z;    // RECT / OBB: semi-lati
+    float angle;             // OBB: rotazione in radianti
+} PathFootprint;
+
+PathFootprint pathfinding_footprint_circle(vec3 center, float radius);
+PathFootprint pathfinding_footprint_rect(vec3 center, float half_x, float half_z);
+PathFootprint pathfinding_footprint_obb(vec3 center, float half_x, float half_z, float angle);
+
+// Aggiunge/rimuove un footprint (per rimuoverlo passare gli stessi parametri).
+// Ritorna il numero di celle la cui walkability è cambiata.
+int pathfinding_stamp_obstacle(struct Level* lvl, const PathFootprint* footprint);
+int pathfinding_unstamp_obstacle(struct Level* lvl, const PathFootprint* footprint);
+
 // ============================================================================
 // PATHFINDING A*
 // ============================================================================
 
+// Algoritmo di ricerca sulla griglia (stessi costi 1 / 1.414, stesso risultato ottimo)
+typedef enum {
+    PATH_SEARCH_ASTAR = 0,   // A* classico: espande tutti gli 8 vicini
+    PATH_SEARCH_JPS,         // Jump Point Search: salta le simmetrie, molti meno nodi
+    PATH_SEARCH_THETA        // Theta* any-angle: path già teso, niente smoothing
+} PathSearchMode;
+
+// Peso di ogni classe di terreno: il costo di un passo (1 o 1.414) viene
+// moltiplicato per il peso della cella di arrivo. Pesi < 1 vengono portati a 1
+// (l'euristica euclidea resta ammissibile).
+typedef struct {
+    float weights[PATH_TERRAIN_CLASSES];
+} PathCostProfile;
+
+// Tutti i pesi a 1 (equivalente a costi uniformi)
+void pathfinding_cost_profile_init(PathCostProfile* profile);
+
+// Flag di PathQueryParams
+#define PATH_QUERY_NO_SMOOTH  (1u << 0)   // Salta lo string pulling finale
+#define PATH_QUERY_NO_CACHE   (1u << 1)   // Non legge né scrive la path cache
+#define PATH_QUERY_NEAREST    (1u << 2)   // Goal bloccato o irraggiungibile: path fino alla
+                                          // cella raggiungibile più vicina (Path.partial)
+
+// Raggio (celle) in cui PATH_QUERY_NEAREST cerca un sostituto del goal
+#define PATH_NEAREST_MAX_RADIUS 32
+
+// Parametri di una query (inizializzare con pathfinding_query_defaults)
+typedef struct {
+    PathSearchMode mode;
+    int zone_id;             // -1 per nessuna restrizione, >= 0 zona connessa (pathfinding_zones.h)
+    unsigned int flags;      // PATH_QUERY_*
+    int agent_class;         // Classe agente (chiave della path cache, default 0)
+    float agent_radius;      // Raggio dell'agente (m): evita i passaggi più stretti. 0 = solo walkability
+    const PathCostProfile* cost_profile; // NULL = costi uniformi. Con pesi diversi
+                                         // JPS e Theta* ripiegano su A* (costi non uniformi)
+} PathQueryParams;
+
+PathQueryParams pathfinding_query_defaults(void);
+
 // Trova path tra due posizioni world
 // start/goal: posizioni in coordinate world
 // level: puntatore al livello (per accesso ai chunk)
 // zone_id: -1 per nessuna restrizione, >=0 per limitare a zona specifica
+//          (componente connessa, vedi zones_get): fallisce se start o goal sono fuori
 // Returns: Path* (da liberare con path_free) o NULL se non trovato
 Path* pathfinding_find_path(struct Level* lvl, vec3 start, vec3 goal, int zone_id);
 
+// Come pathfinding_find_path, ma usando un contesto esplicito.
+// Thread-safe se ogni thread usa il proprio ctx e il livello non viene modificato.
+Path* pathfinding_find_path_ctx(PathfindingContext* ctx, struct Level* lvl,
+                                vec3 start, vec3 goal, int zone_id);
+
+// Cella raggiungibile da start più vicina a target: target stesso se è già
+// walkable e nella zona di start, altrimenti il centro della cella più vicina
+// (distanza euclidea, entro PATH_NEAREST_MAX_RADIUS celle) con clearance per
+// agent_radius e nella stessa zona di start (o collegata dai layer).
+// Target fuori dal livello viene portato sul bordo. false se nessuna cella.
+bool pathfinding_nearest_reachable(struct Level* lvl, vec3 start, vec3 target, float agent_radius, vec3 out_pos);
+
+// Varianti con parametri completi (algoritmo, zona, flag)
+Path* pathfinding_find_path_ex(struct Level* lvl, vec3 start, vec3 goal, const PathQueryParams* params);
+Path* pathfinding_find_path_ctx_ex(PathfindingContext* ctx, struct Level* lvl,
+                                   vec3 start, vec3 goal, const PathQueryParams* params);
+
+// ============================================================================
+// OBIETTIVO PIÙ VICINO (multi-goal)
+// ============================================================================
+// Una sola ricerca verso il più vicino tra più obiettivi (costo del path, non
+// linea d'aria): "la struttura raggiungibile più vicina" per una creatura
+// senza una query per candidato. Ogni obiettivo è un footprint (per una sola
+// cella pathfinding_footprint_circle con raggio 0): vale raggiungere una
+// delle celle coperte se almeno una è walkable, altrimenti (struttura che
+// blocca le proprie celle) una cella attorno a cui l'agente arriva.
+// Obiettivi in zone non collegate a quella dello start vengono scartati senza
+// cercare. Cerca nella finestra 3x3 di start e obiettivi: se questi sono più
+// lontani, solo in quella attorno allo start.
+//
+// max_dist > 0: early-out, ignora gli obiettivi oltre max_dist metri di path
+// (pesi del terreno inclusi). params: agent_radius, cost_profile e
+// PATH_QUERY_NO_SMOOTH; mode e path cache non si applicano.
+// Ritorna il path (NULL se nessun obiettivo raggiungibile) e in *out_goal
+// l'indice dell'obiettivo raggiunto (-1 se nessuno).
+Path* pathfinding_find_nearest(struct Level* lvl, vec3 start, const PathFootprint* goals, int goal_count,
+                               float max_dist, const PathQueryParams* params, int* out_goal);
+Path* pathfinding_find_nearest_ctx(PathfindingContext* ctx, struct Level* lvl, vec3 start,
+                                   const PathFootprint* goals, int goal_count, float max_dist,
+                                   const PathQueryParams* params, int* out_goal);
+
+// ============================================================================
+// BATCH
+// ============================================================================
+// Più query nello stesso frame (es. un'ondata di 50 creature che cerca path
+// nella stessa zona). Le richieste vengono ordinate per finestra di chunk,
+// raggio e pesi: quelle che leggono la stessa finestra girano una dopo l'altra
+// sullo stesso contesto, che copia la griglia una sola volta e riusa stato
+// per cella e open set. I risultati sono identici alle query singole.
+
+typedef struct {
+    vec3 start;
+    vec3 goal;
+    PathQueryParams params;
+} PathBatchRequest;
+
+// results[i] = path della richiesta i (NULL se non trovato), da liberare con path_free
+void pathfinding_find_paths(struct Level* lvl, const PathBatchRequest* requests, int count, Path** results);
+void pathfinding_find_paths_ctx(PathfindingContext* ctx, struct Level* lvl,
+                                const PathBatchRequest* requests, int count, Path** results);
+
+// Ordine di esecuzione di un batch: out_order (count indici) raggruppa le
+// richieste con la stessa finestra, il gruppo g va da out_group_start[g] a
+// out_group_start[g + 1] (out_group_start ha spazio per count + 1 elementi).
+// Ritorna il numero di gruppi. Usato anche da path_service_find_paths.
+int pathfinding_batch_order(struct Level* lvl, const PathBatchRequest* requests, int count,
+                            int* out_order, int* out_group_start);
+
+// ============================================================================
+// INCREMENTAL SEARCH (time-sliced)
+// ============================================================================
+// Stessa query di pathfinding_find_path_ex, ma l'open set resta nell'handle e
+// la ricerca avanza a fette: il chiamante dedica a ogni frame un budget in
+// espansioni o microsecondi (es. 2ms dei 16ms del frame) finché non è conclusa.
+//
+// L'handle usa la griglia e l'open set del contesto: una query eseguita
+// sullo stesso contesto prima della fine la interrompe (PATH_STATUS_FAILED).
+// I path oltre la finestra 3x3 (HPA*) avanzano un chunk per volta: il primo
+// step esegue la ricerca astratta, poi il budget è controllato dopo ogni
+// chunk raffinato (una fetta può superarlo di un A* su 64x64 celle). Tra due
+// step il contesto può servire altre query senza interromperle.
+
+typedef struct PathSearch PathSearch;
+
+typedef enum {
+    PATH_STATUS_IN_PROGRESS,
+    PATH_STATUS_FOUND,
+    PATH_STATUS_FAILED
+} PathSearchStatus;
+
+// Avvia la ricerca (validazione e setup finestra, nessuna espansione).
+// La scorciatoia in line of sight conclude subito con PATH_STATUS_FOUND.
+PathSearch* pathfinding_search_begin(struct Level* lvl, vec3 start, vec3 goal, const PathQueryParams* params);
+PathSearch* pathfinding_search_begin_ctx(PathfindingContext* ctx, struct Level* lvl,
+                                         vec3 start, vec3 goal, const PathQueryParams* params);
+
+// Avanza entro il budget (<= 0 = nessun limite per quel criterio).
+// Il tempo è controllato ogni 64 espansioni; lo smoothing finale non è interrompibile.
+PathSearchStatus pathfinding_search_step(PathSearch* search, int max_expansions, float max_time_us);
+PathSearchStatus pathfinding_search_status(PathSearch* search);
+
+// Path trovato (ownership al chiamante, da liberare con path_free). NULL se non FOUND
+Path* pathfinding_search_take_path(PathSearch* search);
+
+// Libera l'handle (anche a ricerca in corso = annulla)
+void pathfinding_search_end(PathSearch* search);
+
 
 // ============================================================================
 // PATH MANIPULATION
@@ -106,8 +437,30 @@ void pathfinding_debug_draw_grid(struct Level* lvl, int chunk_idx, mat4 viewProj
 // Render path come linea colorata
 void pathfinding_debug_draw_path(Path* path, mat4 viewProj, vec3 color);
 
+// Statistiche performance (per contesto)
+typedef struct {
+    int total_paths_requested;
+    int paths_found;
+    int paths_failed;
+    float total_time_ms;
+    float max_time_ms;
+    long long nodes_expanded;  // Nodi estratti dall'open set (A*/JPS/Theta*)
+    int paths_rejected_zone;   // Fallite subito: zone diverse o fuori da zone_id
+    int windows_reused;        // Ricerche che hanno trovato la finestra già in griglia
+} PathfindingStats;
+
 // Stampa statistiche performance
 void pathfinding_print_stats(void);
 void pathfinding_reset_stats(void);
+void pathfinding_context_print_stats(PathfindingContext* ctx);
+
+// Copia dei contatori di un contesto (es. nodi espansi da una singola query)
+void pathfinding_context_get_stats(PathfindingContext* ctx, PathfindingStats* out);
+
+// Memoria riservata da un contesto di ricerca (byte)
+size_t pathfinding_context_memory(void);
+
+// Benchmark su coppie casuali start/goal del livello (A* vs JPS vs Theta*)
+void pathfinding_run_benchmark(struct Level* lvl);
 
 #endif // PATHFINDING_H
@@ -0,0 +1,308 @@
+#include "pathfinding_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// ============================================================================
+// STRUTTURE INTERNE
+// ============================================================================
+
+// Intestazione di ogni blocco, subito prima dei dati
+typedef struct ArenaBlock {
+    struct ArenaBlock* next_free;   // Free list della classe (solo a blocco libero)
+    size_t bytes;                   // Byte utilizzabili
+    int size_class;                 // -1 = oversize (malloc diretta)
+} ArenaBlock;
+
+typedef struct ArenaSlab {
+    struct ArenaSlab* next;
+} ArenaSlab;
+
+// Slot di un'intestazione: path è il primo campo, Path* -> PathSlot* è un cast
+typedef struct {
+    Path path;
+    uint16_t generation;            // Incrementata ad ogni path_free (invalida gli handle)
+    bool live;
+    int index;                      // Posizione nelle pagine (parte bassa dell'handle)
+    int next_free;                  // Prossimo slot libero (-1 = fine lista)
+} PathSlot;
+
+static struct {
+    pthread_mutex_t lock;
+    ArenaBlock* free_blocks[PATH_ARENA_CLASSES];
+    ArenaSlab* slabs;
+
+    PathSlot* pages[PATH_ARENA_MAX_PAGES];
+    int page_count;
+    int free_slot;                  // Testa della lista degli slot liberi (-1 = vuota)
+
+    PathArenaStats stats;
+} g_arena = { .lock = PTHREAD_MUTEX_INITIALIZER, .free_slot = -1 };
+
+// Byte per waypoint: vec3 + layer (uint8_t) nello stesso blocco
+#define WAYPOINT_BYTES (sizeof(vec3) + sizeof(uint8_t))
+
+// ============================================================================
+// BLOCCHI (lock acquisito)
+// ============================================================================
+
+static int size_class_for(size_t bytes) {
+    for (int c = 0; c < PATH_ARENA_CLASSES; c++) {
+        if ((size_t)PATH_ARENA_MIN_BLOCK << c >= bytes) return c;
+    }
+    return -1;
+}
+
+// Ritaglia una nuova slab in blocchi della classe (almeno uno)
+static bool refill_class(int size_class) {
+    size_t usable = (size_t)PATH_ARENA_MIN_BLOCK << size_class;
+    size_t unit = sizeof(ArenaBlock) + usable;
+    size_t count = (PATH_ARENA_SLAB_BYTES - sizeof(ArenaSlab)) / unit;
+    if (count < 1) count = 1;
+
+    size_t slab_bytes = sizeof(ArenaSlab) + count * unit;
+    ArenaSlab* slab = (ArenaSlab*)malloc(slab_bytes);
+    if (!slab) return false;
+    g_arena.stats.heap_allocs++;
+    g_arena.stats.reserved_bytes += slab_bytes;
+
+    slab->next = g_arena.slabs;
+    g_arena.slabs = slab;
+
+    unsigned char* cursor = (unsigned char*)(slab + 1);
+    for (size_t i = 0; i < count; i++, cursor += unit) {
+        ArenaBlock* block = (ArenaBlock*)cursor;
+        block->bytes = usable;
+        block->size_class = size_class;
+        block->next_free = g_arena.free_blocks[size_class];
+        g_arena.free_blocks[size_class] = block;
+    }
+    return true;
+}
+
+static ArenaBlock* block_take(size_t bytes) {
+    int size_class = size_class_for(bytes);
+
+    if (size_class < 0) {
+        ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + bytes);
+        if (!block) return NULL;
+        block->bytes = bytes;
+        block->size_class = -1;
+        g_arena.stats.heap_allocs++;
+        g_arena.stats.oversize_allocs++;
+        g_arena.stats.reserved_bytes += sizeof(ArenaBlock) + bytes;
+        return block;
+    }
+
+    if (!g_arena.free_blocks[size_class] && !refill_class(size_class)) return NULL;
+    ArenaBlock* block = g_arena.free_blocks[size_class];
+    g_arena.free_blocks[size_class] = block->next_free;
+    return block;
+}
+
+static void block_give(ArenaBlock* block) {
+    if (block->size_class < 0) {
+        g_arena.stats.reserved_bytes -= sizeof(ArenaBlock) + block->bytes;
+        free(block);
+        return;
+    }
+    block->next_free = g_arena.free_blocks[block->size_class];
+    g_arena.free_blocks[block->size_class] = block;
+}
+
+static ArenaBlock* block_of(void* data) {
+    return (ArenaBlock*)data - 1;
+}
+
+// ============================================================================
+// SLOT DELLE INTESTAZIONI (lock acquisito)
+// ============================================================================
+
+static PathSlot* slot_at(int index) {
+    return &g_arena.pages[index / PATH_ARENA_PAGE_SLOTS][index % PATH_ARENA_PAGE_SLOTS];
+}
+
+static PathSlot* slot_take(void) {
+    if (g_arena.free_slot < 0) {
+        if (g_arena.page_count >= PATH_ARENA_MAX_PAGES) {
+            printf("[PathArena] ERROR: More than %d live paths\n", PATH_ARENA_MAX_PAGES * PATH_ARENA_PAGE_SLOTS);
+            return NULL;
+        }
+        PathSlot* page = (PathSlot*)calloc(PATH_ARENA_PAGE_SLOTS, sizeof(PathSlot));
+        if (!page) return NULL;
+        g_arena.stats.heap_allocs++;
+        g_arena.stats.reserved_bytes += PATH_ARENA_PAGE_SLOTS * sizeof(PathSlot);
+
+        int base = g_arena.page_count * PATH_ARENA_PAGE_SLOTS;
+        g_arena.pages[g_arena.page_count++] = page;
+        for (int i = PATH_ARENA_PAGE_SLOTS - 1; i >= 0; i--) {
+            page[i].generation = 1;
+            page[i].index = base + i;
+            page[i].next_free = g_arena.free_slot;
+            g_arena.free_slot = base + i;
+        }
+    }
+
+    PathSlot* slot = slot_at(g_arena.free_slot);
+    g_arena.free_slot = slot->next_free;
+    slot->live = true;
+
+    if (++g_arena.stats.live_paths > g_arena.stats.peak_paths) {
+        g_arena.stats.peak_paths = g_arena.stats.live_paths;
+    }
+    return slot;
+}
+
+static void slot_give(PathSlot* slot) {
+    slot->live = false;
+    slot->generation++;
+    if (slot->generation == 0) slot->generation = 1;   // Evita handle == 0
+    slot->next_free = g_arena.free_slot;
+    g_arena.free_slot = slot->index;
+    g_arena.stats.live_paths--;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+// Capacità in waypoint di un blocco
+static int block_capacity(const ArenaBlock* block) {
+    return (int)(block->bytes / WAYPOINT_BYTES);
+}
+
+Path* path_arena_alloc_path(int capacity) {
+    if (capacity < 1) capacity = 1;
+
+    pthread_mutex_lock(&g_arena.lock);
+    PathSlot* slot = slot_take();
+    ArenaBlock* block = slot ? block_take((size_t)capacity * WAYPOINT_BYTES) : NULL;
+    if (slot && !block) {
+        slot_give(slot);
+        slot = NULL;
+    }
+    pthread_mutex_unlock(&g_arena.lock);
+    if (!slot) return NULL;
+
+    Path* path = &slot->path;
+    path->waypoints = (vec3*)(block + 1);
+    path->waypoint_count = 0;
+    path->capacity = block_capacity(block);
+    path->layer_id = 0;
+    path->waypoint_layers = NULL;
+    path->partial = false;
+    return path;
+}
+
+void path_arena_free_path(Path* path) {
+    if (!path) return;
+
+    pthread_mutex_lock(&g_arena.lock);
+    if (path->waypoints) block_give(block_of(path->waypoints));
+    path->waypoints = NULL;
+    path->waypoint_layers = NULL;
+    slot_give((PathSlot*)path);
+    pthread_mutex_unlock(&g_arena.lock);
+}
+
+uint8_t* path_arena_layer_storage(Path* path) {
+    return (uint8_t*)(path->waypoints + path->capacity);
+}
+
+bool path_arena_grow_path(Path* path, int min_capacity) {
+    if (!path) return false;
+    if (min_capacity <= path->capacity) return true;
+    if (min_capacity < path->capacity * 2) min_capacity = path->capacity * 2;
+
+    pthread_mutex_lock(&g_arena.lock);
+    ArenaBlock* block = block_take((size_t)min_capacity * WAYPOINT_BYTES);
+    pthread_mutex_unlock(&g_arena.lock);
+    if (!block) return false;
+
+    vec3* waypoints = (vec3*)(block + 1);
+    int capacity = block_capacity(block);
+    memcpy(waypoints, path->waypoints, path->waypoint_count * sizeof(vec3));
+    if (path->waypoint_layers) {
+        uint8_t* layers = (uint8_t*)(waypoints + capacity);
+        memcpy(layers, path->waypoint_layers, path->waypoint_count * sizeof(uint8_t));
+        path->waypoint_layers = layers;
+    }
+
+    pthread_mutex_lock(&g_arena.lock);
+    block_give(block_of(path->waypoints));
+    pthread_mutex_unlock(&g_arena.lock);
+
+    path->waypoints = waypoints;
+    path->capacity = capacity;
+    return true;
+}
+
+void* path_arena_alloc(size_t bytes) {
+    pthread_mutex_lock(&g_arena.lock);
+    ArenaBlock* block = block_take(bytes > 0 ? bytes : 1);
+    pthread_mutex_unlock(&g_arena.lock);
+    return block ? (void*)(block + 1) : NULL;
+}
+
+void path_arena_release(void* data) {
+    if (!data) return;
+    pthread_mutex_lock(&g_arena.lock);
+    block_give(block_of(data));
+    pthread_mutex_unlock(&g_arena.lock);
+}
+
+PathHandle path_get_handle(const Path* path) {
+    if (!path) return PATH_HANDLE_INVALID;
+
+    pthread_mutex_lock(&g_arena.lock);
+    const PathSlot* slot = (const PathSlot*)path;
+    PathHandle handle = slot->live
+        ? ((uint32_t)slot->generation << 16) | (uint32_t)(slot->index + 1)
+        : PATH_HANDLE_INVALID;
+    pthread_mutex_unlock(&g_arena.lock);
+    return handle;
+}
+
+Path* path_from_handle(PathHandle handle) {
+    int index = (int)(handle & 0xFFFF) - 1;
+    uint16_t generation = (uint16_t)(handle >> 16);
+    if (index < 0) return NULL;
+
+    pthread_mutex_lock(&g_arena.lock);
+    Path* path = NULL;
+    if (index < g_arena.page_count * PATH_ARENA_PAGE_SLOTS) {
+        PathSlot* slot = slot_at(index);
+        if (slot->live && slot->generation == generation) path = &slot->path;
+    }
+    pthread_mutex_unlock(&g_arena.lock);
+    return path;
+}
+
+void path_arena_get_stats(PathArenaStats* out_stats) {
+    if (!out_stats) return;
+    pthread_mutex_lock(&g_arena.lock);
+    *out_stats = g_arena.stats;
+    pthread_mutex_unlock(&g_arena.lock);
+}
+
+void path_arena_shutdown(void) {
+    pthread_mutex_lock(&g_arena.lock);
+    if (g_arena.stats.live_paths > 0) {
+        printf("[PathArena] WARNING: Shutdown with %d live paths\n", g_arena.stats.live_paths);
+    }
+
+    while (g_arena.slabs) {
+        ArenaSlab* next = g_arena.slabs->next;
+        free(g_arena.slabs);
+        g_arena.slabs = next;
+    }
+    for (int p = 0; p < g_arena.page_count; p++) free(g_arena.pages[p]);
+
+    memset(g_arena.free_blocks, 0, sizeof(g_arena.free_blocks));
+    memset(g_arena.pages, 0, sizeof(g_arena.pages));
+    g_arena.page_count = 0;
+    g_arena.free_slot = -1;
+    memset(&g_arena.stats, 0, sizeof(g_arena.stats));
+    pthread_mutex_unlock(&g_arena.lock);
+}
@@ -0,0 +1,77 @@
+#ifndef PATHFINDING_ARENA_H
+#define PATHFINDING_ARENA_H
+
+/*
+ * PATH ARENA
+ * ==========
+ *
+ * Memoria dei Path senza malloc a regime. Le intestazioni Path stanno in
+ * pagine di slot (indirizzi stabili, riusati con una generazione per gli
+ * handle); i waypoint in blocchi a classi di dimensione (potenze di due),
+ * ritagliati da slab e rimessi in una free list per classe quando il path
+ * viene liberato o cresce. Dopo le prime query ogni path_create / path_free
+ * prende e restituisce blocchi già allocati.
+ *
+ * Thread-safe (un mutex): i worker di pathfinding_service creano path in
+ * parallelo e il main thread li libera. Le slab non tornano al sistema
+ * fino a path_arena_shutdown.
+ */
+
+#include "pathfinding.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Classi di blocco: 128 byte << k (fino a 64 KB, ~5000 waypoint). Oltre si
+// usa malloc direttamente (contato in oversize_allocs)
+#define PATH_ARENA_CLASSES 10
+#define PATH_ARENA_MIN_BLOCK 128
+#define PATH_ARENA_SLAB_BYTES (64 * 1024)
+
+// Path vivi al massimo (slot delle intestazioni): 255 pagine da 256, così
+// l'indice + 1 entra nei 16 bit bassi dell'handle
+#define PATH_ARENA_PAGE_SLOTS 256
+#define PATH_ARENA_MAX_PAGES 255
+
+// Handle generazionale di un Path: 0 = invalido. Resta valido finché il path
+// non viene liberato, poi path_from_handle ritorna NULL anche se lo slot è
+// già stato riusato da un altro path
+typedef uint32_t PathHandle;
+#define PATH_HANDLE_INVALID 0
+
+typedef struct {
+    int live_paths;           // Path non ancora liberati
+    int peak_paths;
+    size_t reserved_bytes;    // Slab + pagine di intestazioni (+ blocchi oversize vivi)
+    long long heap_allocs;    // malloc eseguite dall'arena (slab, pagine, oversize)
+    long long oversize_allocs;
+} PathArenaStats;
+
+// Intestazione Path con waypoints per almeno capacity punti (waypoint_count 0).
+// Usata da path_create
+Path* path_arena_alloc_path(int capacity);
+
+// Restituisce intestazione e waypoint all'arena. Usata da path_free
+void path_arena_free_path(Path* path);
+
+// Porta la capacità ad almeno min_capacity (waypoint e layer copiati).
+// Usata da path_add_waypoint
+bool path_arena_grow_path(Path* path, int min_capacity);
+
+// Layer per waypoint nello stesso blocco dei waypoint (capacity byte dopo
+// l'ultimo vec3): la memoria per waypoint_layers non richiede allocazioni
+uint8_t* path_arena_layer_storage(Path* path);
+
+// Blocco temporaneo di almeno bytes (es. costi dello smoothing), da
+// restituire con path_arena_release
+void* path_arena_alloc(size_t bytes);
+void path_arena_release(void* block);
+
+PathHandle path_get_handle(const Path* path);
+Path* path_from_handle(PathHandle handle);
+
+void path_arena_get_stats(PathArenaStats* out_stats);
+
+// Libera tutte le slab. Solo a fine programma, con nessun Path vivo
+void path_arena_shutdown(void);
+
+#endif // PATHFINDING_ARENA_H
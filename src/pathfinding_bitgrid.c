@@ -0,0 +1,241 @@
+#include "pathfinding_bitgrid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ============================================================================
+// ALLOCAZIONE
+// ============================================================================
+
+bool bitgrid_init(BitGrid* bg, int width, int height, bool with_cols) {
+    if (!bg || width <= 0 || height <= 0) return false;
+
+    bg->width = width;
+    bg->height = height;
+    bg->words_per_row = (width + 63) / 64;
+    bg->words_per_col = with_cols ? (height + 63) / 64 : 0;
+
+    bg->rows = (uint64_t*)calloc((size_t)bg->words_per_row * height, sizeof(uint64_t));
+    bg->cols = with_cols ? (uint64_t*)calloc((size_t)bg->words_per_col * width, sizeof(uint64_t)) : NULL;
+    if (!bg->rows || (with_cols && !bg->cols)) {
+        printf("[BitGrid] ERROR: Failed to allocate %dx%d bit grid\n", width, height);
+        bitgrid_cleanup(bg);
+        return false;
+    }
+    return true;
+}
+
+void bitgrid_cleanup(BitGrid* bg) {
+    if (!bg) return;
+    free(bg->rows);
+    free(bg->cols);
+    bg->rows = NULL;
+    bg->cols = NULL;
+    bg->words_per_row = 0;
+    bg->words_per_col = 0;
+}
+
+// Parole di una riga (o colonna) di length celle tutte a value, padding a 0
+static void fill_words(uint64_t* words, int word_count, int length, bool value) {
+    memset(words, value ? 0xFF : 0x00, (size_t)word_count * sizeof(uint64_t));
+    if (value && (length & 63)) {
+        words[word_count - 1] = ~0ULL >> (64 - (length & 63));
+    }
+}
+
+void bitgrid_fill(BitGrid* bg, bool walkable) {
+    if (!bg || !bg->rows) return;
+    for (int z = 0; z < bg->height; z++) {
+        fill_words(&bg->rows[z * bg->words_per_row], bg->words_per_row, bg->width, walkable);
+    }
+    if (bg->cols) {
+        for (int x = 0; x < bg->width; x++) {
+            fill_words(&bg->cols[x * bg->words_per_col], bg->words_per_col, bg->height, walkable);
+        }
+    }
+}
+
+// 64 byte -> una parola. Con SSE2 il confronto è con segno: xor 0x80 porta
+// 0..255 in -128..127 mantenendo l'ordine
+static uint64_t pack_word(const unsigned char* bytes, int count, unsigned char threshold) {
+    uint64_t word = 0;
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i limit = _mm_set1_epi8((char)(threshold ^ 0x80));
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(bytes + i)), bias);
+        uint64_t mask = (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, limit));
+        word |= mask << i;
+    }
+#endif
+    for (; i < count; i++) {
+        if (bytes[i] > threshold) word |= 1ULL << i;
+    }
+    return word;
+}
+
+bool bitgrid_from_bytes(BitGrid* bg, const unsigned char* bytes, int width, int height,
+                        unsigned char threshold) {
+    if (!bytes || !bitgrid_init(bg, width, height, false)) return false;
+
+    for (int z = 0; z < height; z++) {
+        const unsigned char* src = &bytes[(size_t)z * width];
+        uint64_t* row = &bg->rows[z * bg->words_per_row];
+        for (int w = 0; w < bg->words_per_row; w++) {
+            int count = width - w * 64;
+            row[w] = pack_word(src + w * 64, count < 64 ? count : 64, threshold);
+        }
+    }
+    return true;
+}
+
+int bitgrid_count_rect(const BitGrid* bg, int x0, int z0, int x1, int z1) {
+    int wa = x0 >> 6, wb = x1 >> 6;
+    uint64_t first = ~0ULL << (x0 & 63);
+    uint64_t last = ~0ULL >> (63 - (x1 & 63));
+    int count = 0;
+
+    for (int z = z0; z <= z1; z++) {
+        const uint64_t* row = &bg->rows[z * bg->words_per_row];
+        if (wa == wb) {
+            count += __builtin_popcountll(row[wa] & first & last);
+            continue;
+        }
+        count += __builtin_popcountll(row[wa] & first);
+        for (int w = wa + 1; w < wb; w++) count += __builtin_popcountll(row[w]);
+        count += __builtin_popcountll(row[wb] & last);
+    }
+    return count;
+}
+
+bool bitgrid_col_clear(const BitGrid* bg, int x, int z0, int z1) {
+    if (bg->cols) return bitgrid_words_all_set(&bg->cols[x * bg->words_per_col], z0, z1);
+
+    uint64_t bit = 1ULL << (x & 63);
+    const uint64_t* word = &bg->rows[z0 * bg->words_per_row + (x >> 6)];
+    for (int z = z0; z <= z1; z++, word += bg->words_per_row) {
+        if (!(*word & bit)) return false;
+    }
+    return true;
+}
+
+bool bitgrid_rect_clear(const BitGrid* bg, int x0, int z0, int x1, int z1) {
+    for (int z = z0; z <= z1; z++) {
+        if (!bitgrid_row_clear(bg, z, x0, x1)) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// BLOCCHI
+// ============================================================================
+
+bool bitgrid_init_blocks(BitGrid* blocks, const BitGrid* bg, int block_size) {
+    if (!blocks || !bg || !bg->rows || block_size < 1) return false;
+
+    int width = (bg->width + block_size - 1) / block_size;
+    int height = (bg->height + block_size - 1) / block_size;
+    if (!bitgrid_init(blocks, width, height, true)) return false;
+
+    bitgrid_update_blocks(blocks, bg, block_size, 0, 0, bg->width - 1, bg->height - 1);
+    return true;
+}
+
+void bitgrid_update_blocks(BitGrid* blocks, const BitGrid* bg, int block_size,
+                           int x0, int z0, int x1, int z1) {
+    if (!blocks || !blocks->rows || !bg || !bg->rows) return;
+
+    for (int bz = z0 / block_size; bz <= z1 / block_size; bz++) {
+        for (int bx = x0 / block_size; bx <= x1 / block_size; bx++) {
+            int cx0 = bx * block_size, cz0 = bz * block_size;
+            int cx1 = cx0 + block_size - 1, cz1 = cz0 + block_size - 1;
+            if (cx1 >= bg->width) cx1 = bg->width - 1;
+            if (cz1 >= bg->height) cz1 = bg->height - 1;
+            bitgrid_set(blocks, bx, bz, bitgrid_rect_clear(bg, cx0, cz0, cx1, cz1));
+        }
+    }
+}
+
+// ============================================================================
+// TRATTI DI BRESENHAM
+// ============================================================================
+// Il Bresenham di riferimento (err = dx/2 o -dz/2, passo dritto finché
+// l'errore lo consente, poi diagonale) avanza sempre sull'asse principale.
+// Riportato su quell'asse l'errore non scende mai sotto zero: un tratto dura
+// err / d_minor passi dritti più la cella iniziale, poi un passo diagonale
+// aggiunge d_major - d_minor. Dopo il primo tratto l'errore resta in
+// [d_major - d_minor, d_major): le lunghezze possibili sono solo due,
+// calcolate una volta per linea invece di una divisione per tratto.
+
+void bitline_begin(BitLineRuns* it, int x0, int z0, int x1, int z1) {
+    int dx = abs(x1 - x0), dz = abs(z1 - z0);
+    int sx = x0 < x1 ? 1 : -1, sz = z0 < z1 ? 1 : -1;
+
+    it->x_major = dx > dz;
+    if (it->x_major) {
+        it->major = x0; it->minor = z0; it->major_end = x1;
+        it->step_major = sx; it->step_minor = sz;
+        it->d_major = dx; it->d_minor = dz;
+    } else {
+        it->major = z0; it->minor = x0; it->major_end = z1;
+        it->step_major = sz; it->step_minor = sx;
+        it->d_major = dz; it->d_minor = dx;
+    }
+    it->minor_end = it->x_major ? z1 : x1;
+    it->err = it->d_major / 2;
+    it->done = false;
+
+    if (it->d_minor > 0) {
+        it->run_len = (it->d_major - it->d_minor) / it->d_minor + 1;
+        it->short_err = (it->run_len - 1) * it->d_minor;
+        it->long_err = it->run_len * it->d_minor;
+    }
+}
+
+// Dopo j tratti interi (j >= 1) l'errore torna sempre in
+// [d_major - d_minor, d_major): la somma S delle loro lunghezze è l'unica
+// che ce lo riporta, S = (err + (j - 1) * d_major) / d_minor + 1
+static int runs_length(const BitLineRuns* it, int runs) {
+    return (it->err + (runs - 1) * it->d_major) / it->d_minor + 1;
+}
+
+int bitline_runs_end(const BitLineRuns* it, int runs) {
+    if (runs >= bitline_runs_left(it)) return it->major_end;
+    return it->major + it->step_major * (runs_length(it, runs) - 1);
+}
+
+void bitline_skip(BitLineRuns* it, int runs) {
+    if (runs >= bitline_runs_left(it)) {
+        it->done = true;
+        return;
+    }
+    int len = runs_length(it, runs);
+    it->err += runs * it->d_major - len * it->d_minor;
+    it->major += it->step_major * len;
+    it->minor += it->step_minor * runs;
+}
+
+bool bitgrid_line_of_sight(const BitGrid* bg, int x0, int z0, int x1, int z1) {
+    if (!bg || !bg->rows) return false;
+
+    // I tratti restano nel rettangolo degli estremi
+    if (x0 < 0 || x0 >= bg->width || x1 < 0 || x1 >= bg->width ||
+        z0 < 0 || z0 >= bg->height || z1 < 0 || z1 >= bg->height) {
+        return false;
+    }
+
+    BitLineRuns it;
+    int line, a, b;
+    bitline_begin(&it, x0, z0, x1, z1);
+    while (bitline_next(&it, &line, &a, &b)) {
+        bool clear = it.x_major ? bitgrid_row_clear(bg, line, a, b)
+                                : bitgrid_col_clear(bg, line, a, b);
+        if (!clear) return false;
+    }
+    return true;
+}
@@ -0,0 +1,167 @@
+#ifndef PATHFINDING_BITGRID_H
+#define PATHFINDING_BITGRID_H
+
+/*
+ * BITGRID (walkability a 1 bit per cella)
+ * =======================================
+ *
+ * 64 celle per parola uint64_t, bit a 1 = cella libera. Le righe sono sempre
+ * presenti (row-major); la copia per colonne (column-major) è opzionale e
+ * serve alle linee ripide, che altrimenti leggerebbero una parola per cella.
+ *
+ * Una linea di Bresenham è fatta di tratti orizzontali (linee più larghe che
+ * alte) o verticali (più alte che larghe): ogni tratto si verifica con una
+ * maschera sulle parole che copre, invece che cella per cella.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct BitGrid {
+    int width, height;
+    int words_per_row;       // (width + 63) / 64
+    int words_per_col;       // (height + 63) / 64 (0 senza copia per colonne)
+    uint64_t* rows;          // [z * words_per_row + x / 64], bit x % 64
+    uint64_t* cols;          // [x * words_per_col + z / 64], bit z % 64 (NULL = solo righe)
+} BitGrid;
+
+// Alloca la griglia con tutte le celle bloccate. with_cols aggiunge la copia
+// per colonne (doppia memoria, line of sight ripide a parole intere)
+bool bitgrid_init(BitGrid* bg, int width, int height, bool with_cols);
+void bitgrid_cleanup(BitGrid* bg);
+
+// Tutte le celle libere (o bloccate), bit di padding oltre width/height a 0
+void bitgrid_fill(BitGrid* bg, bool walkable);
+
+// Alloca (solo righe) e riempie da un'immagine a byte: libera se byte > threshold.
+// Confronto a 16 byte per istruzione con SSE2, un bit per byte con movemask
+bool bitgrid_from_bytes(BitGrid* bg, const unsigned char* bytes, int width, int height,
+                        unsigned char threshold);
+
+// Celle libere nel rettangolo (estremi inclusi, dentro la griglia): popcount per parola
+int bitgrid_count_rect(const BitGrid* bg, int x0, int z0, int x1, int z1);
+
+static inline bool bitgrid_get(const BitGrid* bg, int x, int z) {
+    return (bg->rows[z * bg->words_per_row + (x >> 6)] >> (x & 63)) & 1;
+}
+
+static inline void bitgrid_set(BitGrid* bg, int x, int z, bool walkable) {
+    uint64_t* row = &bg->rows[z * bg->words_per_row + (x >> 6)];
+    uint64_t row_bit = 1ULL << (x & 63);
+    *row = walkable ? (*row | row_bit) : (*row & ~row_bit);
+
+    if (bg->cols) {
+        uint64_t* col = &bg->cols[x * bg->words_per_col + (z >> 6)];
+        uint64_t col_bit = 1ULL << (z & 63);
+        *col = walkable ? (*col | col_bit) : (*col & ~col_bit);
+    }
+}
+
+// Bit a..b (inclusi) tutti a 1 in una sequenza di parole
+static inline bool bitgrid_words_all_set(const uint64_t* words, int a, int b) {
+    int wa = a >> 6, wb = b >> 6;
+    uint64_t first = ~0ULL << (a & 63);
+    uint64_t last = ~0ULL >> (63 - (b & 63));
+
+    if (wa == wb) return (words[wa] & first & last) == (first & last);
+    if ((words[wa] & first) != first) return false;
+    for (int w = wa + 1; w < wb; w++) {
+        if (words[w] != ~0ULL) return false;
+    }
+    return (words[wb] & last) == last;
+}
+
+// Celle x0..x1 della riga z tutte libere (x0 <= x1, dentro la griglia)
+static inline bool bitgrid_row_clear(const BitGrid* bg, int z, int x0, int x1) {
+    return bitgrid_words_all_set(&bg->rows[z * bg->words_per_row], x0, x1);
+}
+
+// Celle z0..z1 della colonna x tutte libere (z0 <= z1, dentro la griglia).
+// Senza copia per colonne legge una riga per cella
+bool bitgrid_col_clear(const BitGrid* bg, int x, int z0, int z1);
+
+// Rettangolo di celle (estremi inclusi, dentro la griglia) tutto libero
+bool bitgrid_rect_clear(const BitGrid* bg, int x0, int z0, int x1, int z1);
+
+// ============================================================================
+// BLOCCHI
+// ============================================================================
+// Livello grossolano: un bit per blocco block_size x block_size di celle,
+// a 1 se tutte le celle del blocco sono libere. Le line of sight saltano i
+// blocchi pieni invece di leggere ogni cella.
+
+// Alloca e calcola blocks da bg (righe e colonne)
+bool bitgrid_init_blocks(BitGrid* blocks, const BitGrid* bg, int block_size);
+
+// Ricalcola i blocchi che toccano il rettangolo di celle di bg (estremi inclusi)
+void bitgrid_update_blocks(BitGrid* blocks, const BitGrid* bg, int block_size,
+                           int x0, int z0, int x1, int z1);
+
+// ============================================================================
+// TRATTI DI UNA LINEA DI BRESENHAM
+// ============================================================================
+// Stesse celle del Bresenham di pathgrid_line_of_sight, raggruppate in
+// tratti: orizzontali se la linea è più larga che alta (x_major), verticali
+// altrimenti. Il tratto è [a, b] con a <= b lungo l'asse principale, alla
+// coordinata line sull'altro asse.
+
+typedef struct {
+    bool x_major;
+    int major, minor;        // Cella corrente
+    int major_end;
+    int step_major, step_minor;
+    int d_major, d_minor;    // Delta assoluti
+    int minor_end;
+    int err;                 // Errore di Bresenham riportato sull'asse principale
+    int run_len;             // Lunghezza corta dei tratti dopo il primo (l'altra è run_len + 1)
+    int short_err, long_err; // Errore da cui un tratto è lungo run_len / run_len + 1
+    bool done;
+} BitLineRuns;
+
+void bitline_begin(BitLineRuns* it, int x0, int z0, int x1, int z1);
+// Prossimo tratto (false a linea finita)
+static inline bool bitline_next(BitLineRuns* it, int* line, int* a, int* b) {
+    if (it->done) return false;
+
+    int remaining = (it->step_major > 0 ? it->major_end - it->major : it->major - it->major_end) + 1;
+    int len;
+    if (it->d_minor == 0) len = remaining;
+    else if (it->err >= it->long_err) len = it->run_len + 1;
+    else if (it->err >= it->short_err) len = it->run_len;
+    else len = it->err / it->d_minor + 1;  // Solo il primo tratto
+    if (len >= remaining) {
+        len = remaining;
+        it->done = true;
+    }
+
+    int last = it->major + it->step_major * (len - 1);
+    *line = it->minor;
+    *a = it->step_major > 0 ? it->major : last;
+    *b = it->step_major > 0 ? last : it->major;
+
+    if (!it->done) {
+        it->err += it->d_major - len * it->d_minor;
+        it->major = last + it->step_major;
+        it->minor += it->step_minor;
+    }
+    return true;
+}
+
+// Tratti rimasti (uno per riga o colonna ancora da attraversare)
+static inline int bitline_runs_left(const BitLineRuns* it) {
+    if (it->done) return 0;
+    int left = it->minor_end - it->minor;
+    return (left < 0 ? -left : left) + 1;
+}
+
+// Ultima cella sull'asse principale dei prossimi runs tratti (1..runs_left),
+// senza avanzare: serve a sapere quali blocchi coprono senza visitarli
+int bitline_runs_end(const BitLineRuns* it, int runs);
+
+// Salta i prossimi runs tratti in tempo costante
+void bitline_skip(BitLineRuns* it, int runs);
+
+// Line of sight su una sola griglia: false se una cella è bloccata o fuori
+bool bitgrid_line_of_sight(const BitGrid* bg, int x0, int z0, int x1, int z1);
+
+#endif // PATHFINDING_BITGRID_H
@@ -0,0 +1,154 @@
+#include "pathfinding_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// ============================================================================
+// INTERNAL STRUCTURES
+// ============================================================================
+
+#define PATH_CACHE_SETS (PATH_CACHE_SIZE / PATH_CACHE_WAYS)
+
+typedef struct {
+    bool used;
+    PathCacheKey key;
+    Path* path;                // NULL = path inesistente
+    unsigned int last_used;    // Contatore LRU
+} PathCacheEntry;
+
+static PathCacheEntry g_entries[PATH_CACHE_SIZE];
+static unsigned int g_use_counter = 0;
+static pthread_mutex_t g_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+    long long hits;
+    long long misses;
+    long long evictions;
+} g_cache_stats = {0};
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// Stessa query (versione esclusa)
+static bool key_same_query(const PathCacheKey* a, const PathCacheKey* b) {
+    return a->lvl == b->lvl &&
+           a->start_x == b->start_x && a->start_z == b->start_z &&
+           a->goal_x == b->goal_x && a->goal_z == b->goal_z &&
+           a->start_layer == b->start_layer && a->goal_layer == b->goal_layer &&
+           a->agent_class == b->agent_class && a->clearance == b->clearance && a->profile_hash == b->profile_hash && a->mode == b->mode &&
+           a->flags == b->flags && a->zone_id == b->zone_id;
+}
+
+static PathCacheEntry* key_set(const PathCacheKey* key) {
+    uint32_t h = (uint32_t)key->start_x * 73856093u;
+    h ^= (uint32_t)key->start_z * 19349663u;
+    h ^= (uint32_t)key->goal_x * 83492791u;
+    h ^= (uint32_t)key->goal_z * 2654435761u;
+    h ^= (uint32_t)key->agent_class * 40503u + (uint32_t)key->mode * 97u + key->flags;
+    h ^= (uint32_t)key->clearance * 2246822519u;
+    h ^= key->profile_hash;
+    h ^= (uint32_t)(key->start_layer * PATH_MAX_LAYERS + key->goal_layer) * 374761393u;
+    h ^= h >> 15;
+    return &g_entries[(h % PATH_CACHE_SETS) * PATH_CACHE_WAYS];
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+bool path_cache_lookup(const PathCacheKey* key, Path** out_path) {
+    *out_path = NULL;
+
+    pthread_mutex_lock(&g_cache_mutex);
+
+    PathCacheEntry* set = key_set(key);
+    PathCacheEntry* hit = NULL;
+    for (int i = 0; i < PATH_CACHE_WAYS; i++) {
+        if (set[i].used && key_same_query(&set[i].key, key) && set[i].key.version == key->version) {
+            hit = &set[i];
+            break;
+        }
+    }
+
+    if (!hit) {
+        g_cache_stats.misses++;
+        pthread_mutex_unlock(&g_cache_mutex);
+        return false;
+    }
+
+    g_cache_stats.hits++;
+    hit->last_used = ++g_use_counter;
+
+    // Path memorizzato così com'è: stessa geometria del miss che l'ha
+    // prodotto, nessun segmento nuovo da verificare
+    Path* path = hit->path ? path_clone(hit->path) : NULL;
+    pthread_mutex_unlock(&g_cache_mutex);
+
+    *out_path = path;
+    return true;
+}
+
+void path_cache_store(const PathCacheKey* key, Path* path) {
+    // Copia fuori dal lock (malloc)
+    Path* copy = NULL;
+    if (path) {
+        copy = path_clone(path);
+        if (!copy) return;
+    }
+
+    pthread_mutex_lock(&g_cache_mutex);
+
+    PathCacheEntry* set = key_set(key);
+    PathCacheEntry* slot = NULL;
+
+    // Stessa query (anche con versione vecchia): sovrascrive
+    for (int i = 0; i < PATH_CACHE_WAYS && !slot; i++) {
+        if (set[i].used && key_same_query(&set[i].key, key)) slot = &set[i];
+    }
+    // Altrimenti slot libero o meno usato di recente
+    if (!slot) {
+        for (int i = 0; i < PATH_CACHE_WAYS; i++) {
+            if (!set[i].used) { slot = &set[i]; break; }
+            if (!slot || set[i].last_used < slot->last_used) slot = &set[i];
+        }
+        if (slot->used) g_cache_stats.evictions++;
+    }
+
+    Path* old = slot->path;
+    slot->used = true;
+    slot->key = *key;
+    slot->path = copy;
+    slot->last_used = ++g_use_counter;
+
+    pthread_mutex_unlock(&g_cache_mutex);
+
+    path_free(old);
+}
+
+void pathfinding_cache_clear(void) {
+    pthread_mutex_lock(&g_cache_mutex);
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        path_free(g_entries[i].path);
+    }
+    memset(g_entries, 0, sizeof(g_entries));
+    g_use_counter = 0;
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void pathfinding_cache_print_stats(void) {
+    pthread_mutex_lock(&g_cache_mutex);
+    long long lookups = g_cache_stats.hits + g_cache_stats.misses;
+    printf("  Cache hits: %lld / misses: %lld (%.1f%% hit rate)\n",
+           g_cache_stats.hits, g_cache_stats.misses,
+           lookups > 0 ? 100.0 * g_cache_stats.hits / lookups : 0.0);
+    printf("  Cache evictions: %lld\n", g_cache_stats.evictions);
+    pthread_mutex_unlock(&g_cache_mutex);
+}
+
+void pathfinding_cache_reset_stats(void) {
+    pthread_mutex_lock(&g_cache_mutex);
+    memset(&g_cache_stats, 0, sizeof(g_cache_stats));
+    pthread_mutex_unlock(&g_cache_mutex);
+}
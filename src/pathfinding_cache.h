@@ -0,0 +1,62 @@
+#ifndef PATHFINDING_CACHE_H
+#define PATHFINDING_CACHE_H
+
+/*
+ * PATH CACHE
+ * ==========
+ *
+ * Cache dei risultati di pathfinding_find_path (e delle ricerche time-sliced)
+ * per le richieste ripetute tra le stesse celle: spawn -> stessa torre,
+ * ordini ripetuti, creature dello stesso gruppo.
+ *
+ * Chiave: cella start, cella goal, classe agente, pesi del terreno e
+ * parametri della query.
+ * Ogni entry ricorda anche la somma delle versioni (PathGrid.version) dei
+ * chunk letti dalla ricerca: una modifica di walkability incrementa la
+ * versione del chunk, quindi l'entry non combacia più ed è di fatto invalida.
+ * Vengono memorizzati anche i fallimenti (goal irraggiungibile), che sono
+ * le ricerche più costose.
+ *
+ * Usata da più thread (worker di pathfinding_service): protetta da mutex.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+#define PATH_CACHE_SIZE 512   // Entry totali (potenza di 2)
+#define PATH_CACHE_WAYS 4     // Entry per set (LRU nel set)
+
+typedef struct {
+    struct Level* lvl;
+    int start_x, start_z;     // Celle globali del livello
+    int goal_x, goal_z;
+    int start_layer, goal_layer; // Layer di navigazione di start e goal (0 = terreno)
+    int agent_class;
+    int clearance;            // Clearance minima dell'agente (pathfinding_clearance_for_radius)
+    uint32_t profile_hash;    // Pesi del terreno (0 = costi uniformi)
+    PathSearchMode mode;
+    unsigned int flags;       // PATH_QUERY_* che cambiano il risultato
+    int zone_id;
+    uint64_t version;         // Somma delle versioni dei chunk letti dalla ricerca e dei layer
+} PathCacheKey;
+
+// Cerca un risultato. Ritorna true se presente: *out_path riceve una copia
+// invariata del path memorizzato o NULL se il risultato memorizzato è
+// "path inesistente".
+bool path_cache_lookup(const PathCacheKey* key, Path** out_path);
+
+// Memorizza un risultato (path NULL = irraggiungibile). Il path viene copiato.
+void path_cache_store(const PathCacheKey* key, Path* path);
+
+// Svuota la cache (da chiamare al cambio livello)
+void pathfinding_cache_clear(void);
+
+// Hit/miss (stampate anche da pathfinding_print_stats)
+void pathfinding_cache_print_stats(void);
+void pathfinding_cache_reset_stats(void);
+
+#endif // PATHFINDING_CACHE_H
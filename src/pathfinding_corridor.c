@@ -0,0 +1,400 @@
+#include "pathfinding_corridor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "level.h"
+
+// Lato della finestra delle ricerche locali (celle)
+#define REPAIR_SIDE (2 * CORRIDOR_REPAIR_RADIUS + 1)
+#define REPAIR_CELLS (REPAIR_SIDE * REPAIR_SIDE)
+
+// Blocchi aggirati al massimo in un update (gli altri al prossimo)
+#define MAX_DETOURS_PER_UPDATE 4
+
+struct PathCorridor {
+    struct Level* lvl;
+    int cells_x;
+    int cells_z;
+    int min_clearance;
+
+    // Celle globali (z * cells_x + x), adiacenti (8-connected) dalla partenza al goal
+    int* cells;
+    uint8_t* built_walkable;   // Cella libera quando è entrata nel corridoio
+    int count;
+    int capacity;
+
+    int cursor;                // Cella del corridoio più vicina all'agente
+    int steer;                 // Ultimo target restituito (indice nel corridoio)
+    vec3 goal;
+
+    // Scratch delle ricerche locali (finestra centrata sulla partenza)
+    int16_t parent[REPAIR_CELLS];       // -1 = non visitata
+    int16_t queue[REPAIR_CELLS];
+    int target_index[REPAIR_CELLS];     // Indice nel corridoio della cella (-1 = non target)
+    int route[REPAIR_CELLS];
+
+    CorridorStats stats;
+};
+
+// ============================================================================
+// CELLE
+// ============================================================================
+
+static bool cell_ok(PathCorridor* c, int cell) {
+    int x = cell % c->cells_x;
+    int z = cell / c->cells_x;
+    if (c->min_clearance <= 1) return pathfinding_level_cell_walkable(c->lvl, x, z);
+    return pathfinding_level_cell_clearance(c->lvl, x, z) >= c->min_clearance;
+}
+
+// Centro della cella i del corridoio (il goal esatto per l'ultima). Y dal goal:
+// le line of sight lavorano sul piano XZ
+static void corridor_point(PathCorridor* c, int i, vec3 out) {
+    if (i == c->count - 1) {
+        glm_vec3_copy(c->goal, out);
+        return;
+    }
+    float cell_size = pathfinding_level_cell_size(c->lvl);
+    out[0] = c->lvl->originX + (c->cells[i] % c->cells_x + 0.5f) * cell_size;
+    out[1] = c->goal[1];
+    out[2] = c->lvl->originZ + (c->cells[i] / c->cells_x + 0.5f) * cell_size;
+}
+
+static bool reserve(PathCorridor* c, int capacity) {
+    if (capacity <= c->capacity) return true;
+    int new_capacity = c->capacity > 0 ? c->capacity * 2 : 64;
+    while (new_capacity < capacity) new_capacity *= 2;
+
+    int* cells = (int*)realloc(c->cells, new_capacity * sizeof(int));
+    if (!cells) return false;
+    c->cells = cells;
+    uint8_t* built = (uint8_t*)realloc(c->built_walkable, new_capacity);
+    if (!built) return false;
+    c->built_walkable = built;
+    c->capacity = new_capacity;
+    return true;
+}
+
+static bool append_cell(PathCorridor* c, int x, int z) {
+    int cell = z * c->cells_x + x;
+    if (c->count > 0 && c->cells[c->count - 1] == cell) return true;
+    if (!reserve(c, c->count + 1)) return false;
+    c->cells[c->count] = cell;
+    c->built_walkable[c->count] = cell_ok(c, cell);
+    c->count++;
+    return true;
+}
+
+// Celle attraversate dal segmento a-b (traversal esatto: ogni cella toccata,
+// sequenza 4-connected)
+static bool append_segment(PathCorridor* c, vec3 a, vec3 b) {
+    float cell_size = pathfinding_level_cell_size(c->lvl);
+    float ax = (a[0] - c->lvl->originX) / cell_size;
+    float az = (a[2] - c->lvl->originZ) / cell_size;
+    float bx = (b[0] - c->lvl->originX) / cell_size;
+    float bz = (b[2] - c->lvl->originZ) / cell_size;
+
+    int x, z, ex, ez;
+    if (!pathfinding_level_world_to_cell(c->lvl, a, &x, &z) ||
+        !pathfinding_level_world_to_cell(c->lvl, b, &ex, &ez)) {
+        return false;
+    }
+
+    int sx = ex > x ? 1 : -1;
+    int sz = ez > z ? 1 : -1;
+    float dx = fabsf(bx - ax);
+    float dz = fabsf(bz - az);
+    float t_max_x = dx > 0.0f ? (sx > 0 ? (x + 1 - ax) : (ax - x)) / dx : INFINITY;
+    float t_max_z = dz > 0.0f ? (sz > 0 ? (z + 1 - az) : (az - z)) / dz : INFINITY;
+    float t_delta_x = dx > 0.0f ? 1.0f / dx : INFINITY;
+    float t_delta_z = dz > 0.0f ? 1.0f / dz : INFINITY;
+
+    if (!append_cell(c, x, z)) return false;
+    while (x != ex || z != ez) {
+        // Un asse già alla cella finale non avanza più (errori di arrotondamento)
+        if (z == ez || (x != ex && t_max_x < t_max_z)) {
+            x += sx;
+            t_max_x += t_delta_x;
+        } else {
+            z += sz;
+            t_max_z += t_delta_z;
+        }
+        if (!append_cell(c, x, z)) return false;
+    }
+    return true;
+}
+
+// Sostituisce le celle [first, last] con route[0..n-1]
+static bool splice(PathCorridor* c, int first, int last, const int* route, int n) {
+    int removed = last - first + 1;
+    int new_count = c->count - removed + n;
+    if (!reserve(c, new_count)) return false;
+
+    int tail = c->count - (last + 1);
+    memmove(&c->cells[first + n], &c->cells[last + 1], tail * sizeof(int));
+    memmove(&c->built_walkable[first + n], &c->built_walkable[last + 1], tail);
+    memcpy(&c->cells[first], route, n * sizeof(int));
+    // La partenza della ricerca può essere una cella bloccata (angolo sfiorato
+    // dal path, agente spinto contro un muro): non va trattata come nuovo blocco
+    for (int i = 0; i < n; i++) c->built_walkable[first + i] = cell_ok(c, route[i]);
+    c->count = new_count;
+    return true;
+}
+
+// ============================================================================
+// RICERCA LOCALE
+// ============================================================================
+
+// BFS 8-connected (diagonali sempre permesse, come l'A*) da start verso la
+// cella più vicina con indice nel corridoio tra first_target e last_target.
+// Ritorna l'indice raggiunto (-1 se nessuno entro il raggio) e il percorso in
+// c->route (da start al target compreso)
+static int local_search(PathCorridor* c, int start, int first_target, int last_target, int* out_len) {
+    int start_x = start % c->cells_x;
+    int start_z = start / c->cells_x;
+    int wx0 = start_x - CORRIDOR_REPAIR_RADIUS;
+    int wz0 = start_z - CORRIDOR_REPAIR_RADIUS;
+
+    memset(c->parent, 0xFF, sizeof(c->parent));
+    for (int w = 0; w < REPAIR_CELLS; w++) c->target_index[w] = -1;
+
+    // Target: a parità di cella (corridoio che ripassa) il più vicino al cursore
+    bool any_target = false;
+    for (int i = last_target; i >= first_target; i--) {
+        int tx = c->cells[i] % c->cells_x - wx0;
+        int tz = c->cells[i] / c->cells_x - wz0;
+        if (tx < 0 || tz < 0 || tx >= REPAIR_SIDE || tz >= REPAIR_SIDE) continue;
+        if (!cell_ok(c, c->cells[i])) continue;
+        c->target_index[tz * REPAIR_SIDE + tx] = i;
+        any_target = true;
+    }
+    if (!any_target) return -1;
+
+    int start_w = CORRIDOR_REPAIR_RADIUS * REPAIR_SIDE + CORRIDOR_REPAIR_RADIUS;
+    int head = 0, tail = 0;
+    c->queue[tail++] = (int16_t)start_w;
+    c->parent[start_w] = (int16_t)start_w;
+
+    int found_w = -1;
+    while (head < tail) {
+        int w = c->queue[head++];
+        if (c->target_index[w] >= 0) {
+            found_w = w;
+            break;
+        }
+
+        int lx = w % REPAIR_SIDE;
+        int lz = w / REPAIR_SIDE;
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dz == 0) continue;
+                int nx = lx + dx;
+                int nz = lz + dz;
+                if (nx < 0 || nz < 0 || nx >= REPAIR_SIDE || nz >= REPAIR_SIDE) continue;
+                int nw = nz * REPAIR_SIDE + nx;
+                if (c->parent[nw] >= 0) continue;
+
+                int gx = wx0 + nx;
+                int gz = wz0 + nz;
+                if (gx < 0 || gz < 0 || gx >= c->cells_x || gz >= c->cells_z) continue;
+                if (!cell_ok(c, gz * c->cells_x + gx)) continue;
+
+                c->parent[nw] = (int16_t)w;
+                c->queue[tail++] = (int16_t)nw;
+            }
+        }
+    }
+    c->stats.last_search_cells = tail;
+    if (found_w < 0) return -1;
+
+    // Ricostruzione all'indietro, poi inversione
+    int n = 0;
+    for (int w = found_w; ; w = c->parent[w]) {
+        c->route[n++] = (wz0 + w / REPAIR_SIDE) * c->cells_x + (wx0 + w % REPAIR_SIDE);
+        if (w == start_w) break;
+    }
+    for (int i = 0; i < n / 2; i++) {
+        int tmp = c->route[i];
+        c->route[i] = c->route[n - 1 - i];
+        c->route[n - 1 - i] = tmp;
+    }
+    *out_len = n;
+    return c->target_index[found_w];
+}
+
+// Aggira le celle davanti diventate bloccate dopo il build. false = corridoio rotto
+static bool repair_blocked(PathCorridor* c, bool* repaired) {
+    for (int detours = 0; detours < MAX_DETOURS_PER_UPDATE; detours++) {
+        int end = c->cursor + CORRIDOR_LOOKAHEAD;
+        if (end > c->count - 1) end = c->count - 1;
+
+        int blocked = -1;
+        for (int i = c->cursor + 1; i <= end; i++) {
+            if (c->built_walkable[i] && !cell_ok(c, c->cells[i])) {
+                blocked = i;
+                break;
+            }
+        }
+        if (blocked < 0) return true;
+
+        // Prima cella libera dopo il tratto bloccato
+        int rejoin = blocked + 1;
+        while (rejoin < c->count && !cell_ok(c, c->cells[rejoin])) rejoin++;
+        if (rejoin >= c->count) return false;   // Goal bloccato
+
+        int last_target = rejoin + CORRIDOR_LOOKAHEAD;
+        if (last_target > c->count - 1) last_target = c->count - 1;
+
+        int from = blocked - 1;
+        int len = 0;
+        int reached = local_search(c, c->cells[from], rejoin, last_target, &len);
+        if (reached < 0) return false;
+
+        if (!splice(c, from, reached, c->route, len)) return false;
+        if (c->steer > from) c->steer = -1;
+        c->stats.detours++;
+        *repaired = true;
+    }
+    return true;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+PathCorridor* corridor_create(struct Level* lvl, const Path* path, float agent_radius) {
+    if (!lvl || !lvl->chunks || !path || path->waypoint_count < 1) return NULL;
+    if (path->waypoint_layers) return NULL;
+
+    PathCorridor* c = (PathCorridor*)calloc(1, sizeof(PathCorridor));
+    if (!c) return NULL;
+
+    c->lvl = lvl;
+    c->cells_x = pathfinding_level_cells_x(lvl);
+    c->cells_z = pathfinding_level_cells_z(lvl);
+    c->min_clearance = pathfinding_clearance_for_radius(lvl, agent_radius);
+    c->steer = -1;
+    glm_vec3_copy(path->waypoints[path->waypoint_count - 1], c->goal);
+
+    bool ok = true;
+    if (path->waypoint_count == 1) {
+        int x, z;
+        ok = pathfinding_level_world_to_cell(lvl, path->waypoints[0], &x, &z) && append_cell(c, x, z);
+    }
+    for (int i = 0; ok && i + 1 < path->waypoint_count; i++) {
+        ok = append_segment(c, path->waypoints[i], path->waypoints[i + 1]);
+    }
+    if (!ok) {
+        corridor_destroy(c);
+        return NULL;
+    }
+    return c;
+}
+
+void corridor_destroy(PathCorridor* corridor) {
+    if (!corridor) return;
+    free(corridor->cells);
+    free(corridor->built_walkable);
+    free(corridor);
+}
+
+CorridorStatus corridor_update(PathCorridor* c, vec3 agent_pos, vec3 out_target) {
+    int ax, az;
+    if (!pathfinding_level_world_to_cell(c->lvl, agent_pos, &ax, &az)) {
+        c->stats.failures++;
+        return CORRIDOR_BROKEN;
+    }
+    bool repaired = false;
+
+    // 1. Cella del corridoio più vicina all'agente (Chebyshev), a parità la più avanti
+    int first = c->cursor > 2 ? c->cursor - 2 : 0;
+    int last = c->cursor + CORRIDOR_LOOKAHEAD;
+    if (last > c->count - 1) last = c->count - 1;
+
+    int best = c->cursor;
+    int best_dist = INT_MAX;
+    for (int i = first; i <= last; i++) {
+        int dx = abs(c->cells[i] % c->cells_x - ax);
+        int dz = abs(c->cells[i] / c->cells_x - az);
+        int dist = dx > dz ? dx : dz;
+        if (dist <= best_dist) {
+            best_dist = dist;
+            best = i;
+        }
+    }
+    c->cursor = best;
+
+    // 2. Fuori dal corridoio: va bene finché vede ancora il target precedente
+    //    (scorciatoia in line of sight), altrimenti ricerca locale per rientrare
+    if (best_dist > 1) {
+        vec3 steer_point;
+        bool on_shortcut = false;
+        if (c->steer > c->cursor && c->steer < c->count) {
+            corridor_point(c, c->steer, steer_point);
+            on_shortcut = pathfinding_level_line_clear(c->lvl, agent_pos, steer_point, c->min_clearance);
+        }
+        if (!on_shortcut) {
+            int len = 0;
+            int reached = local_search(c, az * c->cells_x + ax, c->cursor, last, &len);
+            if (reached < 0 || !splice(c, c->cursor, reached, c->route, len)) {
+                c->stats.failures++;
+                return CORRIDOR_BROKEN;
+            }
+            c->steer = -1;
+            c->stats.rejoins++;
+            repaired = true;
+        }
+    }
+
+    // 3. Celle davanti bloccate dopo il build
+    if (!repair_blocked(c, &repaired)) {
+        c->stats.failures++;
+        return CORRIDOR_BROKEN;
+    }
+
+    // 4. Target: la cella più avanti in line of sight, almeno la successiva
+    //    (adiacente: raggiungibile anche quando la line of sight dal centro
+    //    sfiora un angolo bloccato). Si riparte dal target precedente se
+    //    ancora visibile: a regime una o due line of sight per update
+    int limit = c->cursor + CORRIDOR_LOOKAHEAD;
+    if (limit > c->count - 1) limit = c->count - 1;
+
+    int steer = c->cursor + 1 < c->count ? c->cursor + 1 : c->count - 1;
+    int probe = steer + 1;
+    vec3 point;
+    if (c->steer > steer && c->steer <= limit) {
+        corridor_point(c, c->steer, point);
+        if (pathfinding_level_line_clear(c->lvl, agent_pos, point, c->min_clearance)) {
+            steer = c->steer;
+            probe = c->steer + 1;
+        }
+    }
+    for (; probe <= limit; probe++) {
+        corridor_point(c, probe, point);
+        if (!pathfinding_level_line_clear(c->lvl, agent_pos, point, c->min_clearance)) break;
+        steer = probe;
+    }
+    c->steer = steer;
+
+    if (steer == c->count - 1) {
+        glm_vec3_copy(c->goal, out_target);
+        return CORRIDOR_LAST_LEG;
+    }
+    pathfinding_level_cell_to_world(c->lvl, c->cells[steer] % c->cells_x, c->cells[steer] / c->cells_x, out_target);
+    return repaired ? CORRIDOR_REPAIRED : CORRIDOR_FOLLOWING;
+}
+
+void corridor_get_goal(PathCorridor* corridor, vec3 out_goal) {
+    glm_vec3_copy(corridor->goal, out_goal);
+}
+
+int corridor_remaining_cells(PathCorridor* corridor) {
+    return corridor->count - 1 - corridor->cursor;
+}
+
+void corridor_get_stats(PathCorridor* corridor, CorridorStats* out_stats) {
+    if (!corridor || !out_stats) return;
+    *out_stats = corridor->stats;
+}
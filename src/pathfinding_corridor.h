@@ -0,0 +1,72 @@
+#ifndef PATHFINDING_CORRIDOR_H
+#define PATHFINDING_CORRIDOR_H
+
+/*
+ * PATH CORRIDOR
+ * =============
+ *
+ * Follower per agente: la sequenza di celle (globali, layer 0) attraversate
+ * dal path, con un cursore sulla cella dell'agente. Ogni update:
+ *   - ritrova l'agente vicino al cursore (spinto di lato dalla folla)
+ *   - controlla le celle davanti: se una cella libera al build è diventata
+ *     bloccata (ostacolo, muro) la aggira con una ricerca locale
+ *   - se l'agente è uscito dal corridoio lo riporta dentro con una ricerca
+ *     locale verso le celle davanti
+ *   - restituisce come target la cella più avanti in line of sight
+ *
+ * Le ricerche locali sono BFS limitate a CORRIDOR_REPAIR_RADIUS celle attorno
+ * al punto di partenza, senza allocazioni: la nuova sequenza sostituisce il
+ * tratto del corridoio. Solo quando falliscono il corridoio è rotto e serve
+ * una nuova ricerca globale (pathfinding_find_path).
+ *
+ * Path con waypoint_layers (ponti, mura) non supportati: corridor_create
+ * ritorna NULL e si seguono i waypoint. Solo main thread.
+ */
+
+#include <stdbool.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+// Celle davanti al cursore controllate a ogni update (blocchi e line of sight)
+#define CORRIDOR_LOOKAHEAD 24
+
+// Raggio (Chebyshev, in celle) delle ricerche locali
+#define CORRIDOR_REPAIR_RADIUS 8
+
+typedef enum {
+    CORRIDOR_FOLLOWING,   // Target intermedio valido
+    CORRIDOR_REPAIRED,    // Come FOLLOWING, dopo una riparazione locale in questo update
+    CORRIDOR_LAST_LEG,    // Il target è il goal
+    CORRIDOR_BROKEN       // Riparazione locale impossibile: serve una ricerca globale
+} CorridorStatus;
+
+typedef struct {
+    int rejoins;              // Agente riportato nel corridoio
+    int detours;              // Celle bloccate aggirate
+    int failures;             // Update finiti in CORRIDOR_BROKEN
+    int last_search_cells;    // Celle visitate dall'ultima ricerca locale
+} CorridorStats;
+
+typedef struct PathCorridor PathCorridor;
+
+// Corridoio lungo path (non preso in ownership). agent_radius come in
+// PathQueryParams: le riparazioni rispettano la clearance.
+// NULL se il path è vuoto, fuori livello o usa i layer
+PathCorridor* corridor_create(struct Level* lvl, const Path* path, float agent_radius);
+void corridor_destroy(PathCorridor* corridor);
+
+// Aggiorna con la posizione corrente dell'agente. out_target: punto verso
+// cui muoversi (non valido con CORRIDOR_BROKEN)
+CorridorStatus corridor_update(PathCorridor* corridor, vec3 agent_pos, vec3 out_target);
+
+// Goal del path originale (per la ricerca globale dopo CORRIDOR_BROKEN)
+void corridor_get_goal(PathCorridor* corridor, vec3 out_goal);
+
+// Celle rimaste dal cursore al goal
+int corridor_remaining_cells(PathCorridor* corridor);
+
+void corridor_get_stats(PathCorridor* corridor, CorridorStats* out_stats);
+
+#endif // PATHFINDING_CORRIDOR_H
@@ -0,0 +1,490 @@
+#include "pathfinding_dstar.h"
+#include "pathfinding_internal.h"
+#include "level.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define DSTAR_MAX_CHUNKS 3
+#define DSTAR_INF FLT_MAX
+
+// ============================================================================
+// INTERNAL STRUCTURES
+// ============================================================================
+
+// Direzioni: 8-connected (stesso ordine e costi dell'A* a griglia)
+static const int ds_dx[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+static const int ds_dz[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const float ds_costs[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.414f, 1.414f, 1.414f, 1.414f};
+
+typedef struct {
+    float k1, k2;
+    int cell;
+} DStarHeapEntry;
+
+struct DStarPlanner {
+    struct Level* lvl;
+
+    // Finestra (coordinate globali della prima cella) e dimensioni
+    int origin_x, origin_z;
+    int width, height;
+
+    uint8_t* walk;           // Copia locale della walkability (aggiornata dal listener)
+    float* g;
+    float* rhs;
+    float* key1;             // Chiave dell'entry valida in open (lazy deletion)
+    float* key2;
+    uint8_t* in_open;
+
+    DStarHeapEntry* heap;
+    int heap_size;
+    int heap_capacity;
+
+    int start_cell, goal_cell;
+    int last_cell;           // Start all'ultima riparazione (per km)
+    float km;
+    bool needs_replan;
+    bool out_of_memory;      // Un heap_push è fallito: stato non più valido, da ricreare
+
+    int expanded_last;
+    long long expanded_total;
+    int replans;
+
+    struct DStarPlanner* next;   // Lista dei planner attivi
+};
+
+static DStarPlanner* g_planners = NULL;
+static bool g_listener_registered = false;
+
+// ============================================================================
+// MIN-HEAP (chiavi lessicografiche, lazy deletion)
+// ============================================================================
+
+static bool key_less(float a1, float a2, float b1, float b2) {
+    return a1 < b1 || (a1 == b1 && a2 < b2);
+}
+
+static bool heap_push(DStarPlanner* p, float k1, float k2, int cell) {
+    if (p->heap_size >= p->heap_capacity) {
+        int new_capacity = p->heap_capacity > 0 ? p->heap_capacity * 2 : 1024;
+        DStarHeapEntry* new_heap = (DStarHeapEntry*)realloc(p->heap, new_capacity * sizeof(DStarHeapEntry));
+        if (!new_heap) return false;
+        p->heap = new_heap;
+        p->heap_capacity = new_capacity;
+    }
+
+    int index = p->heap_size++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!key_less(k1, k2, p->heap[parent].k1, p->heap[parent].k2)) break;
+        p->heap[index] = p->heap[parent];
+        index = parent;
+    }
+    p->heap[index].k1 = k1;
+    p->heap[index].k2 = k2;
+    p->heap[index].cell = cell;
+    return true;
+}
+
+static void heap_pop(DStarPlanner* p) {
+    DStarHeapEntry last = p->heap[--p->heap_size];
+
+    int index = 0;
+    while (true) {
+        int left = 2 * index + 1;
+        if (left >= p->heap_size) break;
+        int right = left + 1;
+        int smallest = (right < p->heap_size &&
+                        key_less(p->heap[right].k1, p->heap[right].k2, p->heap[left].k1, p->heap[left].k2))
+                       ? right : left;
+        if (!key_less(p->heap[smallest].k1, p->heap[smallest].k2, last.k1, last.k2)) break;
+        p->heap[index] = p->heap[smallest];
+        index = smallest;
+    }
+    if (p->heap_size > 0) p->heap[index] = last;
+}
+
+// Scarta le entry obsolete in cima. Ritorna false se l'open set è vuoto
+static bool heap_top_valid(DStarPlanner* p) {
+    while (p->heap_size > 0) {
+        DStarHeapEntry* top = &p->heap[0];
+        if (p->in_open[top->cell] && p->key1[top->cell] == top->k1 && p->key2[top->cell] == top->k2) {
+            return true;
+        }
+        heap_pop(p);
+    }
+    return false;
+}
+
+// ============================================================================
+// D* LITE
+// ============================================================================
+
+// Distanza ottile (consistente con i costi 1 / 1.414)
+static float heuristic(DStarPlanner* p, int a, int b) {
+    int dx = abs(a % p->width - b % p->width);
+    int dz = abs(a / p->width - b / p->width);
+    int dmin = dx < dz ? dx : dz;
+    int dmax = dx < dz ? dz : dx;
+    return (dmax - dmin) + 1.414f * dmin;
+}
+
+static void calculate_key(DStarPlanner* p, int cell, float* k1, float* k2) {
+    float m = fminf(p->g[cell], p->rhs[cell]);
+    if (m == DSTAR_INF) {
+        *k1 = DSTAR_INF;
+        *k2 = DSTAR_INF;
+        return;
+    }
+    *k1 = m + heuristic(p, p->start_cell, cell) + p->km;
+    *k2 = m;
+}
+
+// Ritorna false se l'open set non può crescere (planner marcato out_of_memory)
+static bool update_vertex(DStarPlanner* p, int cell) {
+    if (cell != p->goal_cell) {
+        float best = DSTAR_INF;
+
+        if (p->walk[cell]) {
+            int x = cell % p->width;
+            int z = cell / p->width;
+            for (int i = 0; i < 8; i++) {
+                int nx = x + ds_dx[i];
+                int nz = z + ds_dz[i];
+                if (nx < 0 || nx >= p->width || nz < 0 || nz >= p->height) continue;
+
+                int n = nz * p->width + nx;
+                if (!p->walk[n] || p->g[n] == DSTAR_INF) continue;
+
+                float cost = p->g[n] + ds_costs[i];
+                if (cost < best) best = cost;
+            }
+        }
+        p->rhs[cell] = best;
+    }
+
+    // Rimuovi/reinserisci nell'open set (l'entry precedente diventa obsoleta)
+    p->in_open[cell] = 0;
+    if (p->g[cell] != p->rhs[cell]) {
+        float k1, k2;
+        calculate_key(p, cell, &k1, &k2);
+        p->key1[cell] = k1;
+        p->key2[cell] = k2;
+        p->in_open[cell] = 1;
+        if (!heap_push(p, k1, k2, cell)) {
+            // Senza entry nell'heap la cella non verrebbe mai riparata
+            p->in_open[cell] = 0;
+            p->out_of_memory = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool update_neighbors(DStarPlanner* p, int cell) {
+    int x = cell % p->width;
+    int z = cell / p->width;
+    for (int i = 0; i < 8; i++) {
+        int nx = x + ds_dx[i];
+        int nz = z + ds_dz[i];
+        if (nx < 0 || nx >= p->width || nz < 0 || nz >= p->height) continue;
+        if (!update_vertex(p, nz * p->width + nx)) return false;
+    }
+    return true;
+}
+
+// Ritorna false se la memoria dell'open set è finita (ricerca interrotta)
+static bool compute_shortest_path(DStarPlanner* p) {
+    int start = p->start_cell;
+    p->expanded_last = 0;
+
+    while (heap_top_valid(p)) {
+        float start_k1, start_k2;
+        calculate_key(p, start, &start_k1, &start_k2);
+
+        DStarHeapEntry top = p->heap[0];
+        if (!key_less(top.k1, top.k2, start_k1, start_k2) && p->rhs[start] == p->g[start]) break;
+
+        heap_pop(p);
+        int u = top.cell;
+        p->in_open[u] = 0;
+        p->expanded_last++;
+
+        float new_k1, new_k2;
+        calculate_key(p, u, &new_k1, &new_k2);
+
+        if (key_less(top.k1, top.k2, new_k1, new_k2)) {
+            // Chiave vecchia (km cambiato): reinserisci
+            p->key1[u] = new_k1;
+            p->key2[u] = new_k2;
+            p->in_open[u] = 1;
+            if (!heap_push(p, new_k1, new_k2, u)) {
+                p->in_open[u] = 0;
+                p->out_of_memory = true;
+            }
+        } else if (p->g[u] > p->rhs[u]) {
+            // Sovra-consistente: il costo è sceso
+            p->g[u] = p->rhs[u];
+            update_neighbors(p, u);
+        } else {
+            // Sotto-consistente: il costo è salito, ricalcola u e vicini
+            p->g[u] = DSTAR_INF;
+            if (update_vertex(p, u)) update_neighbors(p, u);
+        }
+        if (p->out_of_memory) break;
+    }
+
+    p->expanded_total += p->expanded_last;
+    p->replans++;
+    p->needs_replan = false;
+    return !p->out_of_memory;
+}
+
+// ============================================================================
+// WALKABILITY CHANGES
+// ============================================================================
+
+static void planner_apply_change(DStarPlanner* p, int x0, int z0, int x1, int z1) {
+    // Intersezione con la finestra del planner (coordinate locali)
+    int lx0 = x0 - p->origin_x, lz0 = z0 - p->origin_z;
+    int lx1 = x1 - p->origin_x, lz1 = z1 - p->origin_z;
+    if (lx0 < 0) lx0 = 0;
+    if (lz0 < 0) lz0 = 0;
+    if (lx1 >= p->width) lx1 = p->width - 1;
+    if (lz1 >= p->height) lz1 = p->height - 1;
+    if (lx0 > lx1 || lz0 > lz1) return;
+
+    for (int z = lz0; z <= lz1; z++) {
+        for (int x = lx0; x <= lx1; x++) {
+            int cell = z * p->width + x;
+            uint8_t walk = pathfinding_level_cell_walkable(p->lvl, p->origin_x + x, p->origin_z + z) ? 1 : 0;
+            if (walk == p->walk[cell]) continue;
+
+            // Cambiano gli archi tra la cella e i vicini: ripara entrambi i lati
+            p->walk[cell] = walk;
+            p->needs_replan = true;
+            if (!update_vertex(p, cell) || !update_neighbors(p, cell)) return;
+        }
+    }
+}
+
+static void on_walkability_changed(struct Level* lvl, int x0, int z0, int x1, int z1, void* user) {
+    (void)user;
+    for (DStarPlanner* p = g_planners; p; p = p->next) {
+        if (p->lvl == lvl) {
+            planner_apply_change(p, x0, z0, x1, z1);
+        }
+    }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+static bool planner_world_to_cell(DStarPlanner* p, vec3 pos, int* out_cell) {
+    int cx, cz;
+    if (!pathfinding_level_world_to_cell(p->lvl, pos, &cx, &cz)) return false;
+
+    cx -= p->origin_x;
+    cz -= p->origin_z;
+    if (cx < 0 || cx >= p->width || cz < 0 || cz >= p->height) return false;
+
+    *out_cell = cz * p->width + cx;
+    return true;
+}
+
+DStarPlanner* dstar_create(struct Level* lvl, vec3 start, vec3 goal) {
+    if (!lvl || !lvl->chunks) return NULL;
+    pathfinding_flush_changes();
+
+    int sx, sz, gx, gz;
+    if (!pathfinding_level_world_to_cell(lvl, start, &sx, &sz) ||
+        !pathfinding_level_world_to_cell(lvl, goal, &gx, &gz)) {
+        printf("[DStar] Start or goal outside level\n");
+        return NULL;
+    }
+
+    // Rettangolo di chunk tra start e goal (come la finestra dell'A*)
+    int chunk_x0 = (sx < gx ? sx : gx) / PATHGRID_SIZE;
+    int chunk_z0 = (sz < gz ? sz : gz) / PATHGRID_SIZE;
+    int chunk_x1 = (sx > gx ? sx : gx) / PATHGRID_SIZE;
+    int chunk_z1 = (sz > gz ? sz : gz) / PATHGRID_SIZE;
+    if (chunk_x1 - chunk_x0 + 1 > DSTAR_MAX_CHUNKS || chunk_z1 - chunk_z0 + 1 > DSTAR_MAX_CHUNKS) {
+        printf("[DStar] Start and goal span more than %dx%d chunks\n", DSTAR_MAX_CHUNKS, DSTAR_MAX_CHUNKS);
+        return NULL;
+    }
+
+    DStarPlanner* p = (DStarPlanner*)calloc(1, sizeof(DStarPlanner));
+    if (!p) return NULL;
+
+    p->lvl = lvl;
+    p->origin_x = chunk_x0 * PATHGRID_SIZE;
+    p->origin_z = chunk_z0 * PATHGRID_SIZE;
+    p->width = (chunk_x1 - chunk_x0 + 1) * PATHGRID_SIZE;
+    p->height = (chunk_z1 - chunk_z0 + 1) * PATHGRID_SIZE;
+
+    int cells = p->width * p->height;
+    p->walk = (uint8_t*)malloc(cells);
+    p->g = (float*)malloc(cells * sizeof(float));
+    p->rhs = (float*)malloc(cells * sizeof(float));
+    p->key1 = (float*)malloc(cells * sizeof(float));
+    p->key2 = (float*)malloc(cells * sizeof(float));
+    p->in_open = (uint8_t*)calloc(cells, 1);
+
+    if (!p->walk || !p->g || !p->rhs || !p->key1 || !p->key2 || !p->in_open) {
+        printf("[DStar] ERROR: Failed to allocate planner (%d cells)\n", cells);
+        dstar_destroy(p);
+        return NULL;
+    }
+
+    for (int z = 0; z < p->height; z++) {
+        for (int x = 0; x < p->width; x++) {
+            int cell = z * p->width + x;
+            p->walk[cell] = pathfinding_level_cell_walkable(lvl, p->origin_x + x, p->origin_z + z) ? 1 : 0;
+            p->g[cell] = DSTAR_INF;
+            p->rhs[cell] = DSTAR_INF;
+        }
+    }
+
+    p->start_cell = (sz - p->origin_z) * p->width + (sx - p->origin_x);
+    p->goal_cell = (gz - p->origin_z) * p->width + (gx - p->origin_x);
+    p->last_cell = p->start_cell;
+    p->km = 0.0f;
+
+    // La ricerca parte dal goal
+    p->rhs[p->goal_cell] = 0.0f;
+    p->needs_replan = true;
+    if (!update_vertex(p, p->goal_cell)) {
+        printf("[DStar] ERROR: Failed to allocate open set\n");
+        dstar_destroy(p);
+        return NULL;
+    }
+
+    if (!g_listener_registered) {
+        g_listener_registered = pathfinding_add_change_listener(on_walkability_changed, NULL);
+    }
+    p->next = g_planners;
+    g_planners = p;
+
+    return p;
+}
+
+void dstar_destroy(DStarPlanner* planner) {
+    if (!planner) return;
+
+    // Rimuovi dalla lista dei planner attivi
+    for (DStarPlanner** link = &g_planners; *link; link = &(*link)->next) {
+        if (*link == planner) {
+            *link = planner->next;
+            break;
+        }
+    }
+
+    free(planner->walk);
+    free(planner->g);
+    free(planner->rhs);
+    free(planner->key1);
+    free(planner->key2);
+    free(planner->in_open);
+    free(planner->heap);
+    free(planner);
+}
+
+bool dstar_update_start(DStarPlanner* planner, vec3 pos) {
+    if (!planner) return false;
+
+    int cell;
+    if (!planner_world_to_cell(planner, pos, &cell)) return false;
+    if (cell == planner->start_cell) return true;
+
+    planner->start_cell = cell;
+    planner->needs_replan = true;
+    return true;
+}
+
+bool dstar_replan(DStarPlanner* planner) {
+    if (!planner) return false;
+
+    // Le modifiche in attesa arrivano al planner tramite il listener
+    pathfinding_flush_changes();
+    if (planner->out_of_memory) return false;
+
+    if (planner->needs_replan) {
+        // Lo start si è spostato: le chiavi in open restano valide aumentando km
+        if (planner->last_cell != planner->start_cell) {
+            planner->km += heuristic(planner, planner->last_cell, planner->start_cell);
+            planner->last_cell = planner->start_cell;
+        }
+        if (!compute_shortest_path(planner)) {
+            printf("[DStar] ERROR: Open set allocation failed, planner must be recreated\n");
+            return false;
+        }
+    }
+
+    return planner->walk[planner->start_cell] && planner->g[planner->start_cell] != DSTAR_INF;
+}
+
+Path* dstar_get_path(DStarPlanner* planner, bool smooth) {
+    if (!dstar_replan(planner)) return NULL;
+
+    DStarPlanner* p = planner;
+    int cells = p->width * p->height;
+
+    Path* path = path_create(64);
+    if (!path) return NULL;
+
+    // Discesa del gradiente di g dallo start al goal
+    int cell = p->start_cell;
+    for (int steps = 0; steps <= cells; steps++) {
+        vec3 world;
+        pathfinding_level_cell_to_world(p->lvl, p->origin_x + cell % p->width, p->origin_z + cell / p->width, world);
+        path_add_waypoint(path, world);
+
+        if (cell == p->goal_cell) break;
+
+        int x = cell % p->width;
+        int z = cell / p->width;
+        int best = -1;
+        float best_cost = DSTAR_INF;
+        for (int i = 0; i < 8; i++) {
+            int nx = x + ds_dx[i];
+            int nz = z + ds_dz[i];
+            if (nx < 0 || nx >= p->width || nz < 0 || nz >= p->height) continue;
+
+            int n = nz * p->width + nx;
+            if (!p->walk[n] || p->g[n] == DSTAR_INF) continue;
+
+            float cost = p->g[n] + ds_costs[i];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = n;
+            }
+        }
+
+        if (best < 0) {
+            path_free(path);
+            return NULL;
+        }
+        cell = best;
+    }
+
+    if (cell != p->goal_cell) {
+        path_free(path);
+        return NULL;
+    }
+
+    if (smooth) {
+        pathfinding_smooth_path_level(p->lvl, path);
+    }
+    return path;
+}
+
+void dstar_print_stats(DStarPlanner* planner) {
+    if (!planner) return;
+    printf("[DStar] Stats (%dx%d cells):\n", planner->width, planner->height);
+    printf("  Replans: %d\n", planner->replans);
+    printf("  Last expanded: %d\n", planner->expanded_last);
+    printf("  Total expanded: %lld\n", planner->expanded_total);
+}
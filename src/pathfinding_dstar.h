@@ -0,0 +1,50 @@
+#ifndef PATHFINDING_DSTAR_H
+#define PATHFINDING_DSTAR_H
+
+/*
+ * D* LITE
+ * =======
+ *
+ * Planner incrementale per agente (Koenig & Likhachev). La ricerca parte dal
+ * goal verso l'agente: quando l'agente si muove o la walkability cambia
+ * (pathfinding_set_cells_walkable) vengono riparate solo le celle toccate,
+ * invece di rifare la ricerca da zero.
+ *
+ * Ogni planner copre il rettangolo di chunk tra start e goal (max 3x3, come
+ * l'A* a griglia) e tiene g/rhs per cella: 18 byte per cella (walk, g, rhs,
+ * due chiavi, in_open), ~290KB per una finestra 2x2, più l'open set. Da usare per agenti con goal stabile (es. creatura
+ * diretta a una torre), non per query una tantum.
+ *
+ * Solo main thread.
+ */
+
+#include <stdbool.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+typedef struct DStarPlanner DStarPlanner;
+
+// Crea un planner tra start e goal. NULL se fuori livello o oltre la finestra 3x3
+DStarPlanner* dstar_create(struct Level* lvl, vec3 start, vec3 goal);
+void dstar_destroy(DStarPlanner* planner);
+
+// L'agente si è spostato. Ritorna false se pos è fuori dalla finestra del planner
+bool dstar_update_start(DStarPlanner* planner, vec3 pos);
+
+// Ripara la ricerca (modifiche pendenti e nuovo start).
+// Ritorna true se il goal è raggiungibile dalla posizione corrente. false
+// anche se l'open set non ha potuto crescere: da quel momento il planner
+// non è più valido (ogni replan fallisce) e va ricreato.
+bool dstar_replan(DStarPlanner* planner);
+
+// Path dalla posizione corrente al goal (esegue dstar_replan se necessario).
+// smooth: applica lo string pulling come pathfinding_find_path.
+// Ritorna NULL se il goal non è raggiungibile. Da liberare con path_free.
+Path* dstar_get_path(DStarPlanner* planner, bool smooth);
+
+// Celle espanse dall'ultima riparazione e in totale
+void dstar_print_stats(DStarPlanner* planner);
+
+#endif // PATHFINDING_DSTAR_H
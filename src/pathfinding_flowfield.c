@@ -0,0 +1,353 @@
+#include "pathfinding_flowfield.h"
+#include "level.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+// ============================================================================
+// INTERNAL STRUCTURES
+// ============================================================================
+
+// Direzioni: 8-connected (stesso ordine e costi dell'A* a griglia)
+static const int ff_dx[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+static const int ff_dz[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const float ff_costs[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.414f, 1.414f, 1.414f, 1.414f};
+static const uint8_t ff_opposite[8] = {1, 0, 3, 2, 7, 6, 5, 4};
+
+// Entry del min-heap (lazy deletion: le entry obsolete vengono scartate al pop)
+typedef struct {
+    float cost;
+    int cell;
+} FlowHeapEntry;
+
+static FlowField g_fields[FLOWFIELD_CACHE_SIZE];
+static struct Level* g_fields_level = NULL;
+static unsigned int g_use_counter = 0;
+static bool g_listener_registered = false;
+
+// Scratch riutilizzato tra i build
+static uint8_t* g_walk = NULL;          // Walkability di tutto il livello
+static int g_walk_cells = 0;
+static FlowHeapEntry* g_heap = NULL;
+static int g_heap_size = 0;
+static int g_heap_capacity = 0;
+
+static struct {
+    int requests;
+    int hits;
+    int builds;
+    float total_build_ms;
+    float max_build_ms;
+} g_ff_stats = {0};
+
+// ============================================================================
+// MIN-HEAP
+// ============================================================================
+
+static bool heap_push(float cost, int cell) {
+    if (g_heap_size >= g_heap_capacity) {
+        int new_capacity = g_heap_capacity > 0 ? g_heap_capacity * 2 : 4096;
+        FlowHeapEntry* new_heap = (FlowHeapEntry*)realloc(g_heap, new_capacity * sizeof(FlowHeapEntry));
+        if (!new_heap) return false;
+        g_heap = new_heap;
+        g_heap_capacity = new_capacity;
+    }
+
+    int index = g_heap_size++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (g_heap[parent].cost <= cost) break;
+        g_heap[index] = g_heap[parent];
+        index = parent;
+    }
+    g_heap[index].cost = cost;
+    g_heap[index].cell = cell;
+    return true;
+}
+
+static FlowHeapEntry heap_pop(void) {
+    FlowHeapEntry top = g_heap[0];
+    FlowHeapEntry last = g_heap[--g_heap_size];
+
+    int index = 0;
+    while (true) {
+        int left = 2 * index + 1;
+        if (left >= g_heap_size) break;
+        int right = left + 1;
+        int smallest = (right < g_heap_size && g_heap[right].cost < g_heap[left].cost) ? right : left;
+        if (g_heap[smallest].cost >= last.cost) break;
+        g_heap[index] = g_heap[smallest];
+        index = smallest;
+    }
+    if (g_heap_size > 0) g_heap[index] = last;
+
+    return top;
+}
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+// Libera i dati del campo; la generazione dello slot sopravvive
+static void field_free(FlowField* ff) {
+    uint16_t generation = ff->generation;
+    free(ff->integration);
+    free(ff->directions);
+    memset(ff, 0, sizeof(FlowField));
+    ff->generation = generation;
+}
+
+static bool field_alloc(FlowField* ff, int width, int height) {
+    if (ff->integration && ff->width == width && ff->height == height) return true;
+
+    field_free(ff);
+    ff->integration = (float*)malloc(width * height * sizeof(float));
+    ff->directions = (uint8_t*)malloc(width * height);
+    if (!ff->integration || !ff->directions) {
+        printf("[FlowField] ERROR: Failed to allocate %dx%d field\n", width, height);
+        field_free(ff);
+        return false;
+    }
+    ff->width = width;
+    ff->height = height;
+    return true;
+}
+
+// Dijkstra dal goal su tutta la griglia del livello
+static void field_build(FlowField* ff, int goal_x, int goal_z) {
+    int width = ff->width;
+    int height = ff->height;
+    int cell_count = width * height;
+
+    for (int i = 0; i < cell_count; i++) ff->integration[i] = FLT_MAX;
+    memset(ff->directions, FLOWFIELD_DIR_NONE, cell_count);
+
+    int goal_idx = goal_z * width + goal_x;
+    ff->goal_x = goal_x;
+    ff->goal_z = goal_z;
+    ff->integration[goal_idx] = 0.0f;
+    ff->directions[goal_idx] = FLOWFIELD_DIR_GOAL;
+
+    g_heap_size = 0;
+    heap_push(0.0f, goal_idx);
+
+    while (g_heap_size > 0) {
+        FlowHeapEntry entry = heap_pop();
+        if (entry.cost > ff->integration[entry.cell]) continue; // Entry obsoleta
+
+        int cx = entry.cell % width;
+        int cz = entry.cell / width;
+
+        for (int i = 0; i < 8; i++) {
+            int nx = cx + ff_dx[i];
+            int nz = cz + ff_dz[i];
+            if (nx < 0 || nx >= width || nz < 0 || nz >= height) continue;
+
+            int n_idx = nz * width + nx;
+            if (g_walk[n_idx] == 0) continue;
+
+            float new_cost = entry.cost + ff_costs[i];
+            if (new_cost >= ff->integration[n_idx]) continue;
+
+            ff->integration[n_idx] = new_cost;
+            // Dal vicino si torna verso la cella corrente: direzione opposta
+            ff->directions[n_idx] = ff_opposite[i];
+
+            if (!heap_push(new_cost, n_idx)) {
+                printf("[FlowField] ERROR: Heap allocation failed\n");
+                return;
+            }
+        }
+    }
+}
+
+// Calcola (o ricalcola sul posto) il campo di uno slot verso goal con la
+// walkability attuale del livello
+static bool field_rebuild(FlowField* ff, struct Level* lvl, int goal_x, int goal_z) {
+    double t_start = get_time_ms();
+
+    int width = pathfinding_level_cells_x(lvl);
+    int height = pathfinding_level_cells_z(lvl);
+    int cell_count = width * height;
+    if (g_walk_cells != cell_count) {
+        free(g_walk);
+        g_walk = (uint8_t*)malloc(cell_count);
+        g_walk_cells = g_walk ? cell_count : 0;
+        if (!g_walk) return false;
+    }
+    pathfinding_level_copy_walkability(lvl, g_walk);
+
+    if (!field_alloc(ff, width, height)) return false;
+    field_build(ff, goal_x, goal_z);
+    ff->dirty = false;
+
+    float elapsed = (float)(get_time_ms() - t_start);
+    g_ff_stats.builds++;
+    g_ff_stats.total_build_ms += elapsed;
+    if (elapsed > g_ff_stats.max_build_ms) g_ff_stats.max_build_ms = elapsed;
+    return true;
+}
+
+static FlowFieldHandle make_handle(int index, uint16_t generation) {
+    return ((uint32_t)generation << 16) | (uint32_t)(index + 1);
+}
+
+// Slot di un handle ancora valido per lvl, ricalcolato se la walkability è
+// cambiata dopo il build. NULL se l'handle è scaduto.
+static FlowField* resolve_handle(FlowFieldHandle handle, struct Level* lvl) {
+    if (handle == FLOWFIELD_INVALID_HANDLE || !lvl || lvl != g_fields_level) return NULL;
+
+    int index = (int)(handle & 0xFFFF) - 1;
+    if (index < 0 || index >= FLOWFIELD_CACHE_SIZE) return NULL;
+
+    FlowField* ff = &g_fields[index];
+    if (!ff->integration || ff->generation != (uint16_t)(handle >> 16)) return NULL;
+
+    if (ff->dirty && !field_rebuild(ff, lvl, ff->goal_x, ff->goal_z)) {
+        ff->generation++;
+        field_free(ff);
+        return NULL;
+    }
+    return ff;
+}
+
+// La walkability è cambiata: tutti i campi del livello sono obsoleti. Restano
+// negli slot (stesso goal, stessa generazione) e vengono ricalcolati al
+// prossimo accesso, così gli handle in mano agli agenti restano validi.
+static void on_walkability_changed(struct Level* lvl, int x0, int z0, int x1, int z1, void* user) {
+    (void)x0; (void)z0; (void)x1; (void)z1; (void)user;
+    if (lvl != g_fields_level) return;
+
+    for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++) {
+        if (g_fields[i].integration) g_fields[i].dirty = true;
+    }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+FlowFieldHandle flowfield_request_cell(struct Level* lvl, int goal_x, int goal_z) {
+    if (!lvl || !lvl->chunks) return FLOWFIELD_INVALID_HANDLE;
+
+    int width = pathfinding_level_cells_x(lvl);
+    int height = pathfinding_level_cells_z(lvl);
+    if (goal_x < 0 || goal_x >= width || goal_z < 0 || goal_z >= height) return FLOWFIELD_INVALID_HANDLE;
+
+    if (!g_listener_registered) {
+        g_listener_registered = pathfinding_add_change_listener(on_walkability_changed, NULL);
+    }
+    pathfinding_flush_changes();
+
+    // Cambio livello: tutta la cache è obsoleta
+    if (g_fields_level != lvl) {
+        flowfield_cache_clear();
+        g_fields_level = lvl;
+    }
+
+    g_ff_stats.requests++;
+    g_use_counter++;
+
+    // 1. Cerca in cache (un campo obsoleto viene ricalcolato nello stesso slot)
+    for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++) {
+        FlowField* ff = &g_fields[i];
+        if (ff->integration && ff->goal_x == goal_x && ff->goal_z == goal_z) {
+            FlowFieldHandle handle = make_handle(i, ff->generation);
+            ff->last_used = g_use_counter;
+            if (!ff->dirty) g_ff_stats.hits++;
+            return resolve_handle(handle, lvl) ? handle : FLOWFIELD_INVALID_HANDLE;
+        }
+    }
+
+    // Slot da usare: il primo vuoto, altrimenti il meno usato di recente
+    int victim = 0;
+    for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++) {
+        FlowField* ff = &g_fields[i];
+        if (!ff->integration) {
+            victim = i;
+            break;
+        }
+        if (ff->last_used < g_fields[victim].last_used) victim = i;
+    }
+
+    // 2. Miss: lo slot LRU cambia goal, gli handle del goal espulso scadono
+    FlowField* ff = &g_fields[victim];
+    ff->generation++;
+    if (!field_rebuild(ff, lvl, goal_x, goal_z)) {
+        field_free(ff);
+        return FLOWFIELD_INVALID_HANDLE;
+    }
+    ff->last_used = g_use_counter;
+
+    return make_handle(victim, ff->generation);
+}
+
+FlowFieldHandle flowfield_request(struct Level* lvl, vec3 goal) {
+    if (!lvl) return FLOWFIELD_INVALID_HANDLE;
+
+    int goal_x, goal_z;
+    if (!pathfinding_level_world_to_cell(lvl, goal, &goal_x, &goal_z)) {
+        printf("[FlowField] Goal position outside level (%.2f, %.2f)\n", goal[0], goal[2]);
+        return FLOWFIELD_INVALID_HANDLE;
+    }
+    return flowfield_request_cell(lvl, goal_x, goal_z);
+}
+
+const FlowField* flowfield_get(FlowFieldHandle handle, struct Level* lvl) {
+    return resolve_handle(handle, lvl);
+}
+
+bool flowfield_get_direction(FlowFieldHandle handle, struct Level* lvl, vec3 pos, vec3 out_dir) {
+    glm_vec3_zero(out_dir);
+    FlowField* ff = resolve_handle(handle, lvl);
+    if (!ff) return false;
+
+    int cx, cz;
+    if (!pathfinding_level_world_to_cell(lvl, pos, &cx, &cz)) return false;
+
+    uint8_t dir = ff->directions[cz * ff->width + cx];
+    if (dir == FLOWFIELD_DIR_NONE) return false;
+    if (dir == FLOWFIELD_DIR_GOAL) return true;
+
+    out_dir[0] = (float)ff_dx[dir];
+    out_dir[2] = (float)ff_dz[dir];
+    if (ff_dx[dir] != 0 && ff_dz[dir] != 0) {
+        out_dir[0] *= 0.70710678f;
+        out_dir[2] *= 0.70710678f;
+    }
+    return true;
+}
+
+float flowfield_get_distance(FlowFieldHandle handle, struct Level* lvl, vec3 pos) {
+    FlowField* ff = resolve_handle(handle, lvl);
+    if (!ff) return -1.0f;
+
+    int cx, cz;
+    if (!pathfinding_level_world_to_cell(lvl, pos, &cx, &cz)) return -1.0f;
+
+    float cost = ff->integration[cz * ff->width + cx];
+    if (cost == FLT_MAX) return -1.0f;
+
+    return cost * pathfinding_level_cell_size(lvl);
+}
+
+void flowfield_cache_clear(void) {
+    for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++) {
+        if (g_fields[i].integration) g_fields[i].generation++;
+        field_free(&g_fields[i]);
+    }
+    g_fields_level = NULL;
+}
+
+void flowfield_print_stats(void) {
+    printf("[FlowField] Stats:\n");
+    printf("  Requests: %d\n", g_ff_stats.requests);
+    printf("  Cache hits: %d\n", g_ff_stats.hits);
+    printf("  Builds: %d\n", g_ff_stats.builds);
+    printf("  Avg build time: %.2fms\n", g_ff_stats.builds > 0 ?
+           g_ff_stats.total_build_ms / g_ff_stats.builds : 0.0f);
+    printf("  Max build time: %.2fms\n", g_ff_stats.max_build_ms);
+}
@@ -0,0 +1,80 @@
+#ifndef PATHFINDING_FLOWFIELD_H
+#define PATHFINDING_FLOWFIELD_H
+
+/*
+ * FLOW FIELD
+ * ==========
+ *
+ * Per molti agenti con lo stesso goal (es. "tutte le creature attaccano
+ * quella torre") una sola ricerca Dijkstra dal goal su tutto il livello
+ * produce:
+ * - integration field: costo minimo di ogni cella verso il goal
+ * - direction field: la mossa (8 direzioni) da fare in ogni cella
+ *
+ * Ogni agente poi legge la sua direzione in O(1). I campi sono in cache
+ * (LRU) con chiave la cella goal; il chiamante tiene un handle generazionale,
+ * non un puntatore allo slot.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+#define FLOWFIELD_CACHE_SIZE 8     // Goal diversi mantenuti in cache
+
+#define FLOWFIELD_DIR_NONE 0xFF    // Cella bloccata o irraggiungibile
+#define FLOWFIELD_DIR_GOAL 0xFE    // Cella goal (arrivati)
+
+typedef struct FlowField {
+    int goal_x, goal_z;        // Cella goal (coordinate globali del livello)
+    int width, height;         // Dimensioni in celle (tutto il livello)
+
+    float* integration;        // Costo verso il goal in celle (FLT_MAX = irraggiungibile)
+    uint8_t* directions;       // Indice direzione 0-7 o FLOWFIELD_DIR_*
+
+    unsigned int last_used;    // Contatore LRU
+    uint16_t generation;       // Incrementata quando lo slot cambia goal (invalida gli handle vecchi)
+    bool dirty;                // Walkability cambiata: ricalcolato al prossimo accesso
+} FlowField;
+
+// Handle opaco: indice slot + generazione (0 = handle non valido)
+typedef uint32_t FlowFieldHandle;
+#define FLOWFIELD_INVALID_HANDLE 0
+
+// Ritorna l'handle del flow field verso goal (calcolato o preso dalla cache).
+// Il goal può essere una cella bloccata (es. struttura da attaccare):
+// le celle adiacenti puntano verso di essa.
+// L'handle resta valido finché il campo non viene espulso dalla cache
+// (richiesta di un goal nuovo con cache piena), fino al cambio livello o a
+// flowfield_cache_clear: poi le letture falliscono invece di leggere il campo
+// di un altro goal. Le modifiche di walkability non lo invalidano: il campo
+// viene ricalcolato sul posto, per lo stesso goal, al primo accesso.
+// FLOWFIELD_INVALID_HANDLE se il goal è fuori dal livello.
+FlowFieldHandle flowfield_request(struct Level* lvl, vec3 goal);
+FlowFieldHandle flowfield_request_cell(struct Level* lvl, int goal_x, int goal_z);
+
+// Campo di un handle (aggiornato se la walkability è cambiata), NULL se
+// l'handle non è più valido. Il puntatore vale fino alla prossima chiamata
+// al modulo: non va conservato tra un frame e l'altro
+const FlowField* flowfield_get(FlowFieldHandle handle, struct Level* lvl);
+
+// Direzione di movimento (XZ normalizzata) per un agente in pos.
+// Ritorna false se l'handle non è valido, se pos è fuori livello, bloccata
+// o irraggiungibile. All'arrivo nella cella goal out_dir è zero e ritorna true.
+bool flowfield_get_direction(FlowFieldHandle handle, struct Level* lvl, vec3 pos, vec3 out_dir);
+
+// Distanza residua in metri verso il goal (-1 se irraggiungibile o handle non valido)
+float flowfield_get_distance(FlowFieldHandle handle, struct Level* lvl, vec3 pos);
+
+// Libera tutti i campi e invalida gli handle (da chiamare al cambio livello;
+// le modifiche fatte con pathfinding_set_cells_walkable ricalcolano i campi
+// automaticamente)
+void flowfield_cache_clear(void);
+
+// Statistiche cache (richieste, hit, build)
+void flowfield_print_stats(void);
+
+#endif // PATHFINDING_FLOWFIELD_H
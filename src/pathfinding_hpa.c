@@ -0,0 +1,861 @@
+#include "pathfinding_hpa.h"
+#include "pathfinding_internal.h"
+#include "pathfinding_landmarks.h"
+#include "level.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+// Ingressi più corti di questa soglia: una transizione al centro.
+// Più lunghi: una transizione per estremo (come nel paper HPA*)
+#define HPA_ENTRANCE_SPLIT_LENGTH 6
+
+// Celle di bordo indicizzate per cluster (vedi border_slot)
+#define HPA_BORDER_SLOTS (4 * PATHGRID_SIZE)
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+typedef struct {
+    int from, to;
+    float cost;
+    bool inter;
+} HpaBuildEdge;
+
+typedef struct {
+    struct Level* lvl;
+
+    HpaNode* nodes;
+    int node_count;
+    int node_capacity;
+
+    HpaBuildEdge* edges;
+    int edge_count;
+    int edge_capacity;
+
+    // Nodo di ogni cella di bordo (HPA_BORDER_SLOTS per cluster), -1 = nessuno
+    int* node_index;
+
+    HpaTransition* transitions;
+    int transition_count;
+    int transition_capacity;
+    int* border_start;
+
+    PathfindingContext* ctx;
+
+    // Aggiornamento incrementale: bordi e archi intra dei cluster non
+    // modificati copiati dal grafo precedente
+    HpaGraph* old_graph;
+    const bool* dirty_clusters;
+} HpaBuilder;
+
+static bool cell_walkable(HpaBuilder* b, int x, int z) {
+    return pathfinding_level_cell_walkable(b->lvl, x, z);
+}
+
+static int cell_cluster(struct Level* lvl, int x, int z) {
+    return (z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE);
+}
+
+// Posizione di una cella di bordo nell'indice dei nodi del suo cluster
+// (gli ingressi stanno sempre sul bordo del chunk)
+static int border_slot(int x, int z) {
+    int lx = x % PATHGRID_SIZE;
+    int lz = z % PATHGRID_SIZE;
+    if (lz == 0) return lx;
+    if (lz == PATHGRID_SIZE - 1) return PATHGRID_SIZE + lx;
+    if (lx == 0) return 2 * PATHGRID_SIZE + lz;
+    return 3 * PATHGRID_SIZE + lz;
+}
+
+// Ritorna il nodo della cella (creandolo se non esiste), -1 se errore
+static int builder_add_node(HpaBuilder* b, int x, int z) {
+    int cluster = cell_cluster(b->lvl, x, z);
+
+    int* slot = &b->node_index[cluster * HPA_BORDER_SLOTS + border_slot(x, z)];
+    if (*slot >= 0) return *slot;
+
+    if (b->node_count >= b->node_capacity) {
+        int new_capacity = b->node_capacity > 0 ? b->node_capacity * 2 : 256;
+        HpaNode* new_nodes = (HpaNode*)realloc(b->nodes, new_capacity * sizeof(HpaNode));
+        if (!new_nodes) return -1;
+        b->nodes = new_nodes;
+        b->node_capacity = new_capacity;
+    }
+
+    HpaNode* n = &b->nodes[b->node_count];
+    n->cell_x = x;
+    n->cell_z = z;
+    n->cluster = cluster;
+    n->edge_start = 0;
+    n->edge_count = 0;
+    *slot = b->node_count;
+    return b->node_count++;
+}
+
+static bool builder_add_edge(HpaBuilder* b, int from, int to, float cost, bool inter) {
+    if (b->edge_count >= b->edge_capacity) {
+        int new_capacity = b->edge_capacity > 0 ? b->edge_capacity * 2 : 1024;
+        HpaBuildEdge* new_edges = (HpaBuildEdge*)realloc(b->edges, new_capacity * sizeof(HpaBuildEdge));
+        if (!new_edges) return false;
+        b->edges = new_edges;
+        b->edge_capacity = new_capacity;
+    }
+
+    HpaBuildEdge* e = &b->edges[b->edge_count++];
+    e->from = from;
+    e->to = to;
+    e->cost = cost;
+    e->inter = inter;
+    return true;
+}
+
+// Coppia di celle adiacenti ai due lati di un bordo
+static bool builder_add_transition(HpaBuilder* b, int ax, int az, int bx, int bz, float cost) {
+    if (b->transition_count >= b->transition_capacity) {
+        int new_capacity = b->transition_capacity > 0 ? b->transition_capacity * 2 : 256;
+        HpaTransition* new_transitions =
+            (HpaTransition*)realloc(b->transitions, new_capacity * sizeof(HpaTransition));
+        if (!new_transitions) return false;
+        b->transitions = new_transitions;
+        b->transition_capacity = new_capacity;
+    }
+    HpaTransition* t = &b->transitions[b->transition_count++];
+    t->ax = ax;
+    t->az = az;
+    t->bx = bx;
+    t->bz = bz;
+    t->cost = cost;
+
+    int na = builder_add_node(b, ax, az);
+    int nb = builder_add_node(b, bx, bz);
+    if (na < 0 || nb < 0) return false;
+
+    return builder_add_edge(b, na, nb, cost, true) &&
+           builder_add_edge(b, nb, na, cost, true);
+}
+
+// Bordo tra due chunk: (x0,z0) è la prima cella lato A, (ox,oz) l'offset verso
+// il lato B, (sx,sz) il passo lungo il bordo
+static bool builder_scan_border(HpaBuilder* b, int x0, int z0, int ox, int oz, int sx, int sz) {
+    int run_start = -1;
+
+    for (int i = 0; i <= PATHGRID_SIZE; i++) {
+        int ax = x0 + sx * i, az = z0 + sz * i;
+        bool open = i < PATHGRID_SIZE &&
+                    cell_walkable(b, ax, az) && cell_walkable(b, ax + ox, az + oz);
+
+        if (open && run_start < 0) {
+            run_start = i;
+        } else if (!open && run_start >= 0) {
+            // Ingresso massimale [run_start, i-1]
+            int run_end = i - 1;
+            int length = run_end - run_start + 1;
+
+            if (length < HPA_ENTRANCE_SPLIT_LENGTH) {
+                int mid = run_start + length / 2;
+                int mx = x0 + sx * mid, mz = z0 + sz * mid;
+                if (!builder_add_transition(b, mx, mz, mx + ox, mz + oz, 1.0f)) return false;
+            } else {
+                int ex = x0 + sx * run_start, ez = z0 + sz * run_start;
+                if (!builder_add_transition(b, ex, ez, ex + ox, ez + oz, 1.0f)) return false;
+                ex = x0 + sx * run_end;
+                ez = z0 + sz * run_end;
+                if (!builder_add_transition(b, ex, ez, ex + ox, ez + oz, 1.0f)) return false;
+            }
+            run_start = -1;
+        }
+    }
+
+    // Passaggi solo in diagonale (l'A* a griglia permette il taglio degli angoli).
+    // Se una delle due celle ortogonali è libera il passaggio è già coperto
+    // dall'ingresso dritto adiacente.
+    for (int i = 0; i < PATHGRID_SIZE - 1; i++) {
+        int ax = x0 + sx * i, az = z0 + sz * i;
+        int cx = ax + sx, cz = az + sz;      // Cella successiva lungo il bordo, lato A
+
+        bool a0 = cell_walkable(b, ax, az);
+        bool a1 = cell_walkable(b, cx, cz);
+        bool b0 = cell_walkable(b, ax + ox, az + oz);
+        bool b1 = cell_walkable(b, cx + ox, cz + oz);
+
+        if (a0 && b1 && !a1 && !b0) {
+            if (!builder_add_transition(b, ax, az, cx + ox, cz + oz, 1.414f)) return false;
+        }
+        if (a1 && b0 && !a0 && !b1) {
+            if (!builder_add_transition(b, cx, cz, ax + ox, az + oz, 1.414f)) return false;
+        }
+    }
+
+    return true;
+}
+
+// Angolo comune a quattro chunk: (x,z) è l'ultima cella del chunk in basso a sinistra
+static bool builder_scan_corner(HpaBuilder* b, int x, int z) {
+    bool c00 = cell_walkable(b, x, z);
+    bool c10 = cell_walkable(b, x + 1, z);
+    bool c01 = cell_walkable(b, x, z + 1);
+    bool c11 = cell_walkable(b, x + 1, z + 1);
+
+    if (c00 && c11 && !c10 && !c01) {
+        if (!builder_add_transition(b, x, z, x + 1, z + 1, 1.414f)) return false;
+    }
+    if (c10 && c01 && !c00 && !c11) {
+        if (!builder_add_transition(b, x + 1, z, x, z + 1, 1.414f)) return false;
+    }
+    return true;
+}
+
+// true se il bordo (che legge i chunk [cx, cx+nx) x [cz, cz+nz)) va
+// riscansionato: build completo o almeno un chunk modificato
+static bool builder_border_dirty(HpaBuilder* b, int cx, int cz, int nx, int nz) {
+    if (!b->old_graph || !b->dirty_clusters) return true;
+    for (int z = cz; z < cz + nz; z++) {
+        for (int x = cx; x < cx + nx; x++) {
+            if (b->dirty_clusters[z * b->lvl->chunksCountX + x]) return true;
+        }
+    }
+    return false;
+}
+
+// Ripete le transizioni di un bordo non modificato dal grafo precedente
+static bool builder_replay_border(HpaBuilder* b, int border) {
+    HpaGraph* old = b->old_graph;
+    for (int i = old->border_start[border]; i < old->border_start[border + 1]; i++) {
+        HpaTransition* t = &old->transitions[i];
+        if (!builder_add_transition(b, t->ax, t->az, t->bx, t->bz, t->cost)) return false;
+    }
+    return true;
+}
+
+// Copia gli archi intra del cluster dal grafo precedente se il cluster non è
+// stato modificato e ha gli stessi ingressi. Ritorna false se va ricalcolato.
+static bool builder_reuse_intra_edges(HpaBuilder* b, HpaGraph* graph, int cluster) {
+    HpaGraph* old = b->old_graph;
+    if (!old || !b->dirty_clusters || b->dirty_clusters[cluster]) return false;
+
+    int first = graph->cluster_start[cluster];
+    int count = graph->cluster_start[cluster + 1] - first;
+    int old_first = old->cluster_start[cluster];
+    int old_count = old->cluster_start[cluster + 1] - old_first;
+    if (count != old_count) return false;
+
+    for (int i = 0; i < count; i++) {
+        HpaNode* n = &b->nodes[graph->cluster_nodes[first + i]];
+        HpaNode* o = &old->nodes[old->cluster_nodes[old_first + i]];
+        if (n->cell_x != o->cell_x || n->cell_z != o->cell_z) return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        HpaNode* o = &old->nodes[old->cluster_nodes[old_first + i]];
+        for (int e = 0; e < o->edge_count; e++) {
+            HpaEdge* edge = &old->edges[o->edge_start + e];
+            if (edge->inter) continue;
+
+            for (int j = 0; j < count; j++) {
+                if (old->cluster_nodes[old_first + j] != edge->to) continue;
+                if (!builder_add_edge(b, graph->cluster_nodes[first + i],
+                                      graph->cluster_nodes[first + j], edge->cost, false)) {
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// Archi intra-cluster: Dijkstra da ogni ingresso sul pathgrid del chunk
+static bool builder_add_intra_edges(HpaBuilder* b, HpaGraph* graph) {
+    struct Level* lvl = b->lvl;
+
+    int max_nodes = 0;
+    for (int c = 0; c < graph->cluster_count; c++) {
+        int count = graph->cluster_start[c + 1] - graph->cluster_start[c];
+        if (count > max_nodes) max_nodes = count;
+    }
+
+    int* target_x = (int*)malloc((max_nodes + 1) * sizeof(int));
+    int* target_z = (int*)malloc((max_nodes + 1) * sizeof(int));
+    float* costs = (float*)malloc((max_nodes + 1) * sizeof(float));
+    bool ok = target_x && target_z && costs;
+
+    for (int c = 0; ok && c < graph->cluster_count; c++) {
+        int first = graph->cluster_start[c];
+        int count = graph->cluster_start[c + 1] - first;
+        if (count < 2) continue;
+
+        if (builder_reuse_intra_edges(b, graph, c)) continue;
+
+        if (!b->ctx) {
+            b->ctx = pathfinding_context_create();
+            if (!b->ctx) {
+                ok = false;
+                break;
+            }
+        }
+        PathfindingContext* ctx = b->ctx;
+
+        int chunkX = c % lvl->chunksCountX;
+        int chunkZ = c / lvl->chunksCountX;
+        if (!pathfinding_ctx_setup_window(ctx, lvl, chunkX, chunkZ, 1, 1)) continue;
+
+        for (int i = 0; i < count; i++) {
+            HpaNode* n = &b->nodes[graph->cluster_nodes[first + i]];
+            target_x[i] = n->cell_x;
+            target_z[i] = n->cell_z;
+        }
+
+        for (int i = 0; ok && i < count; i++) {
+            pathfinding_ctx_cell_costs(ctx, target_x[i], target_z[i], target_x, target_z, count, costs);
+
+            for (int j = 0; j < count; j++) {
+                if (j == i || costs[j] == FLT_MAX) continue;
+                ok = builder_add_edge(b, graph->cluster_nodes[first + i],
+                                      graph->cluster_nodes[first + j], costs[j], false);
+                if (!ok) break;
+            }
+        }
+    }
+
+    free(target_x);
+    free(target_z);
+    free(costs);
+    return ok;
+}
+
+static void graph_free(HpaGraph* graph) {
+    if (!graph) return;
+    free(graph->nodes);
+    free(graph->edges);
+    free(graph->cluster_start);
+    free(graph->cluster_nodes);
+    free(graph->transitions);
+    free(graph->border_start);
+    pathfinding_context_destroy(graph->build_ctx);
+    free(graph);
+}
+
+// Raggruppa i nodi per cluster (counting sort)
+static bool graph_build_clusters(HpaGraph* graph, HpaNode* nodes, int node_count, int cluster_count) {
+    graph->cluster_count = cluster_count;
+    graph->cluster_start = (int*)calloc(cluster_count + 1, sizeof(int));
+    graph->cluster_nodes = (int*)malloc((node_count > 0 ? node_count : 1) * sizeof(int));
+    if (!graph->cluster_start || !graph->cluster_nodes) return false;
+
+    for (int i = 0; i < node_count; i++) graph->cluster_start[nodes[i].cluster + 1]++;
+    for (int c = 0; c < cluster_count; c++) graph->cluster_start[c + 1] += graph->cluster_start[c];
+
+    int* fill = (int*)malloc(cluster_count * sizeof(int));
+    if (!fill) return false;
+    memcpy(fill, graph->cluster_start, cluster_count * sizeof(int));
+    for (int i = 0; i < node_count; i++) graph->cluster_nodes[fill[nodes[i].cluster]++] = i;
+    free(fill);
+
+    return true;
+}
+
+// Archi in formato compatto: quelli del nodo n sono edges[edge_start .. +edge_count)
+static bool graph_build_edges(HpaGraph* graph, HpaBuilder* b) {
+    graph->edge_count = b->edge_count;
+    graph->edges = (HpaEdge*)malloc((b->edge_count > 0 ? b->edge_count : 1) * sizeof(HpaEdge));
+    if (!graph->edges) return false;
+
+    for (int i = 0; i < b->node_count; i++) b->nodes[i].edge_count = 0;
+    for (int e = 0; e < b->edge_count; e++) b->nodes[b->edges[e].from].edge_count++;
+
+    int offset = 0;
+    for (int i = 0; i < b->node_count; i++) {
+        b->nodes[i].edge_start = offset;
+        offset += b->nodes[i].edge_count;
+        b->nodes[i].edge_count = 0;
+    }
+
+    for (int e = 0; e < b->edge_count; e++) {
+        HpaNode* n = &b->nodes[b->edges[e].from];
+        HpaEdge* dst = &graph->edges[n->edge_start + n->edge_count++];
+        dst->to = b->edges[e].to;
+        dst->cost = b->edges[e].cost;
+        dst->inter = b->edges[e].inter;
+    }
+
+    return true;
+}
+
+// Costruisce un nuovo grafo. Con old_graph/dirty_clusters riusa i bordi e
+// gli archi intra dei cluster non modificati; il contesto dei Dijkstra passa
+// dal grafo precedente al nuovo.
+static HpaGraph* build_graph(struct Level* lvl, HpaGraph* old_graph, const bool* dirty_clusters) {
+    HpaBuilder b;
+    memset(&b, 0, sizeof(b));
+    b.lvl = lvl;
+    b.old_graph = old_graph;
+    b.dirty_clusters = dirty_clusters;
+    b.ctx = old_graph ? old_graph->build_ctx : NULL;
+
+    b.node_index = (int*)malloc((size_t)lvl->totalChunks * HPA_BORDER_SLOTS * sizeof(int));
+    b.border_start = (int*)malloc((3 * lvl->totalChunks + 1) * sizeof(int));
+    bool ok = b.node_index && b.border_start;
+    if (ok) memset(b.node_index, 0xFF, (size_t)lvl->totalChunks * HPA_BORDER_SLOTS * sizeof(int));
+
+    // 1. Ingressi sui bordi tra chunk adiacenti: est, nord e angolo di ogni chunk
+    for (int cz = 0; ok && cz < lvl->chunksCountZ; cz++) {
+        for (int cx = 0; ok && cx < lvl->chunksCountX; cx++) {
+            int border = 3 * (cz * lvl->chunksCountX + cx);
+            int x0 = cx * PATHGRID_SIZE;
+            int z0 = cz * PATHGRID_SIZE;
+
+            b.border_start[border] = b.transition_count;
+            if (cx + 1 < lvl->chunksCountX) {
+                ok = builder_border_dirty(&b, cx, cz, 2, 1)
+                         ? builder_scan_border(&b, x0 + PATHGRID_SIZE - 1, z0, 1, 0, 0, 1)
+                         : builder_replay_border(&b, border);
+            }
+            b.border_start[border + 1] = b.transition_count;
+            if (ok && cz + 1 < lvl->chunksCountZ) {
+                ok = builder_border_dirty(&b, cx, cz, 1, 2)
+                         ? builder_scan_border(&b, x0, z0 + PATHGRID_SIZE - 1, 0, 1, 1, 0)
+                         : builder_replay_border(&b, border + 1);
+            }
+            b.border_start[border + 2] = b.transition_count;
+            if (ok && cx + 1 < lvl->chunksCountX && cz + 1 < lvl->chunksCountZ) {
+                ok = builder_border_dirty(&b, cx, cz, 2, 2)
+                         ? builder_scan_corner(&b, x0 + PATHGRID_SIZE - 1, z0 + PATHGRID_SIZE - 1)
+                         : builder_replay_border(&b, border + 2);
+            }
+        }
+    }
+    if (ok) b.border_start[3 * lvl->totalChunks] = b.transition_count;
+
+    HpaGraph* graph = (HpaGraph*)calloc(1, sizeof(HpaGraph));
+    ok = ok && graph;
+
+    // 2. Nodi per cluster, 3. archi intra-cluster, 4. formato compatto
+    ok = ok && graph_build_clusters(graph, b.nodes, b.node_count, lvl->totalChunks);
+    ok = ok && builder_add_intra_edges(&b, graph);
+    ok = ok && graph_build_edges(graph, &b);
+
+    free(b.edges);
+    free(b.node_index);
+
+    if (!ok) {
+        printf("[HPA] ERROR: Failed to build abstract graph\n");
+        free(b.nodes);
+        free(b.transitions);
+        free(b.border_start);
+        if (!old_graph || b.ctx != old_graph->build_ctx) pathfinding_context_destroy(b.ctx);
+        graph_free(graph);
+        return NULL;
+    }
+
+    graph->nodes = b.nodes;
+    graph->node_count = b.node_count;
+    graph->transitions = b.transitions;
+    graph->border_start = b.border_start;
+    graph->build_ctx = b.ctx;
+    if (old_graph) old_graph->build_ctx = NULL;
+    return graph;
+}
+
+// Listener delle modifiche di walkability: aggiorna il grafo del livello
+static void on_walkability_changed(struct Level* lvl, int x0, int z0, int x1, int z1, void* user) {
+    (void)user;
+    hpa_update_region(lvl, x0, z0, x1, z1);
+}
+
+bool hpa_build(struct Level* lvl) {
+    if (!lvl || !lvl->chunks) return false;
+
+    static bool listener_registered = false;
+    if (!listener_registered) {
+        listener_registered = pathfinding_add_change_listener(on_walkability_changed, NULL);
+    }
+
+    hpa_destroy(lvl);
+
+    double t_start = get_time_ms();
+
+    HpaGraph* graph = build_graph(lvl, NULL, NULL);
+    if (!graph) return false;
+    lvl->hpaGraph = graph;
+
+    printf("[HPA] Built abstract graph: %d nodes, %d edges, %d clusters (%.2fms)\n",
+           graph->node_count, graph->edge_count, graph->cluster_count,
+           (float)(get_time_ms() - t_start));
+    return true;
+}
+
+bool hpa_update_region(struct Level* lvl, int x0, int z0, int x1, int z1) {
+    if (!lvl || !lvl->hpaGraph) return false;
+
+    bool* dirty = (bool*)calloc(lvl->totalChunks, sizeof(bool));
+    if (!dirty) return false;
+
+    // Solo i cluster che contengono celle modificate hanno costi intra diversi;
+    // i vicini con ingressi cambiati vengono ricalcolati comunque (confronto nodi)
+    for (int cz = z0 / PATHGRID_SIZE; cz <= z1 / PATHGRID_SIZE && cz < lvl->chunksCountZ; cz++) {
+        for (int cx = x0 / PATHGRID_SIZE; cx <= x1 / PATHGRID_SIZE && cx < lvl->chunksCountX; cx++) {
+            dirty[cz * lvl->chunksCountX + cx] = true;
+        }
+    }
+
+    HpaGraph* graph = build_graph(lvl, lvl->hpaGraph, dirty);
+    free(dirty);
+    if (!graph) return false;
+
+    graph_free(lvl->hpaGraph);
+    lvl->hpaGraph = graph;
+    return true;
+}
+
+void hpa_destroy(struct Level* lvl) {
+    if (!lvl) return;
+    graph_free(lvl->hpaGraph);
+    lvl->hpaGraph = NULL;
+}
+
+// ============================================================================
+// QUERY
+// ============================================================================
+
+typedef struct {
+    float f;
+    int node;
+} HpaHeapEntry;
+
+typedef struct {
+    HpaHeapEntry* entries;
+    int size;
+    int capacity;
+} HpaHeap;
+
+static bool hpa_heap_push(HpaHeap* heap, float f, int node) {
+    if (heap->size >= heap->capacity) {
+        int new_capacity = heap->capacity > 0 ? heap->capacity * 2 : 256;
+        HpaHeapEntry* new_entries = (HpaHeapEntry*)realloc(heap->entries, new_capacity * sizeof(HpaHeapEntry));
+        if (!new_entries) return false;
+        heap->entries = new_entries;
+        heap->capacity = new_capacity;
+    }
+
+    int index = heap->size++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap->entries[parent].f <= f) break;
+        heap->entries[index] = heap->entries[parent];
+        index = parent;
+    }
+    heap->entries[index].f = f;
+    heap->entries[index].node = node;
+    return true;
+}
+
+static HpaHeapEntry hpa_heap_pop(HpaHeap* heap) {
+    HpaHeapEntry top = heap->entries[0];
+    HpaHeapEntry last = heap->entries[--heap->size];
+
+    int index = 0;
+    while (true) {
+        int left = 2 * index + 1;
+        if (left >= heap->size) break;
+        int right = left + 1;
+        int smallest = (right < heap->size && heap->entries[right].f < heap->entries[left].f) ? right : left;
+        if (heap->entries[smallest].f >= last.f) break;
+        heap->entries[index] = heap->entries[smallest];
+        index = smallest;
+    }
+    if (heap->size > 0) heap->entries[index] = last;
+
+    return top;
+}
+
+// Euclidea, alzata dal limite dei landmark se il livello li ha (gli archi
+// astratti costano quanto il path a griglia, mai meno)
+static float hpa_heuristic(struct Level* lvl, int x1, int z1, int x2, int z2) {
+    int dx = x2 - x1;
+    int dz = z2 - z1;
+    float h = sqrtf((float)(dx * dx + dz * dz));
+    float alt = landmarks_lower_bound(lvl, x1, z1, x2, z2);
+    return alt > h ? alt : h;
+}
+
+// Costi dalla cella (x,z) verso tutti gli ingressi del suo cluster
+static void cluster_costs(PathfindingContext* ctx, struct Level* lvl, HpaGraph* graph,
+                          int cluster, int x, int z, float* out_costs) {
+    int first = graph->cluster_start[cluster];
+    int count = graph->cluster_start[cluster + 1] - first;
+
+    int* target_x = (int*)malloc((count + 1) * sizeof(int));
+    int* target_z = (int*)malloc((count + 1) * sizeof(int));
+    if (!target_x || !target_z) {
+        for (int i = 0; i < count; i++) out_costs[i] = FLT_MAX;
+        free(target_x);
+        free(target_z);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        HpaNode* n = &graph->nodes[graph->cluster_nodes[first + i]];
+        target_x[i] = n->cell_x;
+        target_z[i] = n->cell_z;
+    }
+
+    pathfinding_ctx_setup_window(ctx, lvl, cluster % lvl->chunksCountX, cluster / lvl->chunksCountX, 1, 1);
+    pathfinding_ctx_cell_costs(ctx, x, z, target_x, target_z, count, out_costs);
+
+    free(target_x);
+    free(target_z);
+}
+
+// Aggiunge il tratto raffinato tra due celle dello stesso cluster
+static bool append_refined(PathfindingContext* ctx, struct Level* lvl, Path* path, PathSearchMode mode,
+                           int cluster, int ax, int az, int bx, int bz) {
+    pathfinding_ctx_setup_window(ctx, lvl, cluster % lvl->chunksCountX, cluster / lvl->chunksCountX, 1, 1);
+
+    Path* segment = pathfinding_ctx_search_cells(ctx, lvl, mode, ax, az, bx, bz);
+    if (!segment) return false;
+
+    // Il primo waypoint coincide con l'ultimo già presente nel path
+    int first = path->waypoint_count > 0 ? 1 : 0;
+    for (int i = first; i < segment->waypoint_count; i++) {
+        path_add_waypoint(path, segment->waypoints[i]);
+    }
+
+    path_free(segment);
+    return true;
+}
+
+// A* sul grafo astratto. Ritorna la sequenza di nodi da start a goal
+// (da liberare con free) o NULL se il goal non è raggiungibile
+static int* abstract_search(PathfindingContext* ctx, struct Level* lvl, HpaGraph* graph,
+                            int start_x, int start_z, int goal_x, int goal_z, int* out_length) {
+    int start_cluster = cell_cluster(lvl, start_x, start_z);
+    int goal_cluster = cell_cluster(lvl, goal_x, goal_z);
+
+    int start_first = graph->cluster_start[start_cluster];
+    int start_count = graph->cluster_start[start_cluster + 1] - start_first;
+    int goal_first = graph->cluster_start[goal_cluster];
+    int goal_count = graph->cluster_start[goal_cluster + 1] - goal_first;
+    if (start_count == 0 || goal_count == 0) return NULL;
+
+    // Scratch per query (nessuno stato condiviso: thread-safe con ctx diversi).
+    // Il nodo virtuale goal_node rappresenta la cella goal.
+    int goal_node = graph->node_count;
+    int total = graph->node_count + 1;
+
+    float* start_costs = (float*)malloc(start_count * sizeof(float));
+    float* goal_costs = (float*)malloc(goal_count * sizeof(float));
+    float* g = (float*)malloc(total * sizeof(float));
+    int* parent = (int*)malloc(total * sizeof(int));
+    bool* closed = (bool*)calloc(total, sizeof(bool));
+    HpaHeap heap = {0};
+
+    int* route = NULL;
+
+    if (start_costs && goal_costs && g && parent && closed) {
+        // 1. Collega start e goal agli ingressi dei rispettivi cluster
+        cluster_costs(ctx, lvl, graph, start_cluster, start_x, start_z, start_costs);
+        cluster_costs(ctx, lvl, graph, goal_cluster, goal_x, goal_z, goal_costs);
+
+        for (int i = 0; i < total; i++) {
+            g[i] = FLT_MAX;
+            parent[i] = -1;
+        }
+
+        for (int i = 0; i < start_count; i++) {
+            if (start_costs[i] == FLT_MAX) continue;
+            int n = graph->cluster_nodes[start_first + i];
+            g[n] = start_costs[i];
+            hpa_heap_push(&heap, g[n] + hpa_heuristic(lvl, graph->nodes[n].cell_x, graph->nodes[n].cell_z, goal_x, goal_z), n);
+        }
+
+        // 2. A* sul grafo astratto
+        bool found = false;
+        while (heap.size > 0) {
+            HpaHeapEntry entry = hpa_heap_pop(&heap);
+            int n = entry.node;
+            if (closed[n]) continue;
+            closed[n] = true;
+
+            if (n == goal_node) {
+                found = true;
+                break;
+            }
+
+            HpaNode* node = &graph->nodes[n];
+
+            // Ingresso del cluster goal: arco verso la cella goal
+            if (node->cluster == goal_cluster) {
+                for (int i = 0; i < goal_count; i++) {
+                    if (graph->cluster_nodes[goal_first + i] != n) continue;
+                    if (goal_costs[i] != FLT_MAX && g[n] + goal_costs[i] < g[goal_node]) {
+                        g[goal_node] = g[n] + goal_costs[i];
+                        parent[goal_node] = n;
+                        hpa_heap_push(&heap, g[goal_node], goal_node);
+                    }
+                    break;
+                }
+            }
+
+            for (int e = 0; e < node->edge_count; e++) {
+                HpaEdge* edge = &graph->edges[node->edge_start + e];
+                if (closed[edge->to]) continue;
+
+                float new_g = g[n] + edge->cost;
+                if (new_g >= g[edge->to]) continue;
+
+                g[edge->to] = new_g;
+                parent[edge->to] = n;
+                HpaNode* next = &graph->nodes[edge->to];
+                hpa_heap_push(&heap, new_g + hpa_heuristic(lvl, next->cell_x, next->cell_z, goal_x, goal_z), edge->to);
+            }
+        }
+
+        // 3. Ricostruisci la sequenza di nodi (senza il nodo virtuale)
+        if (found) {
+            int length = 0;
+            for (int n = parent[goal_node]; n >= 0; n = parent[n]) length++;
+
+            route = (int*)malloc((length > 0 ? length : 1) * sizeof(int));
+            if (route) {
+                int r = length;
+                for (int n = parent[goal_node]; n >= 0; n = parent[n]) route[--r] = n;
+                *out_length = length;
+            }
+        }
+    } else {
+        printf("[HPA] ERROR: Failed to allocate query scratch\n");
+    }
+
+    free(start_costs);
+    free(goal_costs);
+    free(g);
+    free(parent);
+    free(closed);
+    free(heap.entries);
+    return route;
+}
+
+// Query in corso: la route astratta è copiata come celle, così i tratti
+// restanti non dipendono dal grafo (che un update può sostituire tra due step)
+struct HpaQuery {
+    PathfindingContext* ctx;
+    struct Level* lvl;
+    PathSearchMode mode;
+
+    int* route_cells;        // x, z degli ingressi attraversati
+    int route_length;
+    int next;                // Prossimo elemento della route (route_length = goal)
+
+    int goal_x, goal_z;
+    int prev_x, prev_z, prev_cluster;
+    Path* path;
+};
+
+HpaQuery* hpa_query_begin(PathfindingContext* ctx, struct Level* lvl, vec3 start, vec3 goal, PathSearchMode mode) {
+    HpaGraph* graph = lvl->hpaGraph;
+    if (!ctx || !graph) return NULL;
+
+    int start_x, start_z, goal_x, goal_z;
+    if (!pathfinding_level_world_to_cell(lvl, start, &start_x, &start_z) ||
+        !pathfinding_level_world_to_cell(lvl, goal, &goal_x, &goal_z)) {
+        return NULL;
+    }
+    if (!pathfinding_level_cell_walkable(lvl, start_x, start_z) ||
+        !pathfinding_level_cell_walkable(lvl, goal_x, goal_z)) {
+        return NULL;
+    }
+
+    int route_length = 0;
+    int* route = abstract_search(ctx, lvl, graph, start_x, start_z, goal_x, goal_z, &route_length);
+    if (!route) return NULL;
+
+    HpaQuery* query = (HpaQuery*)calloc(1, sizeof(HpaQuery));
+    int* route_cells = (int*)malloc((route_length > 0 ? route_length : 1) * 2 * sizeof(int));
+    Path* path = path_create(route_length * 8 + 2);
+    if (!query || !route_cells || !path) {
+        free(route);
+        free(query);
+        free(route_cells);
+        path_free(path);
+        return NULL;
+    }
+
+    for (int i = 0; i < route_length; i++) {
+        route_cells[2 * i] = graph->nodes[route[i]].cell_x;
+        route_cells[2 * i + 1] = graph->nodes[route[i]].cell_z;
+    }
+    free(route);
+
+    query->ctx = ctx;
+    query->lvl = lvl;
+    query->mode = mode;
+    query->route_cells = route_cells;
+    query->route_length = route_length;
+    query->goal_x = goal_x;
+    query->goal_z = goal_z;
+    query->prev_x = start_x;
+    query->prev_z = start_z;
+    query->prev_cluster = cell_cluster(lvl, start_x, start_z);
+    query->path = path;
+    return query;
+}
+
+HpaQueryState hpa_query_refine(HpaQuery* query) {
+    if (!query || !query->path) return HPA_QUERY_FAILED;
+    if (query->next > query->route_length) return HPA_QUERY_FOUND;
+
+    struct Level* lvl = query->lvl;
+
+    // Raffinamento: A* a griglia solo nei chunk attraversati. Gli archi
+    // inter-cluster costano un waypoint: si prosegue fino al prossimo tratto
+    while (query->next <= query->route_length) {
+        int i = query->next++;
+        int next_x = i < query->route_length ? query->route_cells[2 * i] : query->goal_x;
+        int next_z = i < query->route_length ? query->route_cells[2 * i + 1] : query->goal_z;
+        int next_cluster = cell_cluster(lvl, next_x, next_z);
+
+        bool refined = next_cluster == query->prev_cluster;
+        bool ok;
+        if (refined) {
+            ok = append_refined(query->ctx, lvl, query->path, query->mode, query->prev_cluster,
+                                query->prev_x, query->prev_z, next_x, next_z);
+        } else {
+            // Arco inter-cluster: celle adiacenti ai due lati del bordo
+            vec3 world;
+            pathfinding_level_cell_to_world(lvl, next_x, next_z, world);
+            ok = path_add_waypoint(query->path, world);
+        }
+
+        if (!ok) {
+            path_free(query->path);
+            query->path = NULL;
+            return HPA_QUERY_FAILED;
+        }
+
+        query->prev_x = next_x;
+        query->prev_z = next_z;
+        query->prev_cluster = next_cluster;
+        if (refined) break;
+    }
+
+    return query->next > query->route_length ? HPA_QUERY_FOUND : HPA_QUERY_RUNNING;
+}
+
+Path* hpa_query_take_path(HpaQuery* query) {
+    if (!query || query->next <= query->route_length) return NULL;
+    Path* path = query->path;
+    query->path = NULL;
+    return path;
+}
+
+void hpa_query_destroy(HpaQuery* query) {
+    if (!query) return;
+    path_free(query->path);
+    free(query->route_cells);
+    free(query);
+}
@@ -0,0 +1,118 @@
+#ifndef PATHFINDING_HPA_H
+#define PATHFINDING_HPA_H
+
+/*
+ * HPA* (Hierarchical Path-Finding A*)
+ * ===================================
+ *
+ * Grafo astratto per i path che escono dalla finestra 3x3 dell'A* a griglia.
+ * - Cluster = chunk (pathgrid 64x64)
+ * - Nodi = celle di ingresso sui bordi tra chunk adiacenti
+ * - Archi inter-cluster: coppie di celle ai due lati del bordo (costo 1 o 1.414)
+ * - Archi intra-cluster: costo minimo tra due ingressi dello stesso chunk,
+ *   precalcolato con Dijkstra sul pathgrid del chunk
+ *
+ * Una query collega start e goal agli ingressi del proprio chunk, esegue A*
+ * sul grafo astratto e raffina con A* a griglia solo i chunk attraversati.
+ * Per agenti di una cella il risultato è completo (trova un path se esiste)
+ * ma non sempre ottimo. Ingressi e costi intra ignorano la clearance: con un
+ * agent_radius il raffinamento può fallire in un varco stretto anche se
+ * esiste un percorso largo, quindi pathfinding_find_path rifiuta le query
+ * con raggio (min_clearance > 1) oltre la finestra 3x3.
+ *
+ * Il grafo viene costruito da level_load (solo per livelli più grandi della
+ * finestra 3x3) e liberato da level_cleanup.
+ * È in sola lettura durante le query: più thread possono usarlo insieme.
+ * Le modifiche di walkability lo aggiornano sul main thread (servizio inattivo):
+ * solo i bordi e gli archi intra dei chunk toccati vengono ricalcolati.
+ */
+
+#include <stdbool.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+// Lato (in chunk) della finestra dell'A* a griglia: level_load costruisce il
+// grafo solo per livelli più larghi o più alti
+#define HPA_MIN_LEVEL_CHUNKS 3
+
+typedef struct {
+    int cell_x, cell_z;        // Cella (coordinate globali del livello)
+    int cluster;               // Indice chunk (row-major)
+    int edge_start;            // Primo arco in HpaGraph.edges
+    int edge_count;
+} HpaNode;
+
+typedef struct {
+    int to;                    // Nodo di arrivo
+    float cost;                // Costo in celle
+    bool inter;                // true = attraversa il bordo (celle adiacenti)
+} HpaEdge;
+
+// Coppia di celle ai due lati di un bordo (arco inter-cluster)
+typedef struct {
+    int ax, az, bx, bz;
+    float cost;
+} HpaTransition;
+
+typedef struct HpaGraph {
+    HpaNode* nodes;
+    int node_count;
+
+    HpaEdge* edges;
+    int edge_count;
+
+    // Nodi di ogni cluster: cluster_nodes[cluster_start[c] .. cluster_start[c+1])
+    int* cluster_start;
+    int* cluster_nodes;
+    int cluster_count;
+
+    // Transizioni dei bordi di ogni chunk (est, nord, angolo nord-est):
+    // transitions[border_start[3*c + k] .. border_start[3*c + k + 1]).
+    // Gli aggiornamenti riscansionano solo i bordi dei chunk modificati
+    HpaTransition* transitions;
+    int* border_start;
+
+    // Contesto dei Dijkstra intra-cluster, riusato dagli aggiornamenti
+    PathfindingContext* build_ctx;
+} HpaGraph;
+
+// Costruisce il grafo astratto dai pathgrid dei chunk (sostituisce quello esistente)
+bool hpa_build(struct Level* lvl);
+
+// Aggiorna il grafo dopo una modifica di walkability nel rettangolo di celle
+// globali indicato: riscansiona i bordi dei chunk toccati e ricalcola gli
+// archi intra solo dei chunk toccati o con ingressi cambiati. Chiamata
+// dal listener delle modifiche di walkability (pathfinding_flush_changes).
+bool hpa_update_region(struct Level* lvl, int x0, int z0, int x1, int z1);
+
+// Libera il grafo del livello
+void hpa_destroy(struct Level* lvl);
+
+// Query tra due posizioni world in chunk diversi, interrompibile tra un
+// chunk e l'altro: hpa_query_begin collega start e goal agli ingressi ed
+// esegue l'A* astratto (non interrompibile), ogni hpa_query_refine raffina un
+// chunk attraversato. mode sceglie l'algoritmo del raffinamento. Solo per
+// agenti di una cella (ctx preparato da una query senza agent_radius).
+// Ogni raffinamento riprepara la finestra di ctx: tra due chiamate il
+// contesto può servire altre query. Una modifica di walkability nel
+// frattempo vale solo per i chunk non ancora raffinati.
+typedef struct HpaQuery HpaQuery;
+
+typedef enum {
+    HPA_QUERY_RUNNING,       // Restano chunk da raffinare
+    HPA_QUERY_FOUND,
+    HPA_QUERY_FAILED
+} HpaQueryState;
+
+// NULL se start o goal non sono walkable o il goal non è raggiungibile
+HpaQuery* hpa_query_begin(PathfindingContext* ctx, struct Level* lvl, vec3 start, vec3 goal, PathSearchMode mode);
+HpaQueryState hpa_query_refine(HpaQuery* query);
+
+// Path completo dopo HPA_QUERY_FOUND (ownership al chiamante): waypoint al
+// centro delle celle, non ancora smussato
+Path* hpa_query_take_path(HpaQuery* query);
+void hpa_query_destroy(HpaQuery* query);
+
+#endif // PATHFINDING_HPA_H
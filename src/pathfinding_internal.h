@@ -0,0 +1,33 @@
+#ifndef PATHFINDING_INTERNAL_H
+#define PATHFINDING_INTERNAL_H
+
+/*
+ * Funzioni interne del modulo pathfinding, condivise tra pathfinding.c e i
+ * moduli che lavorano sulla stessa finestra di ricerca (es. HPA*).
+ * Non fanno parte dell'API pubblica: non includere fuori da src/pathfinding*.c
+ */
+
+#include "pathfinding.h"
+
+struct Level;
+
+// Carica nel contesto i pathgrid di un rettangolo di chunk (max 3x3).
+// Ritorna false se il rettangolo è vuoto o troppo grande.
+bool pathfinding_ctx_setup_window(PathfindingContext* ctx, struct Level* lvl,
+                                  int chunk_x, int chunk_z, int chunks_x, int chunks_z);
+
+// Ricerca (A*, JPS o Theta*) tra due celle (coordinate globali del livello) della
+// finestra attiva. Waypoint al centro delle celle, nessuno smoothing. NULL se non trovato.
+Path* pathfinding_ctx_search_cells(PathfindingContext* ctx, struct Level* lvl, PathSearchMode mode,
+                                   int start_x, int start_z, int goal_x, int goal_z);
+
+// Dijkstra dalla cella src su tutta la finestra attiva (coordinate globali).
+// out_costs[i] = costo in celle verso target i (FLT_MAX se irraggiungibile).
+// Ritorna il numero di target raggiunti.
+int pathfinding_ctx_cell_costs(PathfindingContext* ctx, int src_x, int src_z,
+                               const int* target_x, const int* target_z, int count, float* out_costs);
+
+// String pulling con line of sight sulla walkmap a piena risoluzione del livello
+void pathfinding_smooth_path_level(struct Level* lvl, Path* path);
+
+#endif // PATHFINDING_INTERNAL_H
@@ -0,0 +1,382 @@
+#include "pathfinding_landmarks.h"
+#include "pathfinding_zones.h"
+#include "pathfinding.h"
+#include "level.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Distanza non ancora raggiunta durante la Dijkstra
+#define DIST_NONE UINT32_MAX
+
+// Direzioni: 8-connected, diagonali sempre permesse (come l'A*)
+static const int DIR_X[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+static const int DIR_Z[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const uint32_t DIR_COST[8] = {
+    LANDMARK_STRAIGHT, LANDMARK_STRAIGHT, LANDMARK_STRAIGHT, LANDMARK_STRAIGHT,
+    LANDMARK_DIAGONAL, LANDMARK_DIAGONAL, LANDMARK_DIAGONAL, LANDMARK_DIAGONAL
+};
+
+// ============================================================================
+// DIJKSTRA
+// ============================================================================
+
+typedef struct {
+    uint32_t dist;
+    int cell;
+} LandmarkHeapEntry;
+
+// Min-heap senza decrease-key: una cella migliorata viene reinserita e le
+// entry superate si scartano all'estrazione. Ogni cella viene espansa una
+// volta sola, quindi bastano 8 entry per cella più i seed.
+typedef struct {
+    LandmarkHeapEntry* entries;
+    int size;
+} LandmarkHeap;
+
+static void lm_heap_push(LandmarkHeap* heap, uint32_t dist, int cell) {
+    int index = heap->size++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap->entries[parent].dist <= dist) break;
+        heap->entries[index] = heap->entries[parent];
+        index = parent;
+    }
+    heap->entries[index].dist = dist;
+    heap->entries[index].cell = cell;
+}
+
+static LandmarkHeapEntry lm_heap_pop(LandmarkHeap* heap) {
+    LandmarkHeapEntry top = heap->entries[0];
+    LandmarkHeapEntry last = heap->entries[--heap->size];
+
+    int index = 0;
+    while (true) {
+        int left = 2 * index + 1;
+        if (left >= heap->size) break;
+        int right = left + 1;
+        int smallest = (right < heap->size && heap->entries[right].dist < heap->entries[left].dist) ? right : left;
+        if (heap->entries[smallest].dist >= last.dist) break;
+        heap->entries[index] = heap->entries[smallest];
+        index = smallest;
+    }
+    if (heap->size > 0) heap->entries[index] = last;
+
+    return top;
+}
+
+// Abbassa dist a partire dalle celle già nell'heap finché nessun passo
+// walkable la migliora: dopo, ogni coppia di celle vicine rispetta
+// dist[b] <= dist[a] + costo del passo
+static void dijkstra_run(LandmarkHeap* heap, const uint8_t* walk, int width, int height, uint32_t* dist) {
+    while (heap->size > 0) {
+        LandmarkHeapEntry top = lm_heap_pop(heap);
+        if (top.dist != dist[top.cell]) continue;  // Entry superata
+
+        int x = top.cell % width;
+        int z = top.cell / width;
+
+        for (int i = 0; i < 8; i++) {
+            int nx = x + DIR_X[i];
+            int nz = z + DIR_Z[i];
+            if (nx < 0 || nx >= width || nz < 0 || nz >= height) continue;
+
+            int n = nz * width + nx;
+            if (!walk[n]) continue;
+
+            uint32_t new_dist = top.dist + DIR_COST[i];
+            if (new_dist >= dist[n]) continue;
+
+            dist[n] = new_dist;
+            lm_heap_push(heap, new_dist, n);
+        }
+    }
+}
+
+static void dijkstra_from(LandmarkHeap* heap, const uint8_t* walk, int width, int height,
+                          int source, uint32_t* dist) {
+    for (int i = 0; i < width * height; i++) dist[i] = DIST_NONE;
+    dist[source] = 0;
+    heap->size = 0;
+    lm_heap_push(heap, 0, source);
+    dijkstra_run(heap, walk, width, height, dist);
+}
+
+// Conversione tra la colonna di un landmark (uint16) e lo scratch della Dijkstra
+static uint16_t pack_dist(uint32_t dist) {
+    return dist >= LANDMARK_UNREACHED ? LANDMARK_UNREACHED : (uint16_t)dist;
+}
+
+static uint32_t unpack_dist(uint16_t dist) {
+    return dist == LANDMARK_UNREACHED ? DIST_NONE : dist;
+}
+
+// ============================================================================
+// BUILD / UPDATE
+// ============================================================================
+
+// Listener delle modifiche di walkability
+static void on_walkability_changed(struct Level* lvl, int x0, int z0, int x1, int z1, void* user) {
+    (void)user;
+    landmarks_update_region(lvl, x0, z0, x1, z1);
+}
+
+// Una cella della zona più grande (i landmark servono dove si cammina di
+// più); senza zone la prima cella walkable. -1 se il livello è tutto bloccato.
+static int seed_cell(struct Level* lvl, const uint8_t* walk, int cells) {
+    ZoneMap* zm = lvl->zoneMap;
+    int* sizes = zm ? (int*)calloc(zm->next_label, sizeof(int)) : NULL;
+
+    if (!sizes) {
+        for (int i = 0; i < cells; i++) {
+            if (walk[i]) return i;
+        }
+        return -1;
+    }
+
+    // sizes[ZONE_NONE] resta 0
+    int best_label = ZONE_NONE;
+    for (int i = 0; i < cells; i++) {
+        int label = zm->labels[i];
+        if (label != ZONE_NONE && ++sizes[label] > sizes[best_label]) best_label = label;
+    }
+    free(sizes);
+
+    if (best_label == ZONE_NONE) return -1;
+    for (int i = 0; i < cells; i++) {
+        if (zm->labels[i] == best_label) return i;
+    }
+    return -1;
+}
+
+// Cella raggiunta con il valore massimo (-1 se nessuna oltre 0)
+static int farthest_cell(const uint32_t* dist, int cells) {
+    int best = -1;
+    uint32_t best_dist = 0;
+    for (int i = 0; i < cells; i++) {
+        if (dist[i] == DIST_NONE || dist[i] <= best_dist) continue;
+        best = i;
+        best_dist = dist[i];
+    }
+    return best;
+}
+
+bool landmarks_build(struct Level* lvl, int count) {
+    if (!lvl || !lvl->chunks) return false;
+
+    static bool listener_registered = false;
+    if (!listener_registered) {
+        listener_registered = pathfinding_add_change_listener(on_walkability_changed, NULL);
+    }
+
+    landmarks_destroy(lvl);
+    if (count <= 0) return true;
+    if (count > PATH_LANDMARKS_MAX) {
+        printf("[Landmarks] WARNING: %d landmarks requested, using %d\n", count, PATH_LANDMARKS_MAX);
+        count = PATH_LANDMARKS_MAX;
+    }
+
+    double t_start = get_time_ms();
+
+    int width = pathfinding_level_cells_x(lvl);
+    int height = pathfinding_level_cells_z(lvl);
+    int cells = width * height;
+
+    LandmarkMap* lm = (LandmarkMap*)calloc(1, sizeof(LandmarkMap));
+    uint8_t* walk = (uint8_t*)malloc(cells);
+    uint32_t* dist = (uint32_t*)malloc(cells * sizeof(uint32_t));
+    uint32_t* min_dist = (uint32_t*)malloc(cells * sizeof(uint32_t));
+    uint16_t* columns = (uint16_t*)malloc((size_t)cells * count * sizeof(uint16_t));
+    LandmarkHeap heap = { (LandmarkHeapEntry*)malloc((size_t)cells * 9 * sizeof(LandmarkHeapEntry)), 0 };
+
+    bool ok = lm && walk && dist && min_dist && columns && heap.entries;
+    if (!ok) {
+        printf("[Landmarks] ERROR: Failed to allocate landmarks (%d cells x %d)\n", cells, count);
+    }
+
+    int placed = 0;
+    if (ok) {
+        pathfinding_level_copy_walkability(lvl, walk);
+
+        // Primo landmark: la cella più lontana da un punto qualsiasi della zona
+        int next = seed_cell(lvl, walk, cells);
+        if (next >= 0) {
+            dijkstra_from(&heap, walk, width, height, next, dist);
+            int far = farthest_cell(dist, cells);
+            if (far >= 0) next = far;
+        }
+
+        // Ogni landmark successivo: la cella più lontana da tutti i precedenti
+        for (int i = 0; i < cells; i++) min_dist[i] = DIST_NONE;
+
+        while (next >= 0 && placed < count) {
+            dijkstra_from(&heap, walk, width, height, next, dist);
+
+            uint16_t* column = &columns[(size_t)placed * cells];
+            for (int i = 0; i < cells; i++) {
+                column[i] = pack_dist(dist[i]);
+                if (dist[i] < min_dist[i]) min_dist[i] = dist[i];
+            }
+            lm->cells[placed++] = next;
+
+            next = farthest_cell(min_dist, cells);
+        }
+
+        if (placed == 0) {
+            printf("[Landmarks] WARNING: No walkable cells, landmarks disabled\n");
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        // Una riga per cella: l'euristica legge tutti i landmark di una cella insieme
+        lm->dist = (uint16_t*)malloc((size_t)cells * placed * sizeof(uint16_t));
+        if (!lm->dist) {
+            printf("[Landmarks] ERROR: Failed to allocate landmark table\n");
+            ok = false;
+        } else {
+            for (int l = 0; l < placed; l++) {
+                const uint16_t* column = &columns[(size_t)l * cells];
+                for (int i = 0; i < cells; i++) lm->dist[i * placed + l] = column[i];
+            }
+            lm->width = width;
+            lm->height = height;
+            lm->count = placed;
+        }
+    }
+
+    free(walk);
+    free(dist);
+    free(min_dist);
+    free(columns);
+    free(heap.entries);
+
+    if (!ok) {
+        free(lm);
+        return false;
+    }
+
+    lvl->landmarks = lm;
+
+    printf("[Landmarks] Built %d landmarks on %dx%d cells (%.2fms, %d KB)\n",
+           placed, width, height, (float)(get_time_ms() - t_start),
+           (int)((size_t)cells * placed * sizeof(uint16_t) / 1024));
+    return true;
+}
+
+bool landmarks_update_region(struct Level* lvl, int x0, int z0, int x1, int z1) {
+    if (!lvl || !lvl->landmarks) return false;
+    LandmarkMap* lm = lvl->landmarks;
+
+    int width = lm->width;
+    int height = lm->height;
+    int cells = width * height;
+
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= width) x1 = width - 1;
+    if (z1 >= height) z1 = height - 1;
+    if (x0 > x1 || z0 > z1) return true;
+
+    uint8_t* walk = (uint8_t*)malloc(cells);
+    if (!walk) return false;
+    pathfinding_level_copy_walkability(lvl, walk);
+
+    int opened = 0;
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            if (walk[z * width + x]) opened++;
+        }
+    }
+
+    // Solo celle bloccate: un grafo con meno passi non accorcia nessuna
+    // distanza, i valori vecchi restano limiti inferiori validi
+    lm->stale_cells += (x1 - x0 + 1) * (z1 - z0 + 1) - opened;
+    if (opened == 0) {
+        free(walk);
+        return true;
+    }
+
+    double t_start = get_time_ms();
+
+    uint32_t* dist = (uint32_t*)malloc(cells * sizeof(uint32_t));
+    LandmarkHeap heap = { (LandmarkHeapEntry*)malloc((size_t)cells * 9 * sizeof(LandmarkHeapEntry)), 0 };
+    if (!dist || !heap.entries) {
+        // Senza memoria per riparare la tabella il limite non è più garantito
+        printf("[Landmarks] ERROR: Failed to allocate update scratch, landmarks disabled\n");
+        free(walk);
+        free(dist);
+        free(heap.entries);
+        landmarks_destroy(lvl);
+        return false;
+    }
+
+    // Celle liberate: nuovi passi possono accorciare le distanze. Ogni cella
+    // walkable del rettangolo riparte dal miglior valore dei vicini e la
+    // Dijkstra propaga solo i miglioramenti: niente ricalcolo completo.
+    int lowered = 0;
+    for (int l = 0; l < lm->count; l++) {
+        for (int i = 0; i < cells; i++) dist[i] = unpack_dist(lm->dist[i * lm->count + l]);
+
+        heap.size = 0;
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                int cell = z * width + x;
+                if (!walk[cell]) continue;
+
+                uint32_t best = dist[cell];
+                for (int i = 0; i < 8; i++) {
+                    int nx = x + DIR_X[i];
+                    int nz = z + DIR_Z[i];
+                    if (nx < 0 || nx >= width || nz < 0 || nz >= height) continue;
+
+                    int n = nz * width + nx;
+                    if (!walk[n] || dist[n] == DIST_NONE) continue;
+                    if (dist[n] + DIR_COST[i] < best) best = dist[n] + DIR_COST[i];
+                }
+
+                dist[cell] = best;
+                if (best != DIST_NONE) lm_heap_push(&heap, best, cell);
+            }
+        }
+        dijkstra_run(&heap, walk, width, height, dist);
+
+        for (int i = 0; i < cells; i++) {
+            uint16_t packed = pack_dist(dist[i]);
+            uint16_t* slot = &lm->dist[i * lm->count + l];
+            if (packed == *slot) continue;
+            *slot = packed;
+            lowered++;
+        }
+    }
+
+    free(walk);
+    free(dist);
+    free(heap.entries);
+
+    printf("[Landmarks] Updated landmarks: %d distances lowered (%.2fms)\n",
+           lowered, (float)(get_time_ms() - t_start));
+    return true;
+}
+
+void landmarks_destroy(struct Level* lvl) {
+    if (!lvl || !lvl->landmarks) return;
+    free(lvl->landmarks->dist);
+    free(lvl->landmarks);
+    lvl->landmarks = NULL;
+}
+
+// ============================================================================
+// QUERY
+// ============================================================================
+
+float landmarks_lower_bound(struct Level* lvl, int ax, int az, int bx, int bz) {
+    if (!lvl || !lvl->landmarks) return 0.0f;
+    LandmarkMap* lm = lvl->landmarks;
+    if (ax < 0 || az < 0 || bx < 0 || bz < 0 ||
+        ax >= lm->width || az >= lm->height || bx >= lm->width || bz >= lm->height) {
+        return 0.0f;
+    }
+    return landmarks_bound(lm, az * lm->width + ax, bz * lm->width + bx);
+}
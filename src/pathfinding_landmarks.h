@@ -0,0 +1,73 @@
+#ifndef PATHFINDING_LANDMARKS_H
+#define PATHFINDING_LANDMARKS_H
+
+/*
+ * LANDMARK (euristica ALT)
+ * ========================
+ *
+ * Distanze di Dijkstra da poche celle "landmark" a tutte le celle del
+ * livello (layer 0, stesso grafo 8-connected dell'A*). Per la disuguaglianza
+ * triangolare |d(L,goal) - d(L,n)| <= d(n,goal): il massimo sui landmark è un
+ * limite inferiore del costo restante, molto più stretto della distanza
+ * euclidea nelle fortezze a labirinto, dove il percorso deve aggirare le mura.
+ *
+ * I costi dei passi sono interi (10 dritto, 14 diagonale), mai sopra quelli
+ * dell'A* (1 e 1.414): la tabella resta ammissibile senza margini di
+ * arrotondamento e occupa 2 byte per cella e landmark.
+ *
+ * Opzionali: costruiti da level_load solo se il .lvl ha la chiave
+ * "landmarks <n>" (o con landmarks_build), liberati da level_cleanup.
+ * Le modifiche di walkability li aggiornano da sole: una cella bloccata non
+ * richiede nulla (le distanze vecchie restano limiti inferiori, solo meno
+ * stretti), una cella liberata abbassa le distanze a partire da lì.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct Level;
+
+#define PATH_LANDMARKS_MAX   16
+#define LANDMARK_UNREACHED   0xFFFF   // Cella bloccata, in un'altra zona o troppo lontana
+#define LANDMARK_STRAIGHT    10       // Costo di un passo dritto nella tabella
+#define LANDMARK_DIAGONAL    14       // Passo diagonale (14/10 <= 1.414 dell'A*)
+
+typedef struct LandmarkMap {
+    int width, height;         // Celle globali del livello
+    int count;                 // Landmark piazzati (<= PATH_LANDMARKS_MAX)
+    int cells[PATH_LANDMARKS_MAX];  // Cella globale di ogni landmark (row-major)
+    uint16_t* dist;            // [cella * count + landmark]: i landmark di una cella sono contigui
+    int stale_cells;           // Celle bloccate dopo l'ultimo build (limite valido ma meno stretto)
+} LandmarkMap;
+
+// Piazza count landmark (punto più lontano dai precedenti, nella zona più
+// grande) e calcola le loro distanze. Sostituisce la mappa esistente;
+// count <= 0 la rimuove. Chiamarla di nuovo dopo molte celle bloccate
+// (stale_cells) ristringe il limite.
+bool landmarks_build(struct Level* lvl, int count);
+
+// Ripristina il limite dopo una modifica del rettangolo di celle globali.
+// Chiamata automaticamente da pathfinding_set_cells_walkable.
+bool landmarks_update_region(struct Level* lvl, int x0, int z0, int x1, int z1);
+
+void landmarks_destroy(struct Level* lvl);
+
+// Limite inferiore del costo (in celle) tra due celle globali (indici
+// row-major); 0 se nessun landmark le raggiunge entrambe
+static inline float landmarks_bound(const LandmarkMap* lm, int cell_a, int cell_b) {
+    const uint16_t* da = &lm->dist[cell_a * lm->count];
+    const uint16_t* db = &lm->dist[cell_b * lm->count];
+    int best = 0;
+    for (int l = 0; l < lm->count; l++) {
+        if (da[l] == LANDMARK_UNREACHED || db[l] == LANDMARK_UNREACHED) continue;
+        int diff = (int)da[l] - (int)db[l];
+        if (diff < 0) diff = -diff;
+        if (diff > best) best = diff;
+    }
+    return best * (1.0f / LANDMARK_STRAIGHT);
+}
+
+// Come landmarks_bound per coordinate di cella (0 senza landmark o fuori livello)
+float landmarks_lower_bound(struct Level* lvl, int ax, int az, int bx, int bz);
+
+#endif // PATHFINDING_LANDMARKS_H
@@ -0,0 +1,273 @@
+#include "pathfinding_layers.h"
+#include "pathfinding_zones.h"
+#include "level.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static bool layer_valid(int layer) {
+    return layer >= 1 && layer < PATH_MAX_LAYERS;
+}
+
+static bool cell_in_level(struct Level* lvl, int cell_x, int cell_z) {
+    return cell_x >= 0 && cell_z >= 0 &&
+           cell_x < pathfinding_level_cells_x(lvl) && cell_z < pathfinding_level_cells_z(lvl);
+}
+
+static PathLayers* layers_get_or_create(struct Level* lvl) {
+    if (lvl->pathLayers) return lvl->pathLayers;
+
+    lvl->pathLayers = (PathLayers*)calloc(1, sizeof(PathLayers));
+    if (!lvl->pathLayers) {
+        printf("[Layers] ERROR: Failed to allocate navigation layers\n");
+    }
+    return lvl->pathLayers;
+}
+
+// Pathgrid del layer nel chunk della cella (NULL se il layer non ha celle lì)
+static PathGrid* layer_chunk_grid(struct Level* lvl, int layer, int cell_x, int cell_z) {
+    PathLayers* pl = lvl->pathLayers;
+    if (!pl || !pl->grids[layer]) return NULL;
+
+    PathGrid* pg = &pl->grids[layer][(cell_z / PATHGRID_SIZE) * lvl->chunksCountX + (cell_x / PATHGRID_SIZE)];
+    return pg->grid ? pg : NULL;
+}
+
+// ============================================================================
+// EDIT
+// ============================================================================
+
+int layers_set_cells(struct Level* lvl, int layer, int x0, int z0, int x1, int z1, bool walkable) {
+    if (!lvl || !lvl->chunks) return 0;
+    if (!layer_valid(layer)) {
+        printf("[Layers] ERROR: Invalid layer %d\n", layer);
+        return 0;
+    }
+
+    PathLayers* pl = layers_get_or_create(lvl);
+    if (!pl) return 0;
+
+    if (!pl->grids[layer]) {
+        pl->grids[layer] = (PathGrid*)calloc(lvl->totalChunks, sizeof(PathGrid));
+        if (!pl->grids[layer]) {
+            printf("[Layers] ERROR: Failed to allocate layer %d\n", layer);
+            return 0;
+        }
+    }
+
+    // Normalizza e limita al livello
+    if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+    if (z0 > z1) { int t = z0; z0 = z1; z1 = t; }
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= pathfinding_level_cells_x(lvl)) x1 = pathfinding_level_cells_x(lvl) - 1;
+    if (z1 >= pathfinding_level_cells_z(lvl)) z1 = pathfinding_level_cells_z(lvl) - 1;
+    if (x0 > x1 || z0 > z1) return 0;
+
+    int changed = 0;
+    uint8_t value = walkable ? 1 : 0;
+
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            PathGrid* pg = &pl->grids[layer][(z / PATHGRID_SIZE) * lvl->chunksCountX + (x / PATHGRID_SIZE)];
+
+            // Pathgrid allocato alla prima cella del layer nel chunk
+            if (!pg->grid) {
+                if (!walkable) continue;
+                if (!pathgrid_init(pg, PATHGRID_SIZE, PATHGRID_SIZE, pathfinding_level_cell_size(lvl))) {
+                    return changed;
+                }
+                memset(pg->grid, 0, PATHGRID_SIZE * PATHGRID_SIZE);
+                bitgrid_fill(&pg->walk_bits, false);
+                pg->layer_id = layer;
+            }
+
+            uint8_t* cell = &pg->grid[(z % PATHGRID_SIZE) * PATHGRID_SIZE + (x % PATHGRID_SIZE)];
+            if (*cell == value) continue;
+
+            *cell = value;
+            bitgrid_set(&pg->walk_bits, x % PATHGRID_SIZE, z % PATHGRID_SIZE, walkable);
+            changed++;
+        }
+    }
+
+    if (changed > 0) pl->version++;
+    return changed;
+}
+
+bool layers_add_link(struct Level* lvl, int layer_a, int cell_ax, int cell_az,
+                     int layer_b, int cell_bx, int cell_bz, float cost) {
+    if (!lvl || !lvl->chunks) return false;
+    if (layer_a < 0 || layer_a >= PATH_MAX_LAYERS || layer_b < 0 || layer_b >= PATH_MAX_LAYERS ||
+        !cell_in_level(lvl, cell_ax, cell_az) || !cell_in_level(lvl, cell_bx, cell_bz)) {
+        printf("[Layers] ERROR: Invalid link %d:(%d,%d) -> %d:(%d,%d)\n",
+               layer_a, cell_ax, cell_az, layer_b, cell_bx, cell_bz);
+        return false;
+    }
+
+    PathLayers* pl = layers_get_or_create(lvl);
+    if (!pl) return false;
+    if (pl->link_count >= LAYERS_MAX_LINKS) {
+        printf("[Layers] ERROR: Too many layer links (max %d)\n", LAYERS_MAX_LINKS);
+        return false;
+    }
+
+    // Mai meno della distanza orizzontale (euristica dell'A* ammissibile),
+    // almeno un passo anche tra celle sovrapposte
+    float dx = (float)(cell_bx - cell_ax);
+    float dz = (float)(cell_bz - cell_az);
+    float min_cost = sqrtf(dx * dx + dz * dz);
+    if (min_cost < 1.0f) min_cost = 1.0f;
+
+    PathLayerLink* link = &pl->links[pl->link_count++];
+    link->layer_a = layer_a;
+    link->cell_ax = cell_ax;
+    link->cell_az = cell_az;
+    link->layer_b = layer_b;
+    link->cell_bx = cell_bx;
+    link->cell_bz = cell_bz;
+    link->cost = cost > min_cost ? cost : min_cost;
+
+    pl->version++;
+    return true;
+}
+
+void layers_set_active(struct Level* lvl, int layer, bool active) {
+    if (!lvl || !layer_valid(layer)) return;
+
+    PathLayers* pl = layers_get_or_create(lvl);
+    if (!pl || pl->active[layer] == active) return;
+
+    pl->active[layer] = active;
+    pl->version++;
+}
+
+bool layers_is_active(struct Level* lvl, int layer) {
+    if (layer == 0) return true;
+    if (!lvl || !lvl->pathLayers || !layer_valid(layer)) return false;
+    return lvl->pathLayers->active[layer];
+}
+
+void layers_set_height(struct Level* lvl, int layer, float height_offset) {
+    if (!lvl || !layer_valid(layer)) return;
+
+    PathLayers* pl = layers_get_or_create(lvl);
+    if (!pl) return;
+
+    pl->height_offset[layer] = height_offset;
+    pl->version++;
+}
+
+void layers_destroy(struct Level* lvl) {
+    if (!lvl || !lvl->pathLayers) return;
+
+    PathLayers* pl = lvl->pathLayers;
+    for (int layer = 1; layer < PATH_MAX_LAYERS; layer++) {
+        if (!pl->grids[layer]) continue;
+        for (int i = 0; i < lvl->totalChunks; i++) {
+            pathgrid_cleanup(&pl->grids[layer][i]);
+        }
+        free(pl->grids[layer]);
+    }
+
+    free(pl);
+    lvl->pathLayers = NULL;
+}
+
+// ============================================================================
+// QUERY
+// ============================================================================
+
+bool layers_cell_walkable(struct Level* lvl, int layer, int cell_x, int cell_z) {
+    if (layer == 0) return pathfinding_level_cell_walkable(lvl, cell_x, cell_z);
+    if (!layers_is_active(lvl, layer) || !cell_in_level(lvl, cell_x, cell_z)) return false;
+
+    PathGrid* pg = layer_chunk_grid(lvl, layer, cell_x, cell_z);
+    return pg && pg->grid[(cell_z % PATHGRID_SIZE) * PATHGRID_SIZE + (cell_x % PATHGRID_SIZE)] != 0;
+}
+
+int layers_pick(struct Level* lvl, vec3 pos) {
+    if (!lvl || !lvl->pathLayers) return 0;
+
+    int cell_x, cell_z;
+    if (!pathfinding_level_world_to_cell(lvl, pos, &cell_x, &cell_z)) return 0;
+
+    float ground = level_get_height(lvl, pos[0], pos[2]);
+    int best = -1;
+    float best_dist = 0.0f;
+
+    for (int layer = 0; layer < PATH_MAX_LAYERS; layer++) {
+        if (!layers_cell_walkable(lvl, layer, cell_x, cell_z)) continue;
+
+        float surface = ground + (layer > 0 ? lvl->pathLayers->height_offset[layer] : 0.0f);
+        float dist = fabsf(pos[1] - surface);
+        if (best < 0 || dist < best_dist) {
+            best = layer;
+            best_dist = dist;
+        }
+    }
+
+    return best < 0 ? 0 : best;
+}
+
+// Union-find sui nodi di layers_zones_linked
+static int uf_find(int* parent, int node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+// Nodo di una zona del terreno (dopo i PATH_MAX_LAYERS nodi dei layer), aggiunto se nuovo
+static int zone_node(int* zones, int* zone_count, int* parent, int zone) {
+    for (int i = 0; i < *zone_count; i++) {
+        if (zones[i] == zone) return PATH_MAX_LAYERS + i;
+    }
+    int node = PATH_MAX_LAYERS + *zone_count;
+    zones[(*zone_count)++] = zone;
+    parent[node] = node;
+    return node;
+}
+
+bool layers_zones_linked(struct Level* lvl, int zone_a, int zone_b) {
+    PathLayers* pl = lvl ? lvl->pathLayers : NULL;
+    if (!pl || pl->link_count == 0 || zone_a == ZONE_NONE || zone_b == ZONE_NONE) return false;
+
+    // Nodi: layer 1..PATH_MAX_LAYERS-1, poi le zone toccate dai link attivi
+    int zones[2 * LAYERS_MAX_LINKS + 2];
+    int parent[PATH_MAX_LAYERS + 2 * LAYERS_MAX_LINKS + 2];
+    int zone_count = 0;
+    for (int i = 0; i < PATH_MAX_LAYERS; i++) parent[i] = i;
+
+    int node_a = zone_node(zones, &zone_count, parent, zone_a);
+    int node_b = zone_node(zones, &zone_count, parent, zone_b);
+
+    for (int i = 0; i < pl->link_count; i++) {
+        PathLayerLink* link = &pl->links[i];
+        if (!layers_cell_walkable(lvl, link->layer_a, link->cell_ax, link->cell_az) ||
+            !layers_cell_walkable(lvl, link->layer_b, link->cell_bx, link->cell_bz)) {
+            continue;
+        }
+
+        int ends[2];
+        for (int e = 0; e < 2; e++) {
+            int layer = e == 0 ? link->layer_a : link->layer_b;
+            if (layer > 0) {
+                ends[e] = layer;
+            } else {
+                int zone = e == 0 ? zones_get_cell(lvl, link->cell_ax, link->cell_az)
+                                  : zones_get_cell(lvl, link->cell_bx, link->cell_bz);
+                ends[e] = zone_node(zones, &zone_count, parent, zone);
+            }
+        }
+        parent[uf_find(parent, ends[0])] = uf_find(parent, ends[1]);
+    }
+
+    return uf_find(parent, node_a) == uf_find(parent, node_b);
+}
@@ -0,0 +1,81 @@
+#ifndef PATHFINDING_LAYERS_H
+#define PATHFINDING_LAYERS_H
+
+/*
+ * LAYER DI NAVIGAZIONE
+ * ====================
+ *
+ * Superfici percorribili sopra il terreno (layer 0 = Terrain.pathgrid):
+ * ponti di ghiaccio sui fiumi, camminamenti sulle mura, passerelle.
+ * Ogni layer 1..PATH_MAX_LAYERS-1 ha un pathgrid 64x64 per chunk
+ * (PathGrid.layer_id = layer), allocato solo nei chunk dove il layer ha
+ * celle, e si collega agli altri layer con link espliciti tra due celle
+ * (scale, rampe, estremità dei ponti).
+ *
+ * Un layer inattivo è invisibile alle ricerche: layers_set_active lo accende
+ * o spegne in O(1) (es. l'incantesimo Ice Bridge) senza toccare il terreno.
+ *
+ * L'A* a griglia cerca su tutti i layer attivi della finestra 3x3 (JPS e
+ * Theta* ripiegano su A* quando la finestra ne contiene). HPA*, flow field e
+ * D* Lite usano solo il layer 0.
+ *
+ * Creati alla prima modifica, liberati da level_cleanup.
+ * Solo main thread, con pathfinding_service inattivo.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+#define LAYERS_MAX_LINKS 256
+
+// Collegamento bidirezionale tra due celle globali di due layer
+typedef struct {
+    int layer_a, cell_ax, cell_az;
+    int layer_b, cell_bx, cell_bz;
+    float cost;                // In celle, mai meno della distanza orizzontale
+} PathLayerLink;
+
+typedef struct PathLayers {
+    PathGrid* grids[PATH_MAX_LAYERS];      // [layer][chunk] (grid NULL dove il layer non ha celle); [0] inutilizzato
+    bool active[PATH_MAX_LAYERS];
+    float height_offset[PATH_MAX_LAYERS];  // Altezza della superficie sopra il terreno (m)
+
+    PathLayerLink links[LAYERS_MAX_LINKS];
+    int link_count;
+
+    uint32_t version;          // Cambia a ogni modifica (parte della chiave della path cache)
+} PathLayers;
+
+// Rende walkable (o rimuove) un rettangolo di celle globali del layer (1..PATH_MAX_LAYERS-1).
+// Ritorna il numero di celle cambiate.
+int layers_set_cells(struct Level* lvl, int layer, int x0, int z0, int x1, int z1, bool walkable);
+
+// Collega due celle (es. fine della scala e camminamento). cost <= 0: distanza orizzontale.
+bool layers_add_link(struct Level* lvl, int layer_a, int cell_ax, int cell_az,
+                     int layer_b, int cell_bx, int cell_bz, float cost);
+
+// Accende/spegne un layer in O(1). I layer partono spenti.
+void layers_set_active(struct Level* lvl, int layer, bool active);
+bool layers_is_active(struct Level* lvl, int layer);
+
+// Altezza della superficie del layer sopra il terreno (waypoint e scelta del layer)
+void layers_set_height(struct Level* lvl, int layer, float height_offset);
+
+void layers_destroy(struct Level* lvl);
+
+// true se una cella globale è walkable sul layer (layer 0 = terreno, layer spenti = false)
+bool layers_cell_walkable(struct Level* lvl, int layer, int cell_x, int cell_z);
+
+// Layer su cui si trova una posizione world: tra il terreno e i layer attivi
+// walkable in quella cella, quello con la superficie più vicina a pos[1]
+int layers_pick(struct Level* lvl, vec3 pos);
+
+// true se i link dei layer attivi possono collegare due zone del terreno
+// (vedi pathfinding_zones.h). Stima per eccesso: ogni layer conta come connesso.
+bool layers_zones_linked(struct Level* lvl, int zone_a, int zone_b);
+
+#endif // PATHFINDING_LAYERS_H
@@ -144,6 +144,12 @@ bool navmesh_init(NavMesh* nm, int initial_tri_capacity) {
     nm->grid_cell_size = 1.0f;
     nm->layer_id = 0;
 
+    nm->tri_grid_offsets = NULL;
+    nm->tri_grid_items = NULL;
+    nm->tri_grid_w = 0;
+    nm->tri_grid_h = 0;
+    nm->tri_grid_cell = 0.0f;
+
     glm_vec3_zero(nm->min_bounds);
     glm_vec3_zero(nm->max_bounds);
 
@@ -160,6 +166,12 @@ void navmesh_cleanup(NavMesh* nm) {
         free(nm->triangles);
         nm->triangles = NULL;
     }
+    free(nm->tri_grid_offsets);
+    free(nm->tri_grid_items);
+    nm->tri_grid_offsets = NULL;
+    nm->tri_grid_items = NULL;
+    nm->tri_grid_w = 0;
+    nm->tri_grid_h = 0;
     nm->vertex_count = 0;
     nm->triangle_count = 0;
 }
@@ -242,6 +254,97 @@ bool navmesh_load_from_file(NavMesh* nm, const char* filepath) {
     return true;
 }
 
+// Cella della griglia che contiene la coordinata (clamp sul bordo)
+static int tri_grid_coord(float value, float min, float cell, int dim) {
+    int c = (int)((value - min) / cell);
+    if (c < 0) c = 0;
+    if (c >= dim) c = dim - 1;
+    return c;
+}
+
+// Rettangolo di celle coperto dall'AABB XZ di un triangolo
+static void triangle_cell_range(NavMesh* nm, int tri_index, float cell, int w, int h,
+                                int* cx0, int* cz0, int* cx1, int* cz1) {
+    NavTriangle* tri = &nm->triangles[tri_index];
+    float min_x = FLT_MAX, max_x = -FLT_MAX;
+    float min_z = FLT_MAX, max_z = -FLT_MAX;
+    for (int v = 0; v < 3; v++) {
+        float* p = nm->vertices[tri->vertices[v]].position;
+        min_x = fminf(min_x, p[0]);
+        max_x = fmaxf(max_x, p[0]);
+        min_z = fminf(min_z, p[2]);
+        max_z = fmaxf(max_z, p[2]);
+    }
+    *cx0 = tri_grid_coord(min_x, nm->min_bounds[0], cell, w);
+    *cx1 = tri_grid_coord(max_x, nm->min_bounds[0], cell, w);
+    *cz0 = tri_grid_coord(min_z, nm->min_bounds[2], cell, h);
+    *cz1 = tri_grid_coord(max_z, nm->min_bounds[2], cell, h);
+}
+
+// Griglia uniforme sui bounds XZ: due passate (conteggio, poi riempimento)
+// nello stesso layout compatto delle liste per cella
+static bool build_triangle_grid(NavMesh* nm) {
+    free(nm->tri_grid_offsets);
+    free(nm->tri_grid_items);
+    nm->tri_grid_offsets = NULL;
+    nm->tri_grid_items = NULL;
+    nm->tri_grid_w = 0;
+    nm->tri_grid_h = 0;
+
+    float width = nm->max_bounds[0] - nm->min_bounds[0];
+    float depth = nm->max_bounds[2] - nm->min_bounds[2];
+
+    // ~NAVMESH_GRID_TRIS_PER_CELL triangoli per cella con una distribuzione uniforme
+    float cell = sqrtf(width * depth * NAVMESH_GRID_TRIS_PER_CELL / nm->triangle_count);
+    float max_side = fmaxf(width, depth);
+    if (cell < max_side / NAVMESH_GRID_MAX_DIM) cell = max_side / NAVMESH_GRID_MAX_DIM;
+    if (cell <= 0.0f) cell = 1.0f;
+
+    int w = (int)(width / cell) + 1;
+    int h = (int)(depth / cell) + 1;
+    if (w > NAVMESH_GRID_MAX_DIM) w = NAVMESH_GRID_MAX_DIM;
+    if (h > NAVMESH_GRID_MAX_DIM) h = NAVMESH_GRID_MAX_DIM;
+
+    int* offsets = (int*)calloc((size_t)w * h + 1, sizeof(int));
+    if (!offsets) return false;
+
+    for (int i = 0; i < nm->triangle_count; i++) {
+        int cx0, cz0, cx1, cz1;
+        triangle_cell_range(nm, i, cell, w, h, &cx0, &cz0, &cx1, &cz1);
+        for (int cz = cz0; cz <= cz1; cz++) {
+            for (int cx = cx0; cx <= cx1; cx++) offsets[cz * w + cx + 1]++;
+        }
+    }
+    for (int c = 0; c < w * h; c++) offsets[c + 1] += offsets[c];
+
+    int* items = (int*)malloc((size_t)(offsets[w * h] > 0 ? offsets[w * h] : 1) * sizeof(int));
+    int* fill = (int*)malloc((size_t)w * h * sizeof(int));
+    if (!items || !fill) {
+        free(offsets);
+        free(items);
+        free(fill);
+        return false;
+    }
+    memcpy(fill, offsets, (size_t)w * h * sizeof(int));
+
+    // Triangoli in ordine di indice: ogni lista resta crescente
+    for (int i = 0; i < nm->triangle_count; i++) {
+        int cx0, cz0, cx1, cz1;
+        triangle_cell_range(nm, i, cell, w, h, &cx0, &cz0, &cx1, &cz1);
+        for (int cz = cz0; cz <= cz1; cz++) {
+            for (int cx = cx0; cx <= cx1; cx++) items[fill[cz * w + cx]++] = i;
+        }
+    }
+    free(fill);
+
+    nm->tri_grid_offsets = offsets;
+    nm->tri_grid_items = items;
+    nm->tri_grid_w = w;
+    nm->tri_grid_h = h;
+    nm->tri_grid_cell = cell;
+    return true;
+}
+
 void navmesh_calculate_metadata(NavMesh* nm) {
     if (!nm || nm->triangle_count == 0) return;
 
@@ -310,9 +413,17 @@ void navmesh_calculate_metadata(NavMesh* nm) {
         }
     }
 
+    // Griglia per navmesh_find_triangle (senza: ricerca lineare)
+    if (!build_triangle_grid(nm)) {
+        printf("[NavMesh] WARNING: Failed to allocate triangle grid, using linear search\n");
+    }
+
     printf("[NavMesh] Metadata calculated. Bounds: (%.1f,%.1f,%.1f) to (%.1f,%.1f,%.1f)\n",
            nm->min_bounds[0], nm->min_bounds[1], nm->min_bounds[2],
            nm->max_bounds[0], nm->max_bounds[1], nm->max_bounds[2]);
+    printf("[NavMesh] Triangle grid: %dx%d cells of %.2fm, %d entries\n",
+           nm->tri_grid_w, nm->tri_grid_h, nm->tri_grid_cell,
+           nm->tri_grid_offsets ? nm->tri_grid_offsets[nm->tri_grid_w * nm->tri_grid_h] : 0);
 }
 
 // ============================================================================
@@ -346,7 +457,28 @@ bool navmesh_point_in_triangle(NavMesh* nm, int tri_index, float x, float z) {
 int navmesh_find_triangle(NavMesh* nm, float world_x, float world_z) {
     if (!nm) return -1;
 
-    // Brute force per ora (per ottimizzare: spatial hash, BVH, etc.)
+    if (nm->tri_grid_offsets) {
+        // Fuori dai bounds nessun triangolo può contenere il punto
+        if (world_x < nm->min_bounds[0] || world_x > nm->max_bounds[0] ||
+            world_z < nm->min_bounds[2] || world_z > nm->max_bounds[2]) {
+            return -1;
+        }
+
+        int cx = tri_grid_coord(world_x, nm->min_bounds[0], nm->tri_grid_cell, nm->tri_grid_w);
+        int cz = tri_grid_coord(world_z, nm->min_bounds[2], nm->tri_grid_cell, nm->tri_grid_h);
+        int cell = cz * nm->tri_grid_w + cx;
+
+        for (int k = nm->tri_grid_offsets[cell]; k < nm->tri_grid_offsets[cell + 1]; k++) {
+            int i = nm->tri_grid_items[k];
+            if (!nm->triangles[i].walkable) continue;
+            if (navmesh_point_in_triangle(nm, i, world_x, world_z)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Senza griglia (metadati non calcolati): ricerca lineare
     for (int i = 0; i < nm->triangle_count; i++) {
         if (!nm->triangles[i].walkable) continue;
         if (navmesh_point_in_triangle(nm, i, world_x, world_z)) {
@@ -357,6 +489,61 @@ int navmesh_find_triangle(NavMesh* nm, float world_x, float world_z) {
     return -1; // Non trovato
 }
 
+// Vicino di tri oltre lo spigolo (va, vb): -1 se bordo
+static int neighbor_across_edge(NavMesh* nm, int tri_index, int va, int vb) {
+    NavTriangle* tri = &nm->triangles[tri_index];
+    for (int k = 0; k < 3; k++) {
+        int n = tri->neighbors[k];
+        if (n < 0) continue;
+
+        int* nv = nm->triangles[n].vertices;
+        bool has_a = nv[0] == va || nv[1] == va || nv[2] == va;
+        bool has_b = nv[0] == vb || nv[1] == vb || nv[2] == vb;
+        if (has_a && has_b) return n;
+    }
+    return -1;
+}
+
+int navmesh_find_triangle_from(NavMesh* nm, int hint_tri, float world_x, float world_z) {
+    if (!nm) return -1;
+
+    // Walk: attraversa lo spigolo più lontano dal lato del punto, finché un
+    // triangolo lo contiene. Agenti fermi o quasi: 1-2 test invece della griglia
+    int current = hint_tri;
+    for (int step = 0; step < NAVMESH_WALK_MAX_STEPS; step++) {
+        if (current < 0 || current >= nm->triangle_count) break;
+        NavTriangle* tri = &nm->triangles[current];
+        if (!tri->walkable) break;
+        if (navmesh_point_in_triangle(nm, current, world_x, world_z)) return current;
+
+        int exit_edge = -1;
+        float worst = 0.0f;
+        for (int e = 0; e < 3; e++) {
+            float* a = nm->vertices[tri->vertices[e]].position;
+            float* b = nm->vertices[tri->vertices[(e + 1) % 3]].position;
+            float* c = nm->vertices[tri->vertices[(e + 2) % 3]].position;
+            float ex = b[0] - a[0];
+            float ez = b[2] - a[2];
+            float side_p = ex * (world_z - a[2]) - ez * (world_x - a[0]);
+            float side_c = ex * (c[2] - a[2]) - ez * (c[0] - a[0]);
+
+            // Punto dal lato opposto al terzo vertice: distanza (scalata) oltre lo spigolo
+            float outside = side_c > 0.0f ? -side_p : side_p;
+            float len = sqrtf(ex * ex + ez * ez);
+            if (len > 0.0f && outside / len > worst) {
+                worst = outside / len;
+                exit_edge = e;
+            }
+        }
+        if (exit_edge < 0) break;   // Triangolo degenere o punto sul bordo
+
+        current = neighbor_across_edge(nm, current,
+                                       tri->vertices[exit_edge], tri->vertices[(exit_edge + 1) % 3]);
+    }
+
+    return navmesh_find_triangle(nm, world_x, world_z);
+}
+
 float navmesh_get_height_on_triangle(NavMesh* nm, int tri_index, float x, float z) {
     if (tri_index < 0 || tri_index >= nm->triangle_count) return 0.0f;
 
@@ -561,7 +748,8 @@ void navmesh_smooth_path(Path* path, NavMesh* nm) {
     // Simple string pulling (line of sight test)
     // Questo è un placeholder - il vero funnel algorithm è più complesso
 
-    vec3* new_waypoints = (vec3*)malloc(path->capacity * sizeof(vec3));
+    // In place: il punto scelto non precede mai quelli ancora da leggere
+    vec3* new_waypoints = path->waypoints;
     int new_count = 0;
 
     // Aggiungi sempre il primo punto
@@ -591,9 +779,6 @@ void navmesh_smooth_path(Path* path, NavMesh* nm) {
         }
     }
 
-    // Sostituisci
-    free(path->waypoints);
-    path->waypoints = new_waypoints;
     path->waypoint_count = new_count;
 }
 
@@ -9,6 +9,14 @@
 // Forward declarations
 struct Level;
 
+// Griglia di ricerca dei triangoli: celle dimensionate per ~N triangoli
+// ciascuna, al massimo NAVMESH_GRID_MAX_DIM celle per lato
+#define NAVMESH_GRID_TRIS_PER_CELL 2
+#define NAVMESH_GRID_MAX_DIM 1024
+
+// Passi al massimo di navmesh_find_triangle_from prima della griglia
+#define NAVMESH_WALK_MAX_STEPS 8
+
 // ============================================================================
 // NAVMESH DATA STRUCTURES
 // ============================================================================
@@ -45,6 +53,14 @@ typedef struct NavMesh {
     // Metadati
     float grid_cell_size;     // Dimensione cella griglia usata per generare
     int layer_id;             // ID del layer (per multi-layer navmesh futuro)
+
+    // Griglia uniforme sui bounds XZ (navmesh_calculate_metadata): per ogni
+    // cella gli indici crescenti dei triangoli il cui AABB la tocca
+    int* tri_grid_offsets;    // tri_grid_w * tri_grid_h + 1, inizio della lista di ogni cella
+    int* tri_grid_items;
+    int tri_grid_w;
+    int tri_grid_h;
+    float tri_grid_cell;      // Lato della cella (m)
 } NavMesh;
 
 // ============================================================================
@@ -60,16 +76,23 @@ void navmesh_cleanup(NavMesh* nm);
 // Carica un navmesh da file (formato custom o OBJ)
 bool navmesh_load_from_file(NavMesh* nm, const char* filepath);
 
-// Calcola bounds e metadati dopo il caricamento
+// Calcola bounds, metadati e griglia dei triangoli dopo il caricamento
+// (da richiamare se vertici o triangoli cambiano)
 void navmesh_calculate_metadata(NavMesh* nm);
 
 // ============================================================================
 // NAVMESH QUERIES
 // ============================================================================
 
-// Trova il triangolo che contiene un punto world (x, z)
+// Trova il triangolo walkable che contiene un punto world (x, z): solo i
+// triangoli della cella della griglia. A parità, il primo in ordine di indice
 int navmesh_find_triangle(NavMesh* nm, float world_x, float world_z);
 
+// Come navmesh_find_triangle, partendo dall'ultimo triangolo noto di un agente
+// (hint_tri, -1 = nessuno): cammina sui vicini verso il punto per al massimo
+// NAVMESH_WALK_MAX_STEPS triangoli, poi usa la griglia
+int navmesh_find_triangle_from(NavMesh* nm, int hint_tri, float world_x, float world_z);
+
 // Verifica se un punto è dentro un triangolo (test 2D su piano XZ)
 bool navmesh_point_in_triangle(NavMesh* nm, int tri_index, float x, float z);
 
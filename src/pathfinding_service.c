@@ -0,0 +1,502 @@
+#include "pathfinding_service.h"
+#include "level.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+// ============================================================================
+// INTERNAL STRUCTURES
+// ============================================================================
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE,
+    SLOT_FAILED
+} SlotState;
+
+typedef struct {
+    SlotState state;
+    uint16_t generation;     // Incrementata ad ogni riuso (invalida handle vecchi)
+    bool cancelled;          // Richiesta annullata mentre era in coda/esecuzione
+
+    vec3 start;
+    vec3 goal;
+    int zone_id;
+
+    Path* result;
+} PathRequestSlot;
+
+typedef struct {
+    pthread_t thread;
+    PathfindingContext* ctx; // Contesto privato del worker
+} PathWorker;
+
+static struct {
+    bool running;
+    bool shutting_down;
+    struct Level* level;
+
+    PathWorker workers[PATH_SERVICE_MAX_WORKERS];
+    int worker_count;
+
+    // Slot richieste + free list
+    PathRequestSlot slots[PATH_SERVICE_MAX_REQUESTS];
+    int free_list[PATH_SERVICE_MAX_REQUESTS];
+    int free_count;
+
+    // Coda FIFO di indici slot (ring buffer)
+    int queue[PATH_SERVICE_MAX_REQUESTS];
+    int queue_head;
+    int queue_count;
+
+    int active_jobs;         // Richieste (o fette di batch) in esecuzione sui worker
+
+    // Batch in corso (uno alla volta): fetta j = order[job_start[j] .. job_start[j + 1]),
+    // richieste con la stessa finestra consecutive
+    struct {
+        const PathBatchRequest* requests;   // NULL = nessun batch
+        Path** results;
+        const int* order;
+        const int* job_start;
+        int job_count;
+        int next_job;
+        int jobs_done;
+    } batch;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   // Segnala nuovo lavoro / shutdown
+    pthread_cond_t idle_cond;   // Segnala coda vuota e nessun job attivo
+    pthread_cond_t batch_cond;  // Segnala batch completato / slot batch libero
+} g_service;
+
+// ============================================================================
+// HANDLE HELPERS
+// ============================================================================
+
+static PathRequestHandle make_handle(int index, uint16_t generation) {
+    return ((uint32_t)generation << 16) | (uint32_t)(index + 1);
+}
+
+// Ritorna l'indice dello slot o -1 se l'handle non è (più) valido.
+// Da chiamare con il lock acquisito.
+static int resolve_handle(PathRequestHandle handle) {
+    if (handle == PATH_REQUEST_INVALID_HANDLE) return -1;
+
+    int index = (int)(handle & 0xFFFF) - 1;
+    uint16_t generation = (uint16_t)(handle >> 16);
+
+    if (index < 0 || index >= PATH_SERVICE_MAX_REQUESTS) return -1;
+
+    PathRequestSlot* slot = &g_service.slots[index];
+    if (slot->state == SLOT_FREE || slot->generation != generation) return -1;
+
+    return index;
+}
+
+// Rimette lo slot nella free list. Da chiamare con il lock acquisito.
+static void release_slot(int index) {
+    PathRequestSlot* slot = &g_service.slots[index];
+    slot->state = SLOT_FREE;
+    slot->cancelled = false;
+    slot->result = NULL;
+    slot->generation++;
+    if (slot->generation == 0) slot->generation = 1;   // Evita handle == 0
+    g_service.free_list[g_service.free_count++] = index;
+}
+
+// Fette di batch ancora da assegnare. Da chiamare con il lock acquisito.
+static bool batch_pending(void) {
+    return g_service.batch.requests && g_service.batch.next_job < g_service.batch.job_count;
+}
+
+// Nessuna richiesta in coda o in esecuzione. Da chiamare con il lock acquisito.
+static bool service_idle(void) {
+    return g_service.queue_count == 0 && g_service.active_jobs == 0 && !batch_pending();
+}
+
+static int detect_worker_count(void) {
+    int cores;
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cores = (int)info.dwNumberOfProcessors;
+#else
+    cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    // Lascia un core al main thread (rendering + logica)
+    int count = cores - 1;
+    if (count < 1) count = 1;
+    return count;
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+static void* worker_main(void* arg) {
+    PathWorker* worker = (PathWorker*)arg;
+
+    pthread_mutex_lock(&g_service.lock);
+
+    while (true) {
+        while (!g_service.shutting_down && g_service.queue_count == 0 && !batch_pending()) {
+            pthread_cond_wait(&g_service.work_cond, &g_service.lock);
+        }
+        if (g_service.shutting_down) break;
+
+        // Prima le fette del batch: il chiamante è bloccato ad aspettarle
+        if (batch_pending()) {
+            int job = g_service.batch.next_job++;
+            int begin = g_service.batch.job_start[job];
+            int end = g_service.batch.job_start[job + 1];
+            const PathBatchRequest* requests = g_service.batch.requests;
+            Path** results = g_service.batch.results;
+            const int* order = g_service.batch.order;
+            struct Level* lvl = g_service.level;
+            g_service.active_jobs++;
+
+            // Ogni richiesta scrive solo il proprio risultato: nessun lock
+            pthread_mutex_unlock(&g_service.lock);
+            for (int i = begin; i < end; i++) {
+                const PathBatchRequest* req = &requests[order[i]];
+                vec3 start, goal;
+                glm_vec3_copy((float*)req->start, start);
+                glm_vec3_copy((float*)req->goal, goal);
+                results[order[i]] = pathfinding_find_path_ctx_ex(worker->ctx, lvl, start, goal, &req->params);
+            }
+            pthread_mutex_lock(&g_service.lock);
+
+            g_service.active_jobs--;
+            if (++g_service.batch.jobs_done == g_service.batch.job_count) {
+                pthread_cond_broadcast(&g_service.batch_cond);
+            }
+            if (service_idle()) pthread_cond_broadcast(&g_service.idle_cond);
+            continue;
+        }
+
+        // Estrai la prossima richiesta
+        int index = g_service.queue[g_service.queue_head];
+        g_service.queue_head = (g_service.queue_head + 1) % PATH_SERVICE_MAX_REQUESTS;
+        g_service.queue_count--;
+
+        PathRequestSlot* slot = &g_service.slots[index];
+
+        // Annullata mentre era in coda: niente da calcolare
+        if (slot->cancelled) {
+            release_slot(index);
+            if (service_idle()) pthread_cond_broadcast(&g_service.idle_cond);
+            continue;
+        }
+
+        slot->state = SLOT_RUNNING;
+        g_service.active_jobs++;
+
+        vec3 start, goal;
+        glm_vec3_copy(slot->start, start);
+        glm_vec3_copy(slot->goal, goal);
+        int zone_id = slot->zone_id;
+        struct Level* lvl = g_service.level;
+
+        // Calcolo fuori dal lock: il contesto è privato del worker
+        pthread_mutex_unlock(&g_service.lock);
+        Path* path = pathfinding_find_path_ctx(worker->ctx, lvl, start, goal, zone_id);
+        pthread_mutex_lock(&g_service.lock);
+
+        if (slot->cancelled) {
+            path_free(path);
+            release_slot(index);
+        } else {
+            slot->result = path;
+            slot->state = path ? SLOT_DONE : SLOT_FAILED;
+        }
+
+        g_service.active_jobs--;
+        if (service_idle()) pthread_cond_broadcast(&g_service.idle_cond);
+    }
+
+    pthread_mutex_unlock(&g_service.lock);
+    return NULL;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool path_service_init(struct Level* lvl, int worker_count) {
+    if (g_service.running) {
+        printf("[PathService] WARNING: Service already running\n");
+        return true;
+    }
+    if (!lvl) return false;
+
+    memset(&g_service, 0, sizeof(g_service));
+
+    if (worker_count <= 0) worker_count = detect_worker_count();
+    if (worker_count > PATH_SERVICE_MAX_WORKERS) worker_count = PATH_SERVICE_MAX_WORKERS;
+
+    g_service.level = lvl;
+
+    for (int i = 0; i < PATH_SERVICE_MAX_REQUESTS; i++) {
+        g_service.slots[i].generation = 1;
+        g_service.free_list[i] = PATH_SERVICE_MAX_REQUESTS - 1 - i;
+    }
+    g_service.free_count = PATH_SERVICE_MAX_REQUESTS;
+
+    pthread_mutex_init(&g_service.lock, NULL);
+    pthread_cond_init(&g_service.work_cond, NULL);
+    pthread_cond_init(&g_service.idle_cond, NULL);
+    pthread_cond_init(&g_service.batch_cond, NULL);
+
+    g_service.running = true;
+
+    for (int i = 0; i < worker_count; i++) {
+        PathWorker* worker = &g_service.workers[i];
+        worker->ctx = pathfinding_context_create();
+        if (!worker->ctx) break;
+
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            printf("[PathService] ERROR: Failed to start worker %d\n", i);
+            pathfinding_context_destroy(worker->ctx);
+            worker->ctx = NULL;
+            break;
+        }
+        g_service.worker_count++;
+    }
+
+    if (g_service.worker_count == 0) {
+        printf("[PathService] ERROR: No workers available\n");
+        path_service_shutdown();
+        return false;
+    }
+
+    printf("[PathService] Started %d worker(s)\n", g_service.worker_count);
+    return true;
+}
+
+void path_service_shutdown(void) {
+    if (!g_service.running) return;
+
+    pthread_mutex_lock(&g_service.lock);
+    g_service.shutting_down = true;
+    pthread_cond_broadcast(&g_service.work_cond);
+    pthread_mutex_unlock(&g_service.lock);
+
+    for (int i = 0; i < g_service.worker_count; i++) {
+        pthread_join(g_service.workers[i].thread, NULL);
+        pathfinding_context_destroy(g_service.workers[i].ctx);
+        g_service.workers[i].ctx = NULL;
+    }
+
+    // Libera i risultati mai ritirati
+    for (int i = 0; i < PATH_SERVICE_MAX_REQUESTS; i++) {
+        if (g_service.slots[i].result) {
+            path_free(g_service.slots[i].result);
+            g_service.slots[i].result = NULL;
+        }
+    }
+
+    pthread_cond_destroy(&g_service.work_cond);
+    pthread_cond_destroy(&g_service.idle_cond);
+    pthread_cond_destroy(&g_service.batch_cond);
+    pthread_mutex_destroy(&g_service.lock);
+
+    g_service.running = false;
+    g_service.worker_count = 0;
+    g_service.level = NULL;
+
+    printf("[PathService] Shutdown\n");
+}
+
+PathRequestHandle path_service_submit(vec3 start, vec3 goal, int zone_id) {
+    if (!g_service.running) return PATH_REQUEST_INVALID_HANDLE;
+
+    // Con edit in attesa i worker sono fermi (gli edit richiedono il servizio
+    // inattivo): i listener aggiornano HPA*/zone prima che li leggano
+    pathfinding_flush_changes();
+
+    pthread_mutex_lock(&g_service.lock);
+
+    if (g_service.free_count == 0) {
+        pthread_mutex_unlock(&g_service.lock);
+        printf("[PathService] WARNING: Request queue full\n");
+        return PATH_REQUEST_INVALID_HANDLE;
+    }
+
+    int index = g_service.free_list[--g_service.free_count];
+    PathRequestSlot* slot = &g_service.slots[index];
+
+    slot->state = SLOT_QUEUED;
+    slot->cancelled = false;
+    slot->result = NULL;
+    glm_vec3_copy(start, slot->start);
+    glm_vec3_copy(goal, slot->goal);
+    slot->zone_id = zone_id;
+
+    int tail = (g_service.queue_head + g_service.queue_count) % PATH_SERVICE_MAX_REQUESTS;
+    g_service.queue[tail] = index;
+    g_service.queue_count++;
+
+    PathRequestHandle handle = make_handle(index, slot->generation);
+
+    pthread_cond_signal(&g_service.work_cond);
+    pthread_mutex_unlock(&g_service.lock);
+
+    return handle;
+}
+
+PathRequestStatus path_service_poll(PathRequestHandle handle, Path** out_path) {
+    if (out_path) *out_path = NULL;
+    if (!g_service.running) return PATH_REQUEST_INVALID;
+
+    pthread_mutex_lock(&g_service.lock);
+
+    int index = resolve_handle(handle);
+    if (index < 0 || g_service.slots[index].cancelled) {
+        pthread_mutex_unlock(&g_service.lock);
+        return PATH_REQUEST_INVALID;
+    }
+
+    PathRequestSlot* slot = &g_service.slots[index];
+    PathRequestStatus status;
+
+    switch (slot->state) {
+    case SLOT_DONE:
+        status = PATH_REQUEST_DONE;
+        if (out_path) {
+            *out_path = slot->result;
+        } else {
+            path_free(slot->result);
+        }
+        slot->result = NULL;
+        release_slot(index);
+        break;
+
+    case SLOT_FAILED:
+        status = PATH_REQUEST_FAILED;
+        release_slot(index);
+        break;
+
+    default:
+        status = PATH_REQUEST_PENDING;
+        break;
+    }
+
+    pthread_mutex_unlock(&g_service.lock);
+    return status;
+}
+
+void path_service_cancel(PathRequestHandle handle) {
+    if (!g_service.running) return;
+
+    pthread_mutex_lock(&g_service.lock);
+
+    int index = resolve_handle(handle);
+    if (index >= 0) {
+        PathRequestSlot* slot = &g_service.slots[index];
+        if (slot->state == SLOT_DONE || slot->state == SLOT_FAILED) {
+            // Già completata: libera subito
+            path_free(slot->result);
+            slot->result = NULL;
+            release_slot(index);
+        } else {
+            // In coda o in esecuzione: ci pensa il worker
+            slot->cancelled = true;
+        }
+    }
+
+    pthread_mutex_unlock(&g_service.lock);
+}
+
+bool path_service_find_paths(const PathBatchRequest* requests, int count, Path** results) {
+    if (!results || count <= 0) return false;
+    for (int i = 0; i < count; i++) results[i] = NULL;
+    if (!g_service.running || !requests) return false;
+    pathfinding_flush_changes();
+
+    // order, inizio dei gruppi e inizio delle fette in un solo blocco
+    int* order = (int*)malloc((3 * count + 2) * sizeof(int));
+    if (!order) {
+        printf("[PathService] ERROR: Failed to allocate batch of %d requests\n", count);
+        return false;
+    }
+    int* group_start = order + count;
+    int* job_start = group_start + count + 1;
+
+    int groups = pathfinding_batch_order(g_service.level, requests, count, order, group_start);
+
+    // Gruppi grandi divisi in fette per tenere occupati tutti i worker
+    // (ognuna ricostruisce la finestra una volta sola)
+    int slice = (count + g_service.worker_count - 1) / g_service.worker_count;
+    int job_count = 0;
+    for (int g = 0; g < groups; g++) {
+        for (int i = group_start[g]; i < group_start[g + 1]; i += slice) {
+            job_start[job_count++] = i;
+        }
+    }
+    job_start[job_count] = count;
+
+    pthread_mutex_lock(&g_service.lock);
+
+    // Un batch alla volta
+    while (g_service.batch.requests) {
+        pthread_cond_wait(&g_service.batch_cond, &g_service.lock);
+    }
+
+    g_service.batch.requests = requests;
+    g_service.batch.results = results;
+    g_service.batch.order = order;
+    g_service.batch.job_start = job_start;
+    g_service.batch.job_count = job_count;
+    g_service.batch.next_job = 0;
+    g_service.batch.jobs_done = 0;
+    pthread_cond_broadcast(&g_service.work_cond);
+
+    while (g_service.batch.jobs_done < g_service.batch.job_count) {
+        pthread_cond_wait(&g_service.batch_cond, &g_service.lock);
+    }
+
+    g_service.batch.requests = NULL;
+    pthread_cond_broadcast(&g_service.batch_cond);
+    pthread_mutex_unlock(&g_service.lock);
+
+    free(order);
+    return true;
+}
+
+void path_service_wait_idle(void) {
+    if (!g_service.running) return;
+
+    pthread_mutex_lock(&g_service.lock);
+    while (!service_idle()) {
+        pthread_cond_wait(&g_service.idle_cond, &g_service.lock);
+    }
+    pthread_mutex_unlock(&g_service.lock);
+}
+
+int path_service_worker_count(void) {
+    return g_service.running ? g_service.worker_count : 0;
+}
+
+void path_service_print_stats(void) {
+    if (!g_service.running) {
+        printf("[PathService] Not running\n");
+        return;
+    }
+
+    // Le statistiche sono scritte dai worker: leggile a servizio fermo
+    path_service_wait_idle();
+
+    printf("[PathService] Stats (%d workers):\n", g_service.worker_count);
+    for (int i = 0; i < g_service.worker_count; i++) {
+        printf(" Worker %d:\n", i);
+        pathfinding_context_print_stats(g_service.workers[i].ctx);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef PATHFINDING_SERVICE_H
+#define PATHFINDING_SERVICE_H
+
+/*
+ * PATH SERVICE
+ * ============
+ *
+ * Servizio richiesta/risposta per calcolare path su più worker thread.
+ * - Ogni worker possiede il proprio PathfindingContext (griglia, stato per cella, open set)
+ * - Il chiamante invia coppie start/goal e ottiene un handle da interrogare
+ * - I risultati sono identici a pathfinding_find_path (stesso codice A*)
+ * - Batch di richieste (path_service_find_paths) distribuiti a fette tra i worker
+ *
+ * Il livello viene letto dai worker senza lock: non modificare la walkability
+ * mentre ci sono richieste in corso (usare path_service_wait_idle prima).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+#include "pathfinding.h"
+
+struct Level;
+
+#define PATH_SERVICE_MAX_WORKERS  8
+#define PATH_SERVICE_MAX_REQUESTS 1024   // Richieste contemporanee (potenza di 2)
+
+// Handle opaco: indice slot + generazione (0 = handle non valido)
+typedef uint32_t PathRequestHandle;
+#define PATH_REQUEST_INVALID_HANDLE 0
+
+typedef enum {
+    PATH_REQUEST_INVALID,   // Handle sconosciuto, scaduto o già consumato
+    PATH_REQUEST_PENDING,   // In coda o in esecuzione
+    PATH_REQUEST_DONE,      // Path pronto (ownership passata al chiamante)
+    PATH_REQUEST_FAILED     // Nessun path trovato
+} PathRequestStatus;
+
+// Avvia i worker. worker_count <= 0 = automatico (core disponibili - 1)
+bool path_service_init(struct Level* lvl, int worker_count);
+
+// Ferma i worker e libera tutte le richieste pendenti
+void path_service_shutdown(void);
+
+// Accoda una richiesta. Ritorna PATH_REQUEST_INVALID_HANDLE se la coda è piena
+PathRequestHandle path_service_submit(vec3 start, vec3 goal, int zone_id);
+
+// Interroga una richiesta. Se DONE, *out_path riceve il path (da liberare
+// con path_free) e l'handle diventa invalido. Anche FAILED consuma l'handle.
+PathRequestStatus path_service_poll(PathRequestHandle handle, Path** out_path);
+
+// Annulla una richiesta (il path eventualmente calcolato viene scartato)
+void path_service_cancel(PathRequestHandle handle);
+
+// Batch sincrono sui worker (vedi pathfinding_find_paths): le richieste con la
+// stessa finestra di chunk vengono divise in poche fette consecutive, così ogni
+// worker copia la finestra una volta per fetta. Blocca fino al termine; i
+// risultati sono identici a pathfinding_find_paths. false se il servizio non è
+// avviato o manca memoria (results tutti NULL).
+bool path_service_find_paths(const PathBatchRequest* requests, int count, Path** results);
+
+// Blocca finché tutte le richieste accodate sono state elaborate
+void path_service_wait_idle(void);
+
+// Numero di worker attivi (0 se il servizio non è avviato)
+int path_service_worker_count(void);
+
+// Statistiche aggregate dei worker
+void path_service_print_stats(void);
+
+#endif // PATHFINDING_SERVICE_H
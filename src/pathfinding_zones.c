@@ -0,0 +1,264 @@
+#include "pathfinding_zones.h"
+#include "pathfinding.h"
+#include "level.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// FLOOD FILL
+// ============================================================================
+
+// Walkability di una cella globale (dentro il livello) letta dal pathgrid del chunk
+static inline bool zone_walkable(struct Level* lvl, int x, int z) {
+    const uint8_t* grid = lvl->chunks[(z / PATHGRID_SIZE) * lvl->chunksCountX + x / PATHGRID_SIZE].pathgrid.grid;
+    return grid && grid[(z % PATHGRID_SIZE) * PATHGRID_SIZE + x % PATHGRID_SIZE] != 0;
+}
+
+// Etichetta con label tutte le celle walkable raggiungibili da seed che non
+// hanno già un'etichetta >= min_label (8-connected, come l'A*).
+// Ritorna le celle etichettate.
+static int flood_fill(ZoneMap* zm, struct Level* lvl, int seed, int32_t label, int32_t min_label) {
+    int head = 0, tail = 0;
+    zm->labels[seed] = label;
+    zm->queue[tail++] = seed;
+
+    while (head < tail) {
+        int cell = zm->queue[head++];
+        int x = cell % zm->width;
+        int z = cell / zm->width;
+
+        for (int dz = -1; dz <= 1; dz++) {
+            int nz = z + dz;
+            if (nz < 0 || nz >= zm->height) continue;
+            for (int dx = -1; dx <= 1; dx++) {
+                int nx = x + dx;
+                if ((dx == 0 && dz == 0) || nx < 0 || nx >= zm->width) continue;
+
+                int n = nz * zm->width + nx;
+                if (zm->labels[n] >= min_label || !zone_walkable(lvl, nx, nz)) continue;
+
+                zm->labels[n] = label;
+                zm->queue[tail++] = n;
+            }
+        }
+    }
+    return tail;
+}
+
+// Aggiornamento locale: componenti connesse delle celle walkable del
+// rettangolo modificato allargato di 1 (E), calcolate dentro E. Le celle
+// dell'anello (E meno il rettangolo) non sono cambiate e hanno etichette
+// valide. Se ogni componente locale tocca al più un'etichetta dell'anello e
+// ogni etichetta sta in una sola componente locale, la modifica non può aver
+// spezzato o unito zone (ogni path tra celle dell'anello si può riportare
+// dentro E): basta rietichettare le celle del rettangolo. Altrimenti ritorna
+// false e serve la rietichettatura delle componenti toccate.
+static bool zones_update_local(ZoneMap* zm, struct Level* lvl, int x0, int z0, int x1, int z1) {
+    int ex0 = x0 > 0 ? x0 - 1 : x0;
+    int ez0 = z0 > 0 ? z0 - 1 : z0;
+    int ex1 = x1 < zm->width - 1 ? x1 + 1 : x1;
+    int ez1 = z1 < zm->height - 1 ? z1 + 1 : z1;
+    int ew = ex1 - ex0 + 1;
+    int eh = ez1 - ez0 + 1;
+
+    // Per cella di E: componente locale (-1 = bloccata o non visitata).
+    // Per componente: etichetta dell'anello (ZONE_NONE = nessuna)
+    int* comp = (int*)malloc(ew * eh * sizeof(int));
+    int32_t* comp_label = (int32_t*)malloc(ew * eh * sizeof(int32_t));
+    if (!comp || !comp_label) {
+        free(comp);
+        free(comp_label);
+        return false;
+    }
+    for (int i = 0; i < ew * eh; i++) comp[i] = -1;
+
+    bool local = true;
+    int comp_count = 0;
+
+    for (int seed = 0; local && seed < ew * eh; seed++) {
+        if (comp[seed] >= 0 || !zone_walkable(lvl, ex0 + seed % ew, ez0 + seed / ew)) continue;
+
+        int k = comp_count++;
+        comp_label[k] = ZONE_NONE;
+        comp[seed] = k;
+
+        int head = 0, tail = 0;
+        zm->queue[tail++] = seed;
+        while (local && head < tail) {
+            int cell = zm->queue[head++];
+            int lx = cell % ew, lz = cell / ew;
+            int x = ex0 + lx, z = ez0 + lz;
+
+            if (x < x0 || x > x1 || z < z0 || z > z1) {
+                int32_t label = zm->labels[z * zm->width + x];
+                if (comp_label[k] == ZONE_NONE) {
+                    // Etichetta già presa da un'altra componente: possibile divisione
+                    for (int j = 0; j < k; j++) {
+                        if (comp_label[j] == label) local = false;
+                    }
+                    comp_label[k] = label;
+                } else if (comp_label[k] != label) {
+                    local = false;   // Due zone ora collegate
+                }
+            }
+
+            for (int dz = -1; dz <= 1; dz++) {
+                int nz = lz + dz;
+                if (nz < 0 || nz >= eh) continue;
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = lx + dx;
+                    if ((dx == 0 && dz == 0) || nx < 0 || nx >= ew) continue;
+
+                    int n = nz * ew + nx;
+                    if (comp[n] >= 0 || !zone_walkable(lvl, ex0 + nx, ez0 + nz)) continue;
+                    comp[n] = k;
+                    zm->queue[tail++] = n;
+                }
+            }
+        }
+    }
+
+    if (local) {
+        // Celle del rettangolo: zona della propria componente locale, nuova
+        // per le sacche che non toccano l'anello
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                int k = comp[(z - ez0) * ew + (x - ex0)];
+                int32_t* label = &zm->labels[z * zm->width + x];
+                if (k < 0) {
+                    *label = ZONE_NONE;
+                    continue;
+                }
+                if (comp_label[k] == ZONE_NONE) comp_label[k] = zm->next_label++;
+                *label = comp_label[k];
+            }
+        }
+    }
+
+    free(comp);
+    free(comp_label);
+    return local;
+}
+
+// ============================================================================
+// BUILD / UPDATE
+// ============================================================================
+
+// Listener delle modifiche di walkability
+static void on_walkability_changed(struct Level* lvl, int x0, int z0, int x1, int z1, void* user) {
+    (void)user;
+    zones_update_region(lvl, x0, z0, x1, z1);
+}
+
+bool zones_build(struct Level* lvl) {
+    if (!lvl || !lvl->chunks) return false;
+
+    static bool listener_registered = false;
+    if (!listener_registered) {
+        listener_registered = pathfinding_add_change_listener(on_walkability_changed, NULL);
+    }
+
+    zones_destroy(lvl);
+
+    double t_start = get_time_ms();
+
+    ZoneMap* zm = (ZoneMap*)calloc(1, sizeof(ZoneMap));
+    if (!zm) return false;
+
+    zm->width = pathfinding_level_cells_x(lvl);
+    zm->height = pathfinding_level_cells_z(lvl);
+    int cells = zm->width * zm->height;
+
+    zm->labels = (int32_t*)calloc(cells, sizeof(int32_t));
+    zm->queue = (int*)malloc(cells * sizeof(int));
+    if (!zm->labels || !zm->queue) {
+        printf("[Zones] ERROR: Failed to allocate zone map (%d cells)\n", cells);
+        free(zm->labels);
+        free(zm->queue);
+        free(zm);
+        return false;
+    }
+
+    zm->next_label = ZONE_NONE + 1;
+    int zone_count = 0;
+    for (int i = 0; i < cells; i++) {
+        if (zm->labels[i] != ZONE_NONE || !zone_walkable(lvl, i % zm->width, i / zm->width)) continue;
+        flood_fill(zm, lvl, i, zm->next_label++, ZONE_NONE + 1);
+        zone_count++;
+    }
+
+    lvl->zoneMap = zm;
+
+    printf("[Zones] Labeled %d connected zones on %dx%d cells (%.2fms)\n",
+           zone_count, zm->width, zm->height, (float)(get_time_ms() - t_start));
+    return true;
+}
+
+bool zones_update_region(struct Level* lvl, int x0, int z0, int x1, int z1) {
+    if (!lvl || !lvl->zoneMap) return false;
+    ZoneMap* zm = lvl->zoneMap;
+
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= zm->width) x1 = zm->width - 1;
+    if (z1 >= zm->height) z1 = zm->height - 1;
+    if (x0 > x1 || z0 > z1) return true;
+
+    // Caso comune (struttura in campo aperto): O(area della modifica)
+    if (zones_update_local(zm, lvl, x0, z0, x1, z1)) return true;
+
+    // Ogni componente toccata dalla modifica (spezzata o unita) ha almeno una
+    // cella nel rettangolo allargato di 1: ripartendo da lì con etichette
+    // nuove si rietichettano solo quelle, le altre restano valide
+    if (x0 > 0) x0--;
+    if (z0 > 0) z0--;
+    if (x1 < zm->width - 1) x1++;
+    if (z1 < zm->height - 1) z1++;
+
+    int32_t first_new = zm->next_label;
+
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            int i = z * zm->width + x;
+            if (!zone_walkable(lvl, x, z)) {
+                zm->labels[i] = ZONE_NONE;
+                continue;
+            }
+            if (zm->labels[i] >= first_new) continue;  // Già rietichettata
+            flood_fill(zm, lvl, i, zm->next_label++, first_new);
+        }
+    }
+    return true;
+}
+
+void zones_destroy(struct Level* lvl) {
+    if (!lvl || !lvl->zoneMap) return;
+    free(lvl->zoneMap->labels);
+    free(lvl->zoneMap->queue);
+    free(lvl->zoneMap);
+    lvl->zoneMap = NULL;
+}
+
+// ============================================================================
+// QUERY
+// ============================================================================
+
+int zones_get_cell(struct Level* lvl, int cell_x, int cell_z) {
+    if (!lvl || !lvl->zoneMap) return ZONE_NONE;
+    ZoneMap* zm = lvl->zoneMap;
+    if (cell_x < 0 || cell_x >= zm->width || cell_z < 0 || cell_z >= zm->height) return ZONE_NONE;
+    return zm->labels[cell_z * zm->width + cell_x];
+}
+
+int zones_get(struct Level* lvl, vec3 world_pos) {
+    int cell_x, cell_z;
+    if (!lvl || !pathfinding_level_world_to_cell(lvl, world_pos, &cell_x, &cell_z)) return ZONE_NONE;
+    return zones_get_cell(lvl, cell_x, cell_z);
+}
+
+bool zones_connected(struct Level* lvl, vec3 a, vec3 b) {
+    int zone_a = zones_get(lvl, a);
+    return zone_a != ZONE_NONE && zone_a == zones_get(lvl, b);
+}
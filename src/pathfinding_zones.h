@@ -0,0 +1,56 @@
+#ifndef PATHFINDING_ZONES_H
+#define PATHFINDING_ZONES_H
+
+/*
+ * ZONE (componenti connesse)
+ * ==========================
+ *
+ * Etichetta ogni cella walkable del livello con l'indice della propria
+ * componente connessa (stessa connettività 8-way dell'A*). Due celle con
+ * etichette diverse non sono collegate da nessun path: la query viene
+ * rifiutata in O(1) invece di esplorare tutta la finestra prima di fallire
+ * (isole, cortili chiusi, click sbagliati).
+ *
+ * L'etichetta è anche lo zone_id di pathfinding_find_path: zone_id >= 0
+ * limita la query a start e goal dentro quella zona.
+ *
+ * Costruite da level_load, liberate da level_cleanup e aggiornate dalle
+ * modifiche di walkability: se un test locale esclude divisioni e unioni
+ * vengono rietichettate solo le celle modificate, altrimenti le componenti
+ * toccate.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+
+struct Level;
+
+#define ZONE_NONE 0   // Cella bloccata o fuori livello
+
+typedef struct ZoneMap {
+    int width, height;         // Celle globali del livello
+    int32_t* labels;           // ZONE_NONE o etichetta componente (row-major)
+    int32_t next_label;        // Etichette mai riusate (crescono a ogni aggiornamento)
+    int* queue;                // Scratch della flood fill (width * height)
+} ZoneMap;
+
+// Etichetta tutte le celle del livello (sostituisce la mappa esistente)
+bool zones_build(struct Level* lvl);
+
+// Aggiorna le etichette dopo una modifica del rettangolo di celle globali:
+// O(area) se la modifica non può dividere o unire zone, altrimenti
+// rietichetta le componenti che lo toccano. Chiamata dal listener delle
+// modifiche di walkability (pathfinding_flush_changes).
+bool zones_update_region(struct Level* lvl, int x0, int z0, int x1, int z1);
+
+void zones_destroy(struct Level* lvl);
+
+// Zona di una cella globale / posizione world (ZONE_NONE se bloccata o fuori)
+int zones_get_cell(struct Level* lvl, int cell_x, int cell_z);
+int zones_get(struct Level* lvl, vec3 world_pos);
+
+// true se esiste un path tra le due posizioni (stessa zona, entrambe walkable)
+bool zones_connected(struct Level* lvl, vec3 a, vec3 b);
+
+#endif // PATHFINDING_ZONES_H
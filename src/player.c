@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <math.h>
 
+// Budget per frame della ricerca path del player (2ms su ~16ms)
+#define PLAYER_PATH_BUDGET_US 2000.0f
+
 /*
 
 // =============================================================
@@ -323,6 +326,9 @@ void player_init(Player *p)
     // Pathfinding
     p->current_path = NULL;
     p->current_waypoint = 0;
+    p->pending_search = NULL;
+    p->corridor = NULL;
+    p->corridor_pending = false;
 
     // Stats
     p->hp = 100;
@@ -441,26 +447,13 @@ void player_handle_input(Player *p, Game *g, mat4 view, mat4 proj, Level *level)
         vec3 hitPoint;
         if (ray_level_intersect(level, rayOrigin, rayDir, hitPoint))
         {
-            // Verifica se il punto è camminabile
-            if (!level || level_is_walkable(level, hitPoint[0], hitPoint[2]))
-            {
-                // Richiedi path tramite pathfinding
-                Path* path = pathfinding_find_path(level, p->position, hitPoint, -1);
-
-                if (path && path->waypoint_count > 0) {
-                    player_set_path(p, path);
-                    printf("[Player] Pathfinding: Found path with %d waypoints to (%.1f, %.1f, %.1f)\n",
-                           path->waypoint_count, hitPoint[0], hitPoint[1], hitPoint[2]);
-                } else {
-                    printf("[Player] Pathfinding: No path found to target!\n");
-                    // Libera path se allocation fallita
-                    if (path) path_free(path);
-                }
-            }
-            else
-            {
-                printf("[Player] Target not walkable!\n");
-            }
+            // Richiedi path tramite pathfinding: la ricerca avanza a
+            // fette in player_update (un nuovo click annulla la precedente).
+            // Click su muri o rocce: il player va al punto raggiungibile più vicino.
+            pathfinding_search_end(p->pending_search);
+            PathQueryParams params = pathfinding_query_defaults();
+            params.flags |= PATH_QUERY_NEAREST;
+            p->pending_search = pathfinding_search_begin(level, p->position, hitPoint, &params);
         }
     }
 
@@ -483,8 +476,49 @@ void player_handle_input(Player *p, Game *g, mat4 view, mat4 proj, Level *level)
 // UPDATE
 // ============================================================================
 
+// Avanza la ricerca path in corso entro il budget del frame
+static void player_update_path_search(Player *p)
+{
+    PathSearchStatus status = pathfinding_search_step(p->pending_search, 0, PLAYER_PATH_BUDGET_US);
+    if (status == PATH_STATUS_IN_PROGRESS) return;
+
+    Path* path = pathfinding_search_take_path(p->pending_search);
+    pathfinding_search_end(p->pending_search);
+    p->pending_search = NULL;
+
+    if (path && path->waypoint_count > 0) {
+        vec3* target = &path->waypoints[path->waypoint_count - 1];
+        printf("[Player] Pathfinding: Found %spath with %d waypoints to (%.1f, %.1f, %.1f)\n",
+               path->partial ? "partial " : "", path->waypoint_count, (*target)[0], (*target)[1], (*target)[2]);
+        player_set_path(p, path);
+    } else {
+        printf("[Player] Pathfinding: No path found to target!\n");
+        // Libera path se allocation fallita
+        if (path) path_free(path);
+    }
+}
+
+// Corridoio rotto (riparazione locale impossibile): nuova ricerca globale
+// verso lo stesso goal, a fette come quella del click
+static void player_replan(Player *p, Level *level)
+{
+    vec3 goal;
+    corridor_get_goal(p->corridor, goal);
+    printf("[Player] Pathfinding: Corridor broken, replanning to (%.1f, %.1f, %.1f)\n", goal[0], goal[1], goal[2]);
+
+    player_clear_path(p);
+    PathQueryParams params = pathfinding_query_defaults();
+    params.flags |= PATH_QUERY_NEAREST;
+    p->pending_search = pathfinding_search_begin(level, p->position, goal, &params);
+}
+
 void player_update(Player *p, float dt, Level *level)
 {
+    if (p->pending_search)
+    {
+        player_update_path_search(p);
+    }
+
     // Se non abbiamo path o waypoint, resta in idle
     if (!p->current_path || p->current_waypoint >= p->current_path->waypoint_count)
     {
@@ -502,8 +536,35 @@ void player_update(Player *p, float dt, Level *level)
         return;
     }
 
-    // Prendi il prossimo waypoint come target
-    vec3* waypoint = &p->current_path->waypoints[p->current_waypoint];
+    // Corridoio lungo il path: ripara localmente le spinte della folla e i
+    // piccoli ostacoli, senza ricerca globale. Path con layer: waypoint
+    if (p->corridor_pending && level)
+    {
+        p->corridor = corridor_create(level, p->current_path, 0.0f);
+        p->corridor_pending = false;
+    }
+
+    // Prendi il prossimo waypoint (o il target del corridoio) come target
+    vec3 corridorTarget;
+    bool lastLeg = false;
+    vec3* waypoint;
+    if (p->corridor)
+    {
+        CorridorStatus status = corridor_update(p->corridor, p->position, corridorTarget);
+        if (status == CORRIDOR_BROKEN)
+        {
+            player_replan(p, level);
+            p->position[1] = level_get_height(level, p->position[0], p->position[2]);
+            animator_update(&p->animator, dt);
+            return;
+        }
+        waypoint = &corridorTarget;
+        lastLeg = (status == CORRIDOR_LAST_LEG);
+    }
+    else
+    {
+        waypoint = &p->current_path->waypoints[p->current_waypoint];
+    }
 
     // Calcola vettore verso waypoint corrente (solo XZ)
     vec3 toTarget;
@@ -516,11 +577,13 @@ void player_update(Player *p, float dt, Level *level)
     // Siamo arrivati al waypoint corrente?
     if (distance < p->arrivalThreshold)
     {
-        // Passa al prossimo waypoint
-        p->current_waypoint++;
+        // Passa al prossimo waypoint (col corridoio conta solo il goal)
+        bool finished = p->corridor
+            ? lastLeg
+            : ++p->current_waypoint >= p->current_path->waypoint_count;
 
         // Se era l'ultimo waypoint, fermati
-        if (p->current_waypoint >= p->current_path->waypoint_count) {
+        if (finished) {
             p->hasDestination = false;
             player_clear_path(p);
             // Aggiorna altezza Y
@@ -538,6 +601,13 @@ void player_update(Player *p, float dt, Level *level)
         {
             p->position[1] = level_get_height(level, p->position[0], p->position[2]);
         }
+        // Target intermedio del corridoio: il prossimo update sceglie il successivo
+        if (p->corridor)
+        {
+            animator_update(&p->animator, dt);
+            return;
+        }
+
         // Non return, continua il movimento verso il prossimo waypoint nello stesso frame
 
         // Ricalcola verso il nuovo waypoint
@@ -727,10 +797,14 @@ void player_set_path(Player* p, Path* path) {
         path_free(p->current_path);
     }
 
+    corridor_destroy(p->corridor);
+    p->corridor = NULL;
+
     // Imposta nuovo path
     p->current_path = path;
     p->current_waypoint = 0;
     p->hasDestination = (path != NULL && path->waypoint_count > 0);
+    p->corridor_pending = p->hasDestination;
 
     if (p->hasDestination) {
         printf("[Player] Path set: %d waypoints\n", path->waypoint_count);
@@ -740,10 +814,17 @@ void player_set_path(Player* p, Path* path) {
 void player_clear_path(Player* p) {
     if (!p) return;
 
+    // Annulla anche l'eventuale ricerca in corso
+    pathfinding_search_end(p->pending_search);
+    p->pending_search = NULL;
+
     if (p->current_path) {
         path_free(p->current_path);
         p->current_path = NULL;
     }
+    corridor_destroy(p->corridor);
+    p->corridor = NULL;
+    p->corridor_pending = false;
 
     p->current_waypoint = 0;
     p->hasDestination = false;
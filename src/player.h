@@ -16,6 +16,7 @@
 #include "skeletal/skeletal.h"
 #include "level.h"
 #include "pathfinding.h"
+#include "pathfinding_corridor.h"
 #include <cglm/cglm.h>
 
 // ============================================================================
@@ -56,6 +57,9 @@ typedef struct {
     // Pathfinding
     Path* current_path;      // Path corrente da seguire
     int current_waypoint;    // Indice del prossimo waypoint
+    PathSearch* pending_search; // Ricerca in corso (avanza a fette in player_update)
+    PathCorridor* corridor;  // Corridoio lungo current_path (NULL = segue i waypoint)
+    bool corridor_pending;   // Corridoio da creare al prossimo update (serve il livello)
 
     // Animazione (riferimento a skeleton globale)
     Animator animator;
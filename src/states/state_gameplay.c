@@ -5,6 +5,9 @@
 #include "../grid.h"
 #include "../camera.h"
 #include "../pathfinding.h"
+#include "../pathfinding_service.h"
+#include "../pathfinding_flowfield.h"
+#include "../pathfinding_cache.h"
 #include <math.h>
 #include <stdio.h>
 
@@ -61,6 +64,9 @@ void gameplay_init(Game* g) {
         printf("[Gameplay] WARNING: Failed to load level config, using fallback\n");
     }
 
+    // Worker thread per le richieste di path asincrone (creature)
+    path_service_init(&level, 0);
+
     // Carica assets livello
     if (!asset_manager_load_level("level_01")) {
         printf("[Gameplay] ERROR: Failed to load level\n");
@@ -157,6 +163,10 @@ void gameplay_update(Game* g, float dt) {
         player_handle_input(&player, g, cached_view, cached_proj, &level);
     }
 
+    // Edit di walkability del frame precedente: un solo aggiornamento di
+    // HPA*, zone e flow field per tutti
+    pathfinding_flush_changes();
+
     // Update player
     player_update(&player, dt, &level);
     
@@ -227,6 +237,14 @@ void gameplay_cleanup(void) {
     // Rimuovi callback scroll
     scrollCallbackCamera = NULL;
 
+    // Path e ricerca in corso del player fanno riferimento al livello
+    player_clear_path(&player);
+
+    // I worker leggono il livello: fermali prima di liberarlo
+    path_service_shutdown();
+    flowfield_cache_clear();
+    pathfinding_cache_clear();
+
     level_cleanup(&level);
     grid_cleanup();
     asset_manager_unload_level();
@@ -16,22 +16,18 @@
 // Helper interno: Campiona la walk mask (se esiste)
 static bool sample_walkability(Terrain* t, float u, float v) {
     // Se non abbiamo caricato la maschera, assumiamo che tutto sia camminabile
-    if (!t->walkMap) return true; 
+    if (!t->walkBits.rows) return true; 
     
     // Clamp UV per sicurezza
     if (u < 0.0f) u = 0.0f; if (u > 1.0f) u = 1.0f;
     if (v < 0.0f) v = 0.0f; if (v > 1.0f) v = 1.0f;
     
     // Converti in coordinate pixel
-    int x = (int)(u * (t->gridWidth - 1));
-    int y = (int)(v * (t->gridHeight - 1));
+    int x = (int)(u * (t->walkBits.width - 1));
+    int y = (int)(v * (t->walkBits.height - 1));
     
-    // Indice array 1D
-    int idx = y * t->gridWidth + x;
-    
-    // Logica: > 128 (Grigio medio) significa "Camminabile" (Bianco)
-    // < 128 (Nero) significa "Bloccato"
-    return t->walkMap[idx] > 128;
+    // Bit a 1: il pixel della maschera era sopra la soglia del livello (camminabile)
+    return bitgrid_get(&t->walkBits, x, y);
 }
 
 
@@ -100,8 +96,17 @@ bool terrain_is_walkable(Terrain* t, float worldX, float worldZ) {
     if (!sample_walkability(t, u, v)) {
         return false;
     }
+
+    // 3. Ostacoli dinamici (strutture piazzate a runtime, risoluzione pathgrid)
+    if (t->pathgrid.obstacles) {
+        int gx = (int)(u * PATHGRID_SIZE);
+        int gz = (int)(v * PATHGRID_SIZE);
+        if (gx >= PATHGRID_SIZE) gx = PATHGRID_SIZE - 1;
+        if (gz >= PATHGRID_SIZE) gz = PATHGRID_SIZE - 1;
+        if (pathgrid_has_obstacle(&t->pathgrid, gx, gz)) return false;
+    }
     /*
-    // 3. Check Pendenza (Fisica)
+    // 4. Check Pendenza (Fisica)
     // Calcoliamo la normale per vedere se è troppo ripido
     vec3 normal;
     terrain_get_normal(t, worldX, worldZ, normal);
@@ -149,9 +154,6 @@ static void setup_terrain_gpu(Terrain* t, Mesh* mesh) {
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
 
     glBindVertexArray(0);
-    
-    // Inizializza matrice identità (o posiziona il chunk dove vuoi)
-    glm_mat4_identity(t->modelMatrix);
 }
 
 static void init_shader(Terrain* t) {
@@ -162,22 +164,15 @@ static void init_shader(Terrain* t) {
     t->loc_uTexture = glGetUniformLocation(t->shader, "uTexture");
     t->loc_uLightDir = glGetUniformLocation(t->shader, "uLightDir");
     t->loc_uAmbient = glGetUniformLocation(t->shader, "uAmbient");
-    
-    glm_mat4_identity(t->modelMatrix);
 }
 
 bool terrain_init_hybrid(Terrain* t, const char* objPath, const char* heightMapPath, const char* walkMaskPath, float worldSize, float offsetX, float offsetZ) {
-    // Azzera la struct
-    t->heightMap = NULL;
-    t->walkMap = NULL;
-    t->worldSize = worldSize;
-    t->halfSize = worldSize / 2.0f;
-    t->offsetX = offsetX;
-    t->offsetZ = offsetZ;
-    t->minY = 0.0f;
-    t->maxY = 0.0f;
+    if (!terrain_init_gpu(t, objPath)) return false;
+    return terrain_init_data(t, heightMapPath, walkMaskPath, worldSize, offsetX, offsetZ, NULL);
+}
 
-// 1. CARICAMENTO VISUALE (Mesh)
+bool terrain_init_gpu(Terrain* t, const char* objPath) {
+    // 1. CARICAMENTO VISUALE (Mesh)
     Mesh* mesh = obj_load(objPath);
     if (!mesh) {
         printf("[Terrain] ERRORE: OBJ non trovato %s\n", objPath);
@@ -197,6 +192,24 @@ bool terrain_init_hybrid(Terrain* t, const char* objPath, const char* heightMapP
     // Puoi riusare lo stesso shader di prima se gli attributi coincidono
     init_shader(t);
 
+    return true;
+}
+
+bool terrain_init_data(Terrain* t, const char* heightMapPath, const char* walkMaskPath, float worldSize, float offsetX, float offsetZ,
+                       const PathGridBuildParams* walkParams) {
+    PathGridBuildParams defaults = { PATHGRID_DEFAULT_PIXEL_THRESHOLD, PATHGRID_DEFAULT_WALKABLE_RATIO };
+    if (!walkParams) walkParams = &defaults;
+
+    // Azzera i campi dei dati
+    t->heightMap = NULL;
+    t->walkBits = (BitGrid){0};
+    t->walkBlocks = (BitGrid){0};
+    t->worldSize = worldSize;
+    t->halfSize = worldSize / 2.0f;
+    t->offsetX = offsetX;
+    t->offsetZ = offsetZ;
+    t->minY = 0.0f;
+    t->maxY = 0.0f;
 
     // 1. CARICAMENTO HEIGHTMAP 16-BIT
     int w, h, channels;
@@ -251,29 +264,31 @@ bool terrain_init_hybrid(Terrain* t, const char* objPath, const char* heightMapP
 
     // 2. CARICAMENTO WALK MASK 8-BIT (Standard)
     int w2, h2, ch2;
+    unsigned char* walkMap = NULL;
     if (walkMaskPath) {
-        t->walkMap = stbi_load(walkMaskPath, &w2, &h2, &ch2, 1);
-    } else {
-        t->walkMap = NULL;  // Trigger fallback below
+        walkMap = stbi_load(walkMaskPath, &w2, &h2, &ch2, 1);
     }
 
-    if (!t->walkMap) {
+    // Maschera a bit (SSE2): i byte servono solo a questo passaggio
+    if (!walkMap) {
         printf("[Terrain] WARNING: Walkmask non trovata, creo maschera vuota.\n");
         // Fallback: tutto camminabile
-        t->walkMap = (unsigned char*)malloc(w * h);
-        for(int i=0; i<w*h; i++) t->walkMap[i] = 255;
+        if (bitgrid_init(&t->walkBits, w, h, false)) bitgrid_fill(&t->walkBits, true);
     } else {
         // Controllo coerenza dimensioni
         if (w2 != w || h2 != h) {
             printf("[Terrain] WARNING: Dimensioni Walkmask diverse da Heightmap!\n");
         }
+        bitgrid_from_bytes(&t->walkBits, walkMap, w2, h2, walkParams->pixel_threshold);
+        stbi_image_free(walkMap);
     }
 
-    // 3. COSTRUZIONE PATHFINDING GRID
-    if (t->walkMap && t->gridWidth > 0 && t->gridHeight > 0) {
-        if (!pathgrid_build(&t->pathgrid, t->walkMap, t->gridWidth, t->gridHeight)) {
+    // 3. COSTRUZIONE PATHFINDING GRID (popcount sui blocchi della maschera)
+    if (t->walkBits.rows) {
+        if (!pathgrid_build(&t->pathgrid, &t->walkBits, walkParams->walkable_ratio)) {
             printf("[Terrain] WARNING: Failed to build pathfinding grid\n");
         }
+        bitgrid_init_blocks(&t->walkBlocks, &t->walkBits, TERRAIN_WALK_BLOCK);
     } else {
         printf("[Terrain] WARNING: No walkmap available, pathfinding grid not built\n");
     }
@@ -364,7 +379,8 @@ void terrain_draw(Terrain* t, mat4 viewProj) {
 
 void terrain_cleanup(Terrain* t) {
     if (t->heightMap) free(t->heightMap);
-    if (t->walkMap) free(t->walkMap);
+    bitgrid_cleanup(&t->walkBits);
+    bitgrid_cleanup(&t->walkBlocks);
     pathgrid_cleanup(&t->pathgrid);
     // free mesh...
 }
@@ -393,6 +409,7 @@ static Terrain* debug_cached_terrain = NULL;
 
 // Cache per pathgrid debug
 static Terrain* debug_pathgrid_cached_terrain = NULL;
+static uint32_t debug_pathgrid_cached_version = 0;
 static bool debug_pathgrid_initialized = false;
 
 void terrain_debug_init(Terrain* t) {
@@ -478,7 +495,7 @@ void terrain_debug_draw(Terrain* t, mat4 viewProj, int step) {
 }
 
 void terrain_debug_draw_walkmap(Terrain* t, mat4 viewProj, int step) {
-    if (!t->walkMap || !t->heightMap) {
+    if (!t->walkBits.rows || !t->heightMap) {
         //printf("[TerrainDebug] No walkmap or heightmap available\n");
         return;
     }
@@ -519,7 +536,8 @@ void terrain_debug_draw_walkmap(Terrain* t, mat4 viewProj, int step) {
             float worldY = t->heightMap[hmIdx];
 
             // Leggi walkability dalla walkmap
-            bool walkable = t->walkMap[hmIdx] > 128;
+            bool walkable = gx < t->walkBits.width && gz < t->walkBits.height &&
+                            bitgrid_get(&t->walkBits, gx, gz);
 
             // Posizione
             vertices[idx++] = worldX;
@@ -586,9 +604,11 @@ void terrain_debug_draw_pathgrid(Terrain* t, mat4 viewProj) {
         glGenBuffers(1, &debug_colored_vbo);
     }
 
-    // Ricalcola solo se necessario (primo draw o terrain cambiato)
-    if (!debug_pathgrid_initialized || t != debug_pathgrid_cached_terrain) {
+    // Ricalcola solo se necessario (primo draw, terrain cambiato o pathgrid modificato)
+    if (!debug_pathgrid_initialized || t != debug_pathgrid_cached_terrain ||
+        t->pathgrid.version != debug_pathgrid_cached_version) {
         debug_pathgrid_cached_terrain = t;
+        debug_pathgrid_cached_version = t->pathgrid.version;
         debug_pathgrid_initialized = true;
 
         // Pathgrid è sempre 64x64
@@ -15,10 +15,15 @@
 #define TERRAIN_BAKE_MIN_HEIGHT  -64.0f  
 #define TERRAIN_BAKE_MAX_HEIGHT   192.0f  
 
+// Lato (pixel) dei blocchi di walkBlocks: con la maschera 1024x1024 un
+// blocco coincide con una cella della pathgrid
+#define TERRAIN_WALK_BLOCK 16
+
 typedef struct Terrain {
     // --- DATI LOGICI (FISICA) ---
     float* heightMap;       // Array di float (metri reali)
-    unsigned char* walkMap; // Array di byte (0 = bloccato, 255 = libero)
+    BitGrid walkBits;       // Walk mask a 1 bit per pixel (1 = libero), solo righe: 1/8 dei byte
+    BitGrid walkBlocks;     // Blocchi TERRAIN_WALK_BLOCK^2 di walkBits tutti liberi (salti della LOS)
 
     int gridWidth;          // Risoluzione della griglia (es. 1024)
     int gridHeight;
@@ -65,6 +70,20 @@ bool terrain_init_hybrid(Terrain* t,
                          float offsetX,
                          float offsetZ);
 
+// Solo mesh, texture e shader (contesto GL, main thread)
+bool terrain_init_gpu(Terrain* t, const char* objPath);
+
+// Solo dati CPU (heightmap, walkmask, pathgrid), senza mesh né contesto GL:
+// usata da terrain_init_hybrid, da level_load (un thread per chunk) e dai
+// tool headless (pathbench). walkParams: soglie della walkmask (NULL = default)
+bool terrain_init_data(Terrain* t,
+                       const char* heightMapPath,
+                       const char* walkMaskPath,
+                       float worldSize,
+                       float offsetX,
+                       float offsetZ,
+                       const PathGridBuildParams* walkParams);
+
 // Verifica se un punto è dentro i bounds del chunk
 bool terrain_contains_point(Terrain* t, float worldX, float worldZ);
 
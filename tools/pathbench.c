@@ -0,0 +1,509 @@
+/*
+ * PATHBENCH - Benchmark headless del pathfinding
+ * ==============================================
+ *
+ * Uso: ./pathbench scenario.scn [--queries] > risultati.json
+ *
+ * Carica il livello dello scenario senza contesto GL (level_load_headless),
+ * riproduce query ed edit nell'ordine del file e scrive su stdout un JSON con
+ * latenza (p50/p95/p99/max), nodi espansi e memoria per query, da confrontare
+ * tra due versioni con diff. Gli edit consecutivi formano un frame: prima
+ * della query successiva pathfinding_flush_changes aggiorna i listener
+ * (tempo in flush_ms). I log di livello e pathfinding vanno su stderr.
+ * --queries aggiunge il risultato di ogni singola query.
+ *
+ * Formato dello scenario (una direttiva per riga, '#' commento):
+ *   level <path.lvl>               Relativo alla directory dello scenario
+ *   mode astar|jps|theta           Impostazioni globali (valgono per tutte le query)
+ *   radius <m>                     agent_radius
+ *   cache on|off                   Path cache (default off: misura la ricerca)
+ *   landmarks <n>                  Euristica ALT con n landmark (default: chiave del .lvl)
+ *   warmup <n>                     Le prime n query non entrano nelle statistiche
+ *   query <sx> <sz> <gx> <gz>      Coordinate world (Y dall'heightmap)
+ *   random <n> <seed> [min_dist]   n query casuali riproducibili (LCG interno, non rand()),
+ *                                  con start e goal ad almeno min_dist metri
+ *   block <x0> <z0> <x1> <z1>      Celle globali rese non walkable
+ *   unblock <x0> <z0> <x1> <z1>
+ *   stamp <x> <z> <hx> <hz>        Ostacolo dinamico rettangolare (centro e semi-lati in metri)
+ *   unstamp <x> <z> <hx> <hz>
+ *
+ * Build: make pathbench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "level.h"
+#include "pathfinding.h"
+#include "pathfinding_landmarks.h"
+#include "pathfinding_arena.h"
+#include "utils.h"
+
+// ============================================================================
+// SCENARIO
+// ============================================================================
+
+typedef enum {
+    EVENT_QUERY,
+    EVENT_RANDOM,
+    EVENT_BLOCK,
+    EVENT_UNBLOCK,
+    EVENT_STAMP,
+    EVENT_UNSTAMP
+} EventType;
+
+typedef struct {
+    EventType type;
+    float v[4];
+    int count;               // EVENT_RANDOM
+    uint32_t seed;
+    float min_dist;
+} Event;
+
+typedef struct {
+    char level_path[512];
+    PathSearchMode mode;
+    float radius;
+    bool cache;
+    int landmarks;
+    int warmup;
+
+    Event* events;
+    int event_count;
+    int event_capacity;
+} Scenario;
+
+static const char* mode_name(PathSearchMode mode) {
+    switch (mode) {
+        case PATH_SEARCH_JPS: return "jps";
+        case PATH_SEARCH_THETA: return "theta";
+        default: return "astar";
+    }
+}
+
+static bool scenario_add_event(Scenario* sc, Event ev) {
+    if (sc->event_count >= sc->event_capacity) {
+        int new_capacity = sc->event_capacity ? sc->event_capacity * 2 : 64;
+        Event* new_events = (Event*)realloc(sc->events, new_capacity * sizeof(Event));
+        if (!new_events) return false;
+        sc->events = new_events;
+        sc->event_capacity = new_capacity;
+    }
+    sc->events[sc->event_count++] = ev;
+    return true;
+}
+
+static bool scenario_load(Scenario* sc, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("[Bench] ERROR: Cannot open scenario: %s\n", path);
+        return false;
+    }
+
+    memset(sc, 0, sizeof(*sc));
+    sc->mode = PATH_SEARCH_ASTAR;
+
+    // Directory dello scenario (il path del livello è relativo a questa)
+    char baseDir[256] = "";
+    const char* lastSlash = strrchr(path, '/');
+    if (lastSlash) {
+        size_t len = lastSlash - path + 1;
+        if (len >= sizeof(baseDir)) len = sizeof(baseDir) - 1;
+        strncpy(baseDir, path, len);
+        baseDir[len] = '\0';
+    }
+
+    char line[512];
+    int line_no = 0;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+
+        char key[64];
+        if (sscanf(line, "%63s", key) != 1) continue;
+
+        Event ev;
+        memset(&ev, 0, sizeof(ev));
+        int parsed = 0;
+
+        if (strcmp(key, "level") == 0) {
+            char rel[256];
+            if (sscanf(line, "%*s %255s", rel) == 1) {
+                snprintf(sc->level_path, sizeof(sc->level_path), "%s%s", baseDir, rel);
+                continue;
+            }
+        } else if (strcmp(key, "mode") == 0) {
+            char name[32];
+            if (sscanf(line, "%*s %31s", name) == 1) {
+                if (strcmp(name, "jps") == 0) sc->mode = PATH_SEARCH_JPS;
+                else if (strcmp(name, "theta") == 0) sc->mode = PATH_SEARCH_THETA;
+                else sc->mode = PATH_SEARCH_ASTAR;
+                continue;
+            }
+        } else if (strcmp(key, "radius") == 0) {
+            if (sscanf(line, "%*s %f", &sc->radius) == 1) continue;
+        } else if (strcmp(key, "cache") == 0) {
+            char value[16];
+            if (sscanf(line, "%*s %15s", value) == 1) {
+                sc->cache = strcmp(value, "on") == 0;
+                continue;
+            }
+        } else if (strcmp(key, "landmarks") == 0) {
+            if (sscanf(line, "%*s %d", &sc->landmarks) == 1) continue;
+        } else if (strcmp(key, "warmup") == 0) {
+            if (sscanf(line, "%*s %d", &sc->warmup) == 1) continue;
+        } else if (strcmp(key, "random") == 0) {
+            ev.type = EVENT_RANDOM;
+            parsed = sscanf(line, "%*s %d %u %f", &ev.count, &ev.seed, &ev.min_dist) >= 2;
+        } else {
+            if (strcmp(key, "query") == 0) ev.type = EVENT_QUERY;
+            else if (strcmp(key, "block") == 0) ev.type = EVENT_BLOCK;
+            else if (strcmp(key, "unblock") == 0) ev.type = EVENT_UNBLOCK;
+            else if (strcmp(key, "stamp") == 0) ev.type = EVENT_STAMP;
+            else if (strcmp(key, "unstamp") == 0) ev.type = EVENT_UNSTAMP;
+            else {
+                printf("[Bench] ERROR: %s:%d: unknown directive '%s'\n", path, line_no, key);
+                ok = false;
+                break;
+            }
+            parsed = sscanf(line, "%*s %f %f %f %f", &ev.v[0], &ev.v[1], &ev.v[2], &ev.v[3]) == 4;
+        }
+
+        if (!parsed) {
+            printf("[Bench] ERROR: %s:%d: invalid '%s' line\n", path, line_no, key);
+            ok = false;
+        } else if (!scenario_add_event(sc, ev)) {
+            printf("[Bench] ERROR: Out of memory reading scenario\n");
+            ok = false;
+        }
+    }
+
+    fclose(f);
+
+    if (ok && !sc->level_path[0]) {
+        printf("[Bench] ERROR: %s: missing 'level' directive\n", path);
+        ok = false;
+    }
+    if (!ok) free(sc->events);
+    return ok;
+}
+
+// ============================================================================
+// ESECUZIONE
+// ============================================================================
+
+typedef struct {
+    double ms;
+    long long nodes;
+    size_t bytes;            // Memoria del Path restituito
+    long long heap_allocs;   // malloc dell'arena dei path durante la query
+    int waypoints;
+    float length;
+    bool found;
+} QueryResult;
+
+typedef struct {
+    QueryResult* queries;
+    int query_count;
+    int query_capacity;
+    double* edit_ms;
+    int edit_count;
+    int edit_capacity;
+    double* flush_ms;
+    int flush_count;
+    int flush_capacity;
+} BenchResults;
+
+// LCG (Numerical Recipes): stesse query su ogni piattaforma
+static float lcg_next(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / (float)(1u << 24);
+}
+
+static bool results_add_query(BenchResults* r, QueryResult q) {
+    if (r->query_count >= r->query_capacity) {
+        int new_capacity = r->query_capacity ? r->query_capacity * 2 : 256;
+        QueryResult* new_queries = (QueryResult*)realloc(r->queries, new_capacity * sizeof(QueryResult));
+        if (!new_queries) return false;
+        r->queries = new_queries;
+        r->query_capacity = new_capacity;
+    }
+    r->queries[r->query_count++] = q;
+    return true;
+}
+
+static bool timings_add(double** values, int* count, int* capacity, double ms) {
+    if (*count >= *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        double* new_values = (double*)realloc(*values, new_capacity * sizeof(double));
+        if (!new_values) return false;
+        *values = new_values;
+        *capacity = new_capacity;
+    }
+    (*values)[(*count)++] = ms;
+    return true;
+}
+
+// Notifica gli edit accodati prima della prossima query (fine del frame)
+static bool flush_edits(BenchResults* r) {
+    double t0 = get_time_ms();
+    if (pathfinding_flush_changes() == 0) return true;
+    return timings_add(&r->flush_ms, &r->flush_count, &r->flush_capacity, get_time_ms() - t0);
+}
+
+static QueryResult run_query(PathfindingContext* ctx, Level* lvl, const PathQueryParams* params,
+                             float sx, float sz, float gx, float gz) {
+    QueryResult q;
+    memset(&q, 0, sizeof(q));
+
+    vec3 start = { sx, level_get_height(lvl, sx, sz), sz };
+    vec3 goal = { gx, level_get_height(lvl, gx, gz), gz };
+
+    PathfindingStats before, after;
+    PathArenaStats arena_before, arena_after;
+    pathfinding_context_get_stats(ctx, &before);
+    path_arena_get_stats(&arena_before);
+
+    double t0 = get_time_ms();
+    Path* path = pathfinding_find_path_ctx_ex(ctx, lvl, start, goal, params);
+    q.ms = get_time_ms() - t0;
+
+    pathfinding_context_get_stats(ctx, &after);
+    q.nodes = after.nodes_expanded - before.nodes_expanded;
+
+    if (path) {
+        q.found = true;
+        q.waypoints = path->waypoint_count;
+        q.bytes = sizeof(Path) + path->capacity * (sizeof(vec3) + sizeof(uint8_t));
+        for (int i = 1; i < path->waypoint_count; i++) {
+            q.length += glm_vec3_distance(path->waypoints[i - 1], path->waypoints[i]);
+        }
+        path_free(path);
+    }
+    path_arena_get_stats(&arena_after);
+    q.heap_allocs = arena_after.heap_allocs - arena_before.heap_allocs;
+    return q;
+}
+
+static bool run_scenario(Scenario* sc, Level* lvl, PathfindingContext* ctx, BenchResults* r) {
+    PathQueryParams params = pathfinding_query_defaults();
+    params.mode = sc->mode;
+    params.agent_radius = sc->radius;
+    if (!sc->cache) params.flags |= PATH_QUERY_NO_CACHE;
+
+    // Area delle query casuali (come pathfinding_run_benchmark)
+    float margin = 5.0f;
+    float minX = lvl->originX + margin;
+    float minZ = lvl->originZ + margin;
+    float spanX = lvl->totalSizeX - 2.0f * margin;
+    float spanZ = lvl->totalSizeZ - 2.0f * margin;
+
+    for (int e = 0; e < sc->event_count; e++) {
+        Event* ev = &sc->events[e];
+
+        if ((ev->type == EVENT_QUERY || ev->type == EVENT_RANDOM) && !flush_edits(r)) return false;
+
+        if (ev->type == EVENT_QUERY) {
+            if (!results_add_query(r, run_query(ctx, lvl, &params, ev->v[0], ev->v[1], ev->v[2], ev->v[3]))) {
+                return false;
+            }
+        } else if (ev->type == EVENT_RANDOM) {
+            uint32_t state = ev->seed;
+            for (int i = 0; i < ev->count; i++) {
+                float sx = minX + lcg_next(&state) * spanX;
+                float sz = minZ + lcg_next(&state) * spanZ;
+                float gx, gz;
+
+                // Goal ripescato finché non è abbastanza lontano (al massimo 64 tentativi)
+                int attempts = 0;
+                do {
+                    gx = minX + lcg_next(&state) * spanX;
+                    gz = minZ + lcg_next(&state) * spanZ;
+                } while ((gx - sx) * (gx - sx) + (gz - sz) * (gz - sz) < ev->min_dist * ev->min_dist &&
+                         ++attempts < 64);
+                if (!results_add_query(r, run_query(ctx, lvl, &params, sx, sz, gx, gz))) return false;
+            }
+        } else {
+            // Edit: il tempo include la clearance; zone e HPA* vanno nel flush
+            double t0 = get_time_ms();
+            if (ev->type == EVENT_BLOCK || ev->type == EVENT_UNBLOCK) {
+                pathfinding_set_cells_walkable(lvl, (int)ev->v[0], (int)ev->v[1], (int)ev->v[2], (int)ev->v[3],
+                                               ev->type == EVENT_UNBLOCK);
+            } else {
+                vec3 center = { ev->v[0], 0.0f, ev->v[1] };
+                PathFootprint fp = pathfinding_footprint_rect(center, ev->v[2], ev->v[3]);
+                if (ev->type == EVENT_STAMP) pathfinding_stamp_obstacle(lvl, &fp);
+                else pathfinding_unstamp_obstacle(lvl, &fp);
+            }
+            if (!timings_add(&r->edit_ms, &r->edit_count, &r->edit_capacity, get_time_ms() - t0)) return false;
+        }
+    }
+    return flush_edits(r);
+}
+
+// ============================================================================
+// REPORT JSON
+// ============================================================================
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Percentile nearest-rank su valori già ordinati
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int rank = (int)(p * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+static void print_distribution(const char* name, double* values, int count, bool last) {
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    qsort(values, count, sizeof(double), compare_double);
+
+    printf("  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+           name, count ? sum / count : 0.0, percentile(values, count, 0.50), percentile(values, count, 0.95),
+           percentile(values, count, 0.99), count ? values[count - 1] : 0.0, last ? "" : ",");
+}
+
+static long max_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+static void print_report(const char* scenario_path, Scenario* sc, BenchResults* r, double load_ms,
+                         bool per_query) {
+    int first = sc->warmup < r->query_count ? sc->warmup : r->query_count;
+    int count = r->query_count - first;
+    QueryResult* queries = r->queries + first;
+
+    double* values = (double*)malloc((count > 0 ? count : 1) * sizeof(double));
+    if (!values) return;
+
+    int found = 0;
+    double total_length = 0.0;
+    long long heap_allocs = 0;
+    for (int i = 0; i < count; i++) {
+        heap_allocs += queries[i].heap_allocs;
+        if (queries[i].found) {
+            found++;
+            total_length += queries[i].length;
+        }
+    }
+
+    printf("{\n");
+    printf("  \"scenario\": \"%s\",\n", scenario_path);
+    printf("  \"level\": \"%s\",\n", sc->level_path);
+    printf("  \"mode\": \"%s\",\n", mode_name(sc->mode));
+    printf("  \"agent_radius\": %.3f,\n", sc->radius);
+    printf("  \"cache\": %s,\n", sc->cache ? "true" : "false");
+    printf("  \"landmarks\": %d,\n", sc->landmarks);
+    printf("  \"load_ms\": %.2f,\n", load_ms);
+    printf("  \"context_bytes\": %zu,\n", pathfinding_context_memory());
+    printf("  \"max_rss_kb\": %ld,\n", max_rss_kb());
+    printf("  \"queries\": %d,\n", count);
+    printf("  \"warmup\": %d,\n", first);
+    printf("  \"found\": %d,\n", found);
+    printf("  \"total_length\": %.3f,\n", total_length);
+
+    for (int i = 0; i < count; i++) values[i] = queries[i].ms;
+    print_distribution("latency_ms", values, count, false);
+    for (int i = 0; i < count; i++) values[i] = (double)queries[i].nodes;
+    print_distribution("nodes_expanded", values, count, false);
+    for (int i = 0; i < count; i++) values[i] = (double)queries[i].bytes;
+    print_distribution("path_bytes", values, count, false);
+
+    // Dopo il warmup l'arena dovrebbe riusare solo blocchi già allocati
+    PathArenaStats arena;
+    path_arena_get_stats(&arena);
+    printf("  \"path_arena\": {\"heap_allocs\": %lld, \"reserved_bytes\": %zu, \"peak_paths\": %d},\n",
+           heap_allocs, arena.reserved_bytes, arena.peak_paths);
+
+    printf("  \"edits\": %d,\n", r->edit_count);
+    print_distribution("edit_ms", r->edit_ms, r->edit_count, false);
+    printf("  \"flushes\": %d,\n", r->flush_count);
+    print_distribution("flush_ms", r->flush_ms, r->flush_count, !per_query);
+
+    if (per_query) {
+        printf("  \"per_query\": [\n");
+        for (int i = 0; i < count; i++) {
+            QueryResult* q = &queries[i];
+            printf("    {\"found\": %d, \"ms\": %.4f, \"nodes\": %lld, \"waypoints\": %d, \"length\": %.3f}%s\n",
+                   q->found, q->ms, q->nodes, q->waypoints, q->length, i + 1 < count ? "," : "");
+        }
+        printf("  ]\n");
+    }
+    printf("}\n");
+
+    free(values);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char** argv) {
+    const char* scenario_path = NULL;
+    bool per_query = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--queries") == 0) per_query = true;
+        else scenario_path = argv[i];
+    }
+    if (!scenario_path) {
+        fprintf(stderr, "Usage: %s scenario.scn [--queries] > results.json\n", argv[0]);
+        return 1;
+    }
+
+    // I log di livello e pathfinding vanno su stderr: stdout resta JSON valido
+    fflush(stdout);
+    int json_fd = dup(STDOUT_FILENO);
+    if (json_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "[Bench] ERROR: Cannot redirect log output\n");
+        return 1;
+    }
+
+    Scenario sc;
+    if (!scenario_load(&sc, scenario_path)) return 1;
+
+    Level lvl;
+    double t0 = get_time_ms();
+    if (!level_load_headless(&lvl, sc.level_path)) {
+        printf("[Bench] ERROR: Failed to load level %s\n", sc.level_path);
+        free(sc.events);
+        return 1;
+    }
+    if (sc.landmarks > 0) landmarks_build(&lvl, sc.landmarks);
+    double load_ms = get_time_ms() - t0;
+
+    PathfindingContext* ctx = pathfinding_context_create();
+    BenchResults results;
+    memset(&results, 0, sizeof(results));
+
+    bool ok = ctx && run_scenario(&sc, &lvl, ctx, &results);
+    if (!ok) printf("[Bench] ERROR: Scenario aborted (out of memory)\n");
+
+    fflush(stdout);
+    dup2(json_fd, STDOUT_FILENO);
+    close(json_fd);
+
+    if (ok) print_report(scenario_path, &sc, &results, load_ms, per_query);
+
+    free(results.queries);
+    free(results.edit_ms);
+    free(results.flush_ms);
+    free(sc.events);
+    pathfinding_context_destroy(ctx);
+    level_cleanup(&lvl);
+    return ok ? 0 : 1;
+}